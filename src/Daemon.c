@@ -0,0 +1,726 @@
+/*
+File: Daemon.c, Implementation of functions for mode "daemon", and of its clients.
+Copyright (C) 12019-12021  Sam harry Tzavaras
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, version 3 of the License, or any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#define _GNU_SOURCE
+
+#define DAEMON_DIR "SDAQ_worker" /*Name of the directory of the control sockets*/
+#define DAEMON_DEV_EXPIRE 60 /*Time in sec without Device_status from an SDAQ, before it's dropped from the live state*/
+#define DAEMON_POLL_TIME 1000 /*Max time in msec between two checks of the live state*/
+#define DAEMON_REQ_SIZE 1024 /*Max size of a request, including the terminating new line*/
+#define DAEMON_REQ_TIMEOUT 1 /*Max time in sec for the reception of a request*/
+#define DAEMON_EOT '\0' /*Separate the output of a request from its exit code*/
+#define DAEMON_ADDR_TABLE_SIZE 64 /*Size of the address table, fits all the 6-bit SDAQ addresses*/
+#define DAEMON_MAX_WORKERS 4 /*Max amount of worker processes, with requests of modes with transactions*/
+#define DAEMON_MAX_CLIENTS 8 /*Max amount of clients with a request under reception*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <gmodule.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+
+#include "SDAQ_drv.h"
+#include "Modes.h"
+#include "Logging.h"
+#include "SDAQ_shm.h"
+
+//Live state of an SDAQ, constructed from the traffic of the bus.
+typedef struct daemon_device{
+	unsigned int serial_number;
+	unsigned char address;
+	unsigned char dev_type;
+	unsigned char status;
+	unsigned char num_of_ch;
+	unsigned long long last_seen;//Time of the last Device_status, msec on CLOCK_MONOTONIC.
+	unsigned int meas_valid;//Bitmap of the channels with measurement, bit 0 for CH1.
+	sdaq_meas meas[SDAQ_MAX_AMOUNT_OF_CHANNELS];//Latest measurement of each channel.
+	unsigned long long meas_time[SDAQ_MAX_AMOUNT_OF_CHANNELS];//Reception time of meas, nsec since Epoch.
+}daemon_dev;
+
+typedef struct daemon_state{
+	GHashTable *by_sn;//daemon_dev of each serial number. Owns the devices.
+	daemon_dev *by_addr[DAEMON_ADDR_TABLE_SIZE];//Last device that sent Device_status from each address.
+	SDAQ_shm_table *shm;//Latest-value table for the local readers, NULL if it's unavailable.
+	SDAQ_shm_ring *ring;//Ring of all the measurements for the local readers, NULL if it's unavailable.
+	SDAQ_log_session *log;//Logging session, NULL if there is none.
+	int log_socket;
+	unsigned char log_addr;
+	unsigned int workers;//Amount of running worker processes.
+}daemon_state;
+
+//Client of the control socket, with its request under reception.
+typedef struct daemon_client{
+	int fd;//Socket of the client, -1 for a free slot.
+	size_t len;//Amount of received bytes at buff.
+	unsigned long long deadline;//Time limit for the reception of the request, msec on CLOCK_MONOTONIC.
+	char buff[DAEMON_REQ_SIZE];
+}daemon_client;
+
+//Request of a client
+typedef struct daemon_request{
+	char mode[16];
+	unsigned char dev_addr;
+	unsigned int serial_number;
+	opt_flags usr_flag;
+}daemon_req;
+
+//Global Variables
+volatile sig_atomic_t daemon_running;
+
+//Local functions
+gchar *Daemon_socket_path(const char *CANif_name, _Bool mk_dir);//Return path of the control socket (must be freed with g_free), or NULL.
+void Daemon_quit_handler(int signum);
+void Daemon_frame_dec(daemon_state *state, const struct can_frame *frame, unsigned long long rx_time);//Update state with a frame.
+gboolean Daemon_dev_expired(gpointer key, gpointer dev, gpointer arg);//GHRFunc used with g_hash_table_foreach_remove.
+int Daemon_client_rx(daemon_client *client);//Receive from a client. Return 1 when its request is complete, 0 to wait for more, or -1 to drop it.
+void Daemon_serve(daemon_state *state, int client_fd, char *buff, opt_flags *usr_flag);//Execute and answer the request at buff.
+void Daemon_reply(daemon_state *state, int client_fd, daemon_req *req);//Execute a request, with output and exit code to the client.
+int Daemon_req_dec(char *buff, daemon_req *req);//Decode a request. Return 0 on success.
+int Daemon_exec(daemon_state *state, daemon_req *req);//Execute a request, output at stdout. Return the exit code.
+int Daemon_discover(daemon_state *state, daemon_req *req);
+int Daemon_measure(daemon_state *state, daemon_req *req);
+int Daemon_logging(daemon_state *state, daemon_req *req);
+gchar *abs_path(const char *path);//Return absolute path of path (must be freed with g_free).
+
+static inline unsigned long long mono_time_ms(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000ULL + now.tv_nsec/1000000;
+}
+
+int Daemon(int socket_num, opt_flags *usr_flag)
+{
+	int listen_fd, client_fd, timeout, ret, retval = EXIT_SUCCESS;
+	unsigned int i;
+	unsigned long long rx_time, now, last_check;
+	gchar *path;
+	SDAQ_rx_batch rx;
+	struct can_frame frame_rx;
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+	struct sigaction quit_act = {.sa_handler = Daemon_quit_handler};//No SA_RESTART, poll() returns on signal.
+	struct pollfd fds[2+DAEMON_MAX_CLIENTS];
+	daemon_client clients[DAEMON_MAX_CLIENTS];
+	daemon_state state = {0};
+
+	if(!(path = Daemon_socket_path(usr_flag->CANif_name, TRUE)))
+	{
+		fprintf(stderr, "Control socket path is unavailable!!!\n");
+		return EXIT_FAILURE;
+	}
+	strcpy(addr.sun_path, path);
+	if((listen_fd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0)) < 0)
+	{
+		perror("Control socket");
+		g_free(path);
+		return EXIT_FAILURE;
+	}
+	//A connectable control socket belongs to a running daemon, otherwise it's stale.
+	if(!connect(listen_fd, (struct sockaddr *)&addr, sizeof(addr)))
+	{
+		fprintf(stderr, "A daemon for %s is already running!!!\n", usr_flag->CANif_name);
+		close(listen_fd);
+		g_free(path);
+		return EXIT_FAILURE;
+	}
+	unlink(path);
+	if(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(listen_fd, SOMAXCONN))
+	{
+		perror("Control socket");
+		close(listen_fd);
+		g_free(path);
+		return EXIT_FAILURE;
+	}
+	daemon_running = 1;
+	sigaction(SIGINT, &quit_act, NULL);
+	sigaction(SIGTERM, &quit_act, NULL);
+	signal(SIGPIPE, SIG_IGN);//Clients that disconnect early are detected by write().
+	state.by_sn = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+	state.log_socket = -1;
+	if(!(state.shm = SDAQ_shm_table_create(usr_flag->CANif_name)))
+		fprintf(stderr, "Shared memory table is unavailable, continue without it\n");
+	if(!(state.ring = SDAQ_shm_ring_create(usr_flag->CANif_name)))
+		fprintf(stderr, "Shared memory ring is unavailable, continue without it\n");
+	if(!usr_flag->silent)
+		printf("Daemon of %s, control socket at %s\n", usr_flag->CANif_name, path);
+
+	//Ask all the SDAQs for their status, the rest of the state constructed from the heartbeats.
+	SDAQ_rx_init(&rx, socket_num);
+	QueryDeviceInfo(socket_num, Broadcast);
+	fds[0] = (struct pollfd){.fd = socket_num, .events = POLLIN};
+	fds[1] = (struct pollfd){.fd = listen_fd, .events = POLLIN};
+	for(i=0; i<DAEMON_MAX_CLIENTS; i++)
+		clients[i].fd = -1;
+	last_check = mono_time_ms();
+	while(daemon_running)
+	{
+		//The requests are received from all the clients along with the bus, a slow client doesn't stall the others.
+		timeout = DAEMON_POLL_TIME;
+		now = mono_time_ms();
+		for(i=0; i<DAEMON_MAX_CLIENTS; i++)
+		{
+			fds[2+i] = (struct pollfd){.fd = clients[i].fd, .events = POLLIN};
+			if(clients[i].fd < 0)
+				continue;
+			if(clients[i].deadline <= now)
+				timeout = 0;
+			else if(clients[i].deadline - now < (unsigned int)timeout)
+				timeout = clients[i].deadline - now;
+		}
+		if(poll(fds, 2+DAEMON_MAX_CLIENTS, timeout) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			perror("poll");
+			retval = EXIT_FAILURE;
+			break;
+		}
+		if(fds[0].revents & POLLIN)
+		{
+			do{
+				if(SDAQ_rx(&rx, &frame_rx, &rx_time) == sizeof(frame_rx))
+					Daemon_frame_dec(&state, &frame_rx, rx_time);
+			}while(SDAQ_rx_pending(&rx));
+		}
+		if(fds[1].revents & POLLIN && (client_fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC|SOCK_NONBLOCK)) >= 0)
+		{
+			for(i=0; i<DAEMON_MAX_CLIENTS && clients[i].fd >= 0; i++);
+			if(i < DAEMON_MAX_CLIENTS)
+			{
+				clients[i].fd = client_fd;
+				clients[i].len = 0;
+				clients[i].deadline = mono_time_ms() + DAEMON_REQ_TIMEOUT*1000;
+			}
+			else
+				close(client_fd);//Too many clients with requests under reception.
+		}
+		now = mono_time_ms();
+		for(i=0; i<DAEMON_MAX_CLIENTS; i++)
+		{
+			if(clients[i].fd < 0)
+				continue;
+			ret = fds[2+i].revents ? Daemon_client_rx(&clients[i]) : 0;
+			if(ret > 0)
+				Daemon_serve(&state, clients[i].fd, clients[i].buff, usr_flag);
+			else if(!ret && clients[i].deadline > now)
+				continue;//Request is incomplete, wait for the rest of it.
+			close(clients[i].fd);
+			clients[i].fd = -1;
+		}
+		while(state.workers && waitpid(-1, NULL, WNOHANG) > 0)
+			state.workers--;
+		if((now = mono_time_ms()) - last_check >= DAEMON_POLL_TIME)
+		{
+			g_hash_table_foreach_remove(state.by_sn, Daemon_dev_expired, &state);
+			last_check = now;
+		}
+	}
+	if(state.log)
+	{
+		Logging_stop(state.log);
+		close(state.log_socket);
+	}
+	//The requests in progress are completed, their clients get a reply.
+	while(state.workers && wait(NULL) > 0)
+		state.workers--;
+	for(i=0; i<DAEMON_MAX_CLIENTS; i++)
+		if(clients[i].fd >= 0)
+			close(clients[i].fd);
+	close(listen_fd);
+	unlink(path);
+	g_free(path);
+	g_hash_table_destroy(state.by_sn);
+	SDAQ_shm_table_destroy(state.shm, usr_flag->CANif_name);
+	SDAQ_shm_ring_destroy(state.ring, usr_flag->CANif_name);
+	if(!usr_flag->silent)
+		printf("Daemon of %s stopped\n", usr_flag->CANif_name);
+	return retval;
+}
+
+void Daemon_quit_handler(int signum)
+{
+	daemon_running = 0;
+}
+
+gchar *Daemon_socket_path(const char *CANif_name, _Bool mk_dir)
+{
+	const char *base;
+	gchar *dir, *path;
+
+	if((base = getenv("XDG_RUNTIME_DIR")) && *base)
+		dir = g_strdup_printf("%s/"DAEMON_DIR, base);
+	else
+		dir = g_strdup_printf("/tmp/"DAEMON_DIR"-%u", (unsigned int)getuid());
+	if(mk_dir && g_mkdir_with_parents(dir, 0700))
+	{
+		g_free(dir);
+		return NULL;
+	}
+	path = g_strdup_printf("%s/%s.sock", dir, CANif_name);
+	g_free(dir);
+	if(strlen(path) >= sizeof(((struct sockaddr_un *)NULL)->sun_path))
+	{
+		g_free(path);
+		return NULL;
+	}
+	return path;
+}
+
+void Daemon_frame_dec(daemon_state *state, const struct can_frame *frame, unsigned long long rx_time)
+{
+	const sdaq_can_id *id_dec = (const sdaq_can_id *)&(frame->can_id);
+	const sdaq_status *status_dec = (const sdaq_status *)frame->data;
+	const sdaq_info *info_dec = (const sdaq_info *)frame->data;
+	daemon_dev *dev;
+	unsigned char addr = id_dec->device_addr, ch = id_dec->channel_num;
+
+	switch(id_dec->payload_type)
+	{
+		case Device_status:
+			if(!(dev = g_hash_table_lookup(state->by_sn, GUINT_TO_POINTER(status_dec->dev_sn))))
+			{
+				dev = g_new0(daemon_dev, 1);
+				dev->serial_number = status_dec->dev_sn;
+				dev->address = addr;
+				g_hash_table_insert(state->by_sn, GUINT_TO_POINTER(dev->serial_number), dev);
+			}
+			else if(dev->address != addr)//Re-addressed SDAQ, its old measurements are dropped.
+			{
+				if(state->by_addr[dev->address] == dev)
+				{
+					state->by_addr[dev->address] = NULL;
+					SDAQ_shm_dev_remove(state->shm, dev->address);
+				}
+				dev->address = addr;
+				dev->meas_valid = 0;
+			}
+			state->by_addr[addr] = dev;
+			dev->status = status_dec->status;
+			dev->dev_type = status_dec->dev_type;
+			dev->last_seen = mono_time_ms();
+			SDAQ_shm_dev_update(state->shm, addr, status_dec, rx_time);
+			break;
+		case Device_info:
+			if((dev = state->by_addr[addr]))
+			{
+				dev->num_of_ch = info_dec->num_of_ch;
+				SDAQ_shm_dev_info(state->shm, addr, info_dec);
+			}
+			break;
+		case Measurement_value:
+			if(ch && ch <= SDAQ_MAX_AMOUNT_OF_CHANNELS)
+				SDAQ_shm_ring_push(state->ring, addr, ch, (const sdaq_meas *)frame->data, rx_time);
+			if((dev = state->by_addr[addr]) && ch && ch <= SDAQ_MAX_AMOUNT_OF_CHANNELS)
+			{
+				memcpy(&(dev->meas[ch-1]), frame->data, sizeof(sdaq_meas));
+				dev->meas_time[ch-1] = rx_time;
+				dev->meas_valid |= 1<<(ch-1);
+				SDAQ_shm_ch_update(state->shm, addr, ch, &(dev->meas[ch-1]), rx_time);
+			}
+			break;
+	}
+}
+
+gboolean Daemon_dev_expired(gpointer key, gpointer dev, gpointer arg)
+{
+	daemon_state *state = (daemon_state *)arg;
+	daemon_dev *dev_dec = (daemon_dev *)dev;
+
+	if(mono_time_ms() - dev_dec->last_seen < DAEMON_DEV_EXPIRE*1000ULL)
+		return FALSE;
+	if(state->by_addr[dev_dec->address] == dev_dec)
+	{
+		state->by_addr[dev_dec->address] = NULL;
+		SDAQ_shm_dev_remove(state->shm, dev_dec->address);
+	}
+	return TRUE;
+}
+
+int Daemon_client_rx(daemon_client *client)
+{
+	ssize_t ret;
+
+	while(client->len < sizeof(client->buff))
+	{
+		if((ret = read(client->fd, client->buff+client->len, sizeof(client->buff)-client->len)) <= 0)
+			return !ret || (errno != EAGAIN && errno != EINTR) ? -1 : 0;
+		client->len += ret;
+		if(memchr(client->buff, '\n', client->len))
+		{
+			if(client->buff[client->len-1] != '\n')
+				return -1;
+			client->buff[client->len-1] = '\0';
+			return 1;
+		}
+	}
+	return -1;
+}
+
+void Daemon_serve(daemon_state *state, int client_fd, char *buff, opt_flags *usr_flag)
+{
+	char trailer[2] = {DAEMON_EOT, EXIT_FAILURE};
+	pid_t pid;
+	daemon_req req = {.usr_flag = *usr_flag};
+
+	//The reply is written with blocking writes, as the output of the CLI modes.
+	fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL) & ~O_NONBLOCK);
+	req.usr_flag.info_file = NULL;
+	req.usr_flag.logging_dir = NULL;
+	if(Daemon_req_dec(buff, &req))
+		return;
+	if(strcmp(req.mode, "getinfo") && strcmp(req.mode, "setaddress"))
+	{
+		Daemon_reply(state, client_fd, &req);
+		return;
+	}
+	/*
+	 * Modes with transactions are executed by a worker process, on its own CAN socket.
+	 * The daemon keeps receiving the frames of the bus and serving the other clients.
+	 * A process and not a thread, the output of the modes is at stdout.
+	 */
+	fflush(stdout);
+	fflush(stderr);
+	if(state->workers >= DAEMON_MAX_WORKERS)
+		dprintf(client_fd, "Daemon is busy, try again later\n");
+	else if((pid = fork()) < 0)
+		dprintf(client_fd, "Worker of the daemon: %s\n", strerror(errno));
+	else if(!pid)
+	{
+		signal(SIGINT, SIG_DFL);
+		signal(SIGTERM, SIG_DFL);
+		Daemon_reply(state, client_fd, &req);
+		_exit(EXIT_SUCCESS);
+	}
+	else
+	{
+		state->workers++;
+		return;
+	}
+	if(write(client_fd, trailer, sizeof(trailer)) != sizeof(trailer))
+		return;
+}
+
+void Daemon_reply(daemon_state *state, int client_fd, daemon_req *req)
+{
+	char trailer[2] = {DAEMON_EOT, EXIT_FAILURE};
+	int saved_stdout, saved_stderr;
+
+	//The request is executed with its output redirected to the client.
+	fflush(stdout);
+	fflush(stderr);
+	saved_stdout = dup(STDOUT_FILENO);
+	saved_stderr = dup(STDERR_FILENO);
+	dup2(client_fd, STDOUT_FILENO);
+	dup2(client_fd, STDERR_FILENO);
+	trailer[1] = Daemon_exec(state, req);
+	fflush(stdout);
+	fflush(stderr);
+	dup2(saved_stdout, STDOUT_FILENO);
+	dup2(saved_stderr, STDERR_FILENO);
+	close(saved_stdout);
+	close(saved_stderr);
+	if(write(client_fd, trailer, sizeof(trailer)) != sizeof(trailer))
+		return;
+}
+
+int Daemon_req_dec(char *buff, daemon_req *req)
+{
+	char *field, *val, *save_ptr;
+
+	for(field = strtok_r(buff, "\t", &save_ptr); field; field = strtok_r(NULL, "\t", &save_ptr))
+	{
+		if(!(val = strchr(field, '=')))
+			return 1;
+		*val++ = '\0';
+		if(!strcmp(field, "mode"))
+			snprintf(req->mode, sizeof(req->mode), "%s", val);
+		else if(!strcmp(field, "addr"))
+			req->dev_addr = atoi(val);
+		else if(!strcmp(field, "sn"))
+			req->serial_number = strtoul(val, NULL, 10);
+		else if(!strcmp(field, "timeout"))
+			req->usr_flag.timeout = atoi(val);
+		else if(!strcmp(field, "silent"))
+			req->usr_flag.silent = atoi(val);
+		else if(!strcmp(field, "pretty"))
+			req->usr_flag.formatted_output = atoi(val);
+		else if(!strcmp(field, "verify"))
+			req->usr_flag.verify = atoi(val);
+		else if(!strcmp(field, "no_registry"))
+			req->usr_flag.no_registry = atoi(val);
+		else if(!strcmp(field, "file"))
+			req->usr_flag.info_file = val;
+		else if(!strcmp(field, "dir"))
+			req->usr_flag.logging_dir = val;
+	}
+	if(!req->usr_flag.timeout || req->usr_flag.timeout>20 || req->dev_addr >= DAEMON_ADDR_TABLE_SIZE)
+		return 1;
+	return 0;
+}
+
+int Daemon_exec(daemon_state *state, daemon_req *req)
+{
+	int trans_socket, retval;
+	unsigned int amount_of_filters = 0;
+	struct can_filter RX_filters[SDAQ_MAX_FILTERS];
+
+	if(!strcmp(req->mode, "discover"))
+		return Daemon_discover(state, req);
+	if(!strcmp(req->mode, "measure"))
+		return Daemon_measure(state, req);
+	if(!strcmp(req->mode, "logging"))
+		return Daemon_logging(state, req);
+	//Modes with transactions, executed on their own CAN socket, with the same filters as their CLI modes.
+	if(!req->dev_addr && strcmp(req->mode, "getinfo"))
+	{
+		printf("Device address: Out of range or invalid\n");
+		return EXIT_FAILURE;
+	}
+	if(!strcmp(req->mode, "getinfo") && req->dev_addr < Parking_address)
+	{
+		SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, req->dev_addr, Device_status);
+		SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, req->dev_addr, Device_info);
+		SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, req->dev_addr, Calibration_Date);
+		SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, req->dev_addr, Calibration_Point_Data);
+	}
+	else if(!strcmp(req->mode, "setaddress") && req->serial_number)
+		SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, req->dev_addr, Device_status);
+	else
+	{
+		printf("Unknown or invalid request for the daemon\n");
+		return EXIT_FAILURE;
+	}
+	if((trans_socket = SDAQ_socket_open(req->usr_flag.CANif_name, RX_filters, amount_of_filters, 20)) < 0)
+		return EXIT_FAILURE;
+	if(!strcmp(req->mode, "getinfo"))
+		retval = getinfo(trans_socket, req->dev_addr, &req->usr_flag);
+	else
+		retval = Change_address(trans_socket, req->serial_number, req->dev_addr, &req->usr_flag);
+	close(trans_socket);
+	return retval;
+}
+
+int Daemon_discover(daemon_state *state, daemon_req *req)
+{
+	int retval;
+	unsigned int amount = 0, *serial_number;
+	unsigned char *address, *dev_type;
+	GHashTableIter iter;
+	gpointer value;
+	daemon_dev *dev;
+
+	serial_number = g_new(unsigned int, g_hash_table_size(state->by_sn)+1);
+	address = g_new(unsigned char, g_hash_table_size(state->by_sn)+1);
+	dev_type = g_new(unsigned char, g_hash_table_size(state->by_sn)+1);
+	g_hash_table_iter_init(&iter, state->by_sn);
+	while(g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		dev = (daemon_dev *)value;
+		serial_number[amount] = dev->serial_number;
+		address[amount] = dev->address;
+		dev_type[amount++] = dev->dev_type;
+	}
+	retval = Discover_report(amount, serial_number, address, dev_type, &req->usr_flag);
+	g_free(serial_number);
+	g_free(address);
+	g_free(dev_type);
+	return retval;
+}
+
+int Daemon_measure(daemon_state *state, daemon_req *req)
+{
+	daemon_dev *dev;
+	sdaq_meas *meas;
+	unsigned long long now;
+	struct timespec now_ts;
+
+	if(!req->dev_addr || req->dev_addr >= Parking_address || !(dev = state->by_addr[req->dev_addr]))
+	{
+		printf("No SDAQ with Address %d\n", req->dev_addr);
+		return EXIT_FAILURE;
+	}
+	clock_gettime(CLOCK_REALTIME, &now_ts);
+	now = now_ts.tv_sec*1000000000ULL + now_ts.tv_nsec;
+	printf("\t------ Measurements of SDAQ with Address %d ------\n\n"
+		   "\t\tS/N: %d\n"
+		   "\t\tType: %s\n"
+		   "\t\tMode: %s, State: %s, Error?: %s, IsSync?: %s\n\n", dev->address,
+										dev->serial_number,
+										dev->dev_type < SDAQ_MAX_DEV_NUM && dev_type_str[dev->dev_type] ? dev_type_str[dev->dev_type] : "Unknown",
+										status_byte_dec(dev->status, Mode),
+										status_byte_dec(dev->status, State),
+										status_byte_dec(dev->status, Error),
+										status_byte_dec(dev->status, In_sync));
+	if(!dev->meas_valid)
+	{
+		printf("\tNo measurements received\n");
+		return EXIT_SUCCESS;
+	}
+	for(int i=0; i<SDAQ_MAX_AMOUNT_OF_CHANNELS; i++)
+	{
+		if(!(dev->meas_valid & 1<<i))
+			continue;
+		meas = &(dev->meas[i]);
+		if(!meas->status)
+			printf("\t\tCH%02d = %9.3f %-6s", i+1, meas->meas, unit_str[meas->unit]);
+		else if(meas->status&(1<<No_sensor))
+			printf("\t\tCH%02d =    No sensor    ", i+1);
+		else if(meas->status&(1<<Out_of_range))
+			printf("\t\tCH%02d =  Out of range   ", i+1);
+		else
+			printf("\t\tCH%02d =   Over Range    ", i+1);
+		printf(" Time -> %5d (msec), Age: %llu msec\n", meas->timestamp, (now - dev->meas_time[i])/1000000);
+	}
+	return EXIT_SUCCESS;
+}
+
+int Daemon_logging(daemon_state *state, daemon_req *req)
+{
+	unsigned long long rx_cnt, wr_cnt, dropped_cnt;
+	struct can_filter RX_filter;
+
+	if(!req->usr_flag.logging_dir)//Request for stop
+	{
+		if(!state->log)
+		{
+			printf("No active logging\n");
+			return EXIT_FAILURE;
+		}
+		Logging_stats(state->log, &rx_cnt, &wr_cnt, &dropped_cnt);
+		if(Logging_stop(state->log))
+			fprintf(stderr, "Error at reception or at writing of the log file!!!\n");
+		close(state->log_socket);
+		state->log = NULL;
+		state->log_socket = -1;
+		printf("Logging stopped. Received: %llu, Written: %llu, Dropped: %llu\n", rx_cnt, wr_cnt, dropped_cnt);
+		return EXIT_SUCCESS;
+	}
+	if(state->log)
+	{
+		printf("Logging of %s is already active, stop it first\n", state->log_addr ? "an SDAQ" : "all SDAQs");
+		return EXIT_FAILURE;
+	}
+	if(req->dev_addr >= Parking_address)
+	{
+		printf("Device address: Out of range or invalid\n");
+		return EXIT_FAILURE;
+	}
+	SDAQ_filter_build(&RX_filter, SDAQ_to_Master, req->dev_addr, Measurement_value);
+	if((state->log_socket = SDAQ_socket_open(req->usr_flag.CANif_name, &RX_filter, 1, 20)) < 0)
+		return EXIT_FAILURE;
+	if(!(state->log = Logging_start(state->log_socket, req->dev_addr, req->usr_flag.logging_dir, req->usr_flag.CANif_name)))
+	{
+		close(state->log_socket);
+		state->log_socket = -1;
+		return EXIT_FAILURE;
+	}
+	state->log_addr = req->dev_addr;
+	if(req->dev_addr == Broadcast)
+		printf("Logging of all SDAQs started, stop it with: logging stop\n");
+	else
+		printf("Logging of SDAQ with address %d started, stop it with: logging stop\n", req->dev_addr);
+	return EXIT_SUCCESS;
+}
+
+gchar *abs_path(const char *path)
+{
+	gchar *cwd, *ret;
+
+	if(g_path_is_absolute(path))
+		return g_strdup(path);
+	cwd = g_get_current_dir();
+	ret = g_build_filename(cwd, path, NULL);
+	g_free(cwd);
+	return ret;
+}
+
+int Daemon_request(const char *mode, unsigned char dev_addr, unsigned int serial_number, opt_flags *usr_flag)
+{
+	char buff[4096], *eot;
+	int fd, retval = -1;
+	ssize_t len;
+	gchar *path, *file = NULL, *dir = NULL;
+	GString *req;
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+
+	if(strcmp(mode, "discover") && strcmp(mode, "getinfo") && strcmp(mode, "setaddress") &&
+	   strcmp(mode, "measure") && strcmp(mode, "logging"))
+		return -1;
+	//Paths with the separators of the request's fields can't be sent.
+	if((usr_flag->info_file && strpbrk(usr_flag->info_file, "\t\n")) || (usr_flag->logging_dir && strpbrk(usr_flag->logging_dir, "\t\n")))
+		return -1;
+	if(!(path = Daemon_socket_path(usr_flag->CANif_name, FALSE)))
+		return -1;
+	strcpy(addr.sun_path, path);
+	g_free(path);
+	if((fd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0)) < 0)
+		return -1;
+	if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+	{
+		close(fd);
+		return -1;
+	}
+	//Construct the request. Paths are sent as absolute, the daemon has its own working directory.
+	req = g_string_new(NULL);
+	g_string_append_printf(req, "mode=%s\taddr=%u\tsn=%u\ttimeout=%u\tsilent=%u\tpretty=%u\tverify=%u\tno_registry=%u",
+						   mode, dev_addr, serial_number, usr_flag->timeout, usr_flag->silent,
+						   usr_flag->formatted_output, usr_flag->verify, usr_flag->no_registry);
+	if(usr_flag->info_file)
+		g_string_append_printf(req, "\tfile=%s", (file = abs_path(usr_flag->info_file)));
+	if(usr_flag->logging_dir)
+		g_string_append_printf(req, "\tdir=%s", (dir = abs_path(usr_flag->logging_dir)));
+	g_string_append_c(req, '\n');
+	if(req->len <= DAEMON_REQ_SIZE && write(fd, req->str, req->len) == (ssize_t)req->len)
+	{
+		//Copy the output of the request to stdout, until the exit code.
+		fflush(stdout);
+		retval = EXIT_FAILURE;
+		while((len = read(fd, buff, sizeof(buff))) > 0)
+		{
+			if((eot = memchr(buff, DAEMON_EOT, len)))
+			{
+				if(write(STDOUT_FILENO, buff, eot-buff) < 0)
+					break;
+				if(eot+1 < buff+len)
+					retval = eot[1];
+				else if(read(fd, buff, 1) == 1)
+					retval = buff[0];
+				break;
+			}
+			if(write(STDOUT_FILENO, buff, len) < 0)
+				break;
+		}
+	}
+	g_string_free(req, TRUE);
+	g_free(file);
+	g_free(dir);
+	close(fd);
+	return retval;
+}
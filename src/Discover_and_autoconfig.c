@@ -15,19 +15,21 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
-#define CMP_Serial_Numbers 1
-#define CMP_Addresses 2
-#define CMP_Addresses_no_parking 3
+#define SDAQ_ADDR_TABLE_SIZE 64 /*Size of the address table, fits all the 6-bit SDAQ addresses*/
+#define DISCOVERY_QUIET_TIME 500 /*Time in msec without a new SDAQ, that ends a scan*/
+#define AUTOCONF_RETRY_TIME 500 /*Time in msec without confirmation of a new address, before SetDeviceAddress is resent*/
+#define ADDR_BIT(addr) ((guint64)1<<(addr))
+#define VALID_ADDRS_MASK (~(ADDR_BIT(Broadcast) | ADDR_BIT(Parking_address)))
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <math.h>
+#include <time.h>
+#include <errno.h>
 #include <gmodule.h>
 #include <glib.h>
-#include <sys/time.h>
-#include <signal.h>
 
 #include <linux/can.h>
 #include <linux/can/raw.h>
@@ -36,6 +38,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "SDAQ_drv.h"
 #include "Modes.h"
+#include "SDAQ_registry.h"
 
 //Local struct for SDAQ device entry
 struct SDAQentry {
@@ -44,50 +47,104 @@ struct SDAQentry {
     unsigned char address;
 };
 
-//global variables
-static volatile unsigned char Discover_and_autoconf_TMR_exp=1;
+//Table of the SDAQs found on the bus
+typedef struct SDAQ_table{
+	GHashTable *by_sn;//SDAQentry of each serial number. Owns the entries.
+	GSList *by_addr[SDAQ_ADDR_TABLE_SIZE];//SDAQentries at each address, sorted by serial number.
+	guint64 occupied;//Bitmap of the addresses with at least one SDAQ.
+	guint64 conflicts;//Bitmap of the addresses with more than one SDAQ, Parking excluded.
+	unsigned int amount;
+}SDAQ_table;
 
 //Local functions
-void free_SDAQentry(gpointer node);//used with g_slist_free_full to free the data of each node
+void free_SDAQentry(gpointer node);//used with g_hash_table_new_full to free the data of each node
 void printf_SDAQentry(gpointer SDAQ_entry, gpointer data);
-GSList * find_SDAQs(int socket_num, unsigned int scanning_time);//Construct a list with the SDAQs that is on the BUS, Sort by address.
-GSList * find_SDAQs_inParking(GSList * head);//Construct a list with the SDAQs that be in parking, Sort by Serial number
-GSList * find_SDAQs_Conflicts(GSList * head);//Construct a list of lists with SDAQs that have the same address
-gint SDAQentry_cmp (gconstpointer a, gconstpointer b);// GFunc function used with g_slist_insert_sorted.
-gint SDAQentry_find_address (gconstpointer node, gconstpointer arg);//Used in g_slist_find_custom, compare to find node with address == *arg
-gint SDAQentry_find_serial_number (gconstpointer node, gconstpointer arg);//Used in g_slist_find_custom, compare to find node with serial_number == *arg
-gint SDAQentry_find_autoconf (gconstpointer node, gconstpointer arg);//GFunc function used with g_slist_find_custom when is called from autoconfig.
-// GFunc function used with g_slist_foreach. Arguments: SDAQ_new_address_list, pointer to socket number
-void SDAQs_newaddress_list_to_SDAQs(gpointer SDAQentry, gpointer arg_pass);
+void register_SDAQentry(gpointer SDAQ_entry, gpointer reg);//Used with SDAQ_table_foreach to record the entries to the registry.
+void register_found_SDAQs(SDAQ_table *table, opt_flags *usr_flag);//Record the SDAQs of table to the registry.
+void Discover_print(SDAQ_table *found, opt_flags *usr_flag);//Print the report of mode discover for the SDAQs of found.
+void SDAQ_table_init(SDAQ_table *table);
+void SDAQ_table_free(SDAQ_table *table);
+struct SDAQentry *SDAQ_table_add(SDAQ_table *table, unsigned int serial_number, unsigned char address, unsigned char dev_type);//Return new entry, or NULL if serial_number is already in table.
+void SDAQ_table_foreach(SDAQ_table *table, guint64 addrs, GFunc func, gpointer arg);//Run func for each entry at addrs bitmap, by order of address.
+void find_SDAQs(int socket_num, SDAQ_table *table, unsigned int scanning_time, unsigned int expected);//Fill table with the SDAQs that is on the BUS.
+guint64 set_new_addresses(int socket_num, const struct SDAQentry *new_addrs, unsigned int amount, unsigned int scanning_time);//Set and verify new addresses, return bitmap of the unconfirmed.
+gint SDAQentry_cmp_serial_number (gconstpointer a, gconstpointer b);// GCompareFunc function used with g_slist_insert_sorted.
 
 int Discover(int socket_num, opt_flags *usr_flag)
 {
-	GSList *list_SDAQs=NULL,*list_Park=NULL,*list_conflicts=NULL;
+	SDAQ_table found;
+
 	if(!(usr_flag->silent))
-		printf("Scan the CANbus for %d sec ...\n",usr_flag->timeout);
-	//Construct the list with the SDAQs that is on the BUS
-	list_SDAQs = find_SDAQs(socket_num,usr_flag->timeout);//last argument is the scanning time
-	if (list_SDAQs)
+		printf("Scan the CANbus (up to %d sec) ...\n",usr_flag->timeout);
+	//Construct the table with the SDAQs that is on the BUS
+	SDAQ_table_init(&found);
+	find_SDAQs(socket_num, &found, usr_flag->timeout, usr_flag->expected_devs);
+	Discover_print(&found, usr_flag);
+	if (found.amount)
+		register_found_SDAQs(&found, usr_flag);
+	SDAQ_table_free(&found);
+    return EXIT_SUCCESS;
+}
+
+unsigned long long Discover_scan(int socket_num, unsigned int *serial_number, unsigned long long *conflicts, opt_flags *usr_flag)
+{
+	SDAQ_table found;
+	guint64 unique, addrs;
+	unsigned char addr;
+
+	SDAQ_table_init(&found);
+	find_SDAQs(socket_num, &found, usr_flag->timeout, usr_flag->expected_devs);
+	unique = found.occupied & ~found.conflicts & VALID_ADDRS_MASK;
+	for(addrs = unique; addrs; addrs &= addrs - 1)
 	{
-		list_Park = find_SDAQs_inParking(list_SDAQs);//build list_Park with SDAQs in Parking mode
-		list_conflicts = find_SDAQs_Conflicts(list_SDAQs);//build list_conflicts
-		// print list_SDAQs
-		printf("The discover found %d SDAQ ",g_slist_length(list_SDAQs));
+		addr = __builtin_ctzll(addrs);
+		serial_number[addr] = ((struct SDAQentry *)found.by_addr[addr]->data)->serial_number;
+	}
+	if(conflicts)
+		*conflicts = found.conflicts;
+	if(found.amount)
+		register_found_SDAQs(&found, usr_flag);
+	SDAQ_table_free(&found);
+	return unique;
+}
+
+int Discover_report(unsigned int amount, const unsigned int *serial_number, const unsigned char *address, const unsigned char *dev_type, opt_flags *usr_flag)
+{
+	SDAQ_table found;
+
+	SDAQ_table_init(&found);
+	for(unsigned int i=0; i<amount; i++)
+		SDAQ_table_add(&found, serial_number[i], address[i], dev_type[i]);
+	Discover_print(&found, usr_flag);
+	SDAQ_table_free(&found);
+	return EXIT_SUCCESS;
+}
+
+void Discover_print(SDAQ_table *found, opt_flags *usr_flag)
+{
+	unsigned int amount_in_park, amount_of_conflicts;
+	guint64 addrs;
+
+	if (found->amount)
+	{
+		amount_in_park = g_slist_length(found->by_addr[Parking_address]);
+		// print all the found SDAQs
+		printf("The discover found %d SDAQ ",found->amount);
 		if(!(usr_flag->silent))
 		{
 			printf("\n==========  List of Discovered SDAQs   ==========\n");
-			g_slist_foreach(list_SDAQs, printf_SDAQentry, NULL);
+			SDAQ_table_foreach(found, found->occupied, printf_SDAQentry, NULL);
 		}
-		if(list_Park && list_conflicts == NULL)
+		if(amount_in_park && !found->conflicts)
 		{
-			// print list_Park
-			if(g_slist_length(list_SDAQs)!=g_slist_length(list_Park))
+			// print the SDAQs in parking
+			if(found->amount != amount_in_park)
 			{
-				printf("From them %d is/are in Parking\n",g_slist_length(list_Park));
+				printf("From them %d is/are in Parking\n",amount_in_park);
 				if(!(usr_flag->silent))
 				{
 					printf("==========  List of SDAQs in Parking   ==========\n");
-					g_slist_foreach(list_Park, printf_SDAQentry, NULL);
+					SDAQ_table_foreach(found, ADDR_BIT(Parking_address), printf_SDAQentry, NULL);
 				}
 			}
 			else
@@ -95,97 +152,94 @@ int Discover(int socket_num, opt_flags *usr_flag)
 			printf("\tUse mode 'autoconfig' to register them!!!\n");
 		}
 
-		if(list_conflicts)
+		if(found->conflicts)
 		{
-			// print list_conflicts
-			printf("\n!!!!!! Found %d device with address conflict !!!!!!\n",g_slist_length(list_conflicts));
+			// print the SDAQs with conflict
+			for(amount_of_conflicts=0, addrs=found->conflicts; addrs; addrs &= addrs - 1)
+				amount_of_conflicts += g_slist_length(found->by_addr[__builtin_ctzll(addrs)]);
+			printf("\n!!!!!! Found %d device with address conflict !!!!!!\n",amount_of_conflicts);
 			printf("==========  List of Conflict addresses  =========\n");
-			g_slist_foreach(list_conflicts, printf_SDAQentry, NULL);
+			SDAQ_table_foreach(found, found->conflicts, printf_SDAQentry, NULL);
 			printf("\n\tUse mode 'setaddress' and correct them!!!\n\n");
 		}
-		//free lists with only links
-		g_slist_free(list_Park);
-		g_slist_free(list_conflicts);
-		//free lists with linked data
-		g_slist_free_full(list_SDAQs, free_SDAQentry);
-
 	}
 	else
 		printf("No SDAQ found\n");
-    return EXIT_SUCCESS;
 }
 
 int Autoconfig(int socket_num, opt_flags *usr_flag)
 {
-	unsigned char addr_t=1;
-	int ret_val=EXIT_SUCCESS,i,j;
-	GSList *list_SDAQs=NULL,*list_Park=NULL, *list_conflicts=NULL;
-	GSList *list_work=NULL;//list_work used as element pointer in addressing, and as list in verification.
-	list_SDAQs = find_SDAQs(socket_num,usr_flag->timeout);//last argument is the scanning time
-	if (list_SDAQs)
+	int ret_val=EXIT_SUCCESS;
+	unsigned int i, amount_of_new = 0;
+	guint64 free_addrs, unconfirmed;
+	struct SDAQentry new_addrs[SDAQ_ADDR_TABLE_SIZE];
+	GSList *list_Park;
+	SDAQ_table found;
+
+	SDAQ_table_init(&found);
+	find_SDAQs(socket_num, &found, usr_flag->timeout, usr_flag->expected_devs);
+	if (found.amount)
 	{
-		list_Park = find_SDAQs_inParking(list_SDAQs);//build list_Park with SDAQs in Parking mode
-		list_conflicts=find_SDAQs_Conflicts(list_SDAQs); //build list_conflicts
-		if(list_conflicts) //Check for conflicts
+		if(found.conflicts) //Check for conflicts
 			printf("Address conflict found. Autoconfig Give Up!!!! \n");
-		else if(!list_Park)//Check for no Parking SDAQs
+		else if(!found.by_addr[Parking_address])//Check for no Parking SDAQs
 		{
 			if(!usr_flag->silent)
 				printf("All found SDAQs have valid address.\nBye Bye!!\n");
 		}
 		else //True Autoconfig
 		{
-			list_work = list_Park;
-			while(list_work)
+			//Give the lowest free addresses to the SDAQs in Parking, by order of serial number.
+			free_addrs = ~found.occupied & VALID_ADDRS_MASK;
+			for(list_Park = found.by_addr[Parking_address]; list_Park; list_Park = list_Park->next)
 			{
-				if(!g_slist_find_custom(list_SDAQs,&addr_t,SDAQentry_find_address))
+				if(!free_addrs)
 				{
-					((struct SDAQentry *)list_work->data)->address=addr_t;
-					list_work = list_work -> next;//next node with parking address
+					printf("No free address for all the SDAQs in Parking. Autoconfig Give Up!!!!\n");
+					SDAQ_table_free(&found);
+					return EXIT_FAILURE;
 				}
-				addr_t++;
+				new_addrs[amount_of_new] = *((struct SDAQentry *)list_Park->data);
+				new_addrs[amount_of_new++].address = __builtin_ctzll(free_addrs);
+				free_addrs &= free_addrs - 1;//Clear lowest set bit
 			}
 			if(!usr_flag->silent)
 			{
-				printf("Found %d SDAQs with Parking address\n",g_slist_length(list_Park));
+				printf("Found %d SDAQs with Parking address\n",amount_of_new);
 				printf("New addresses send to SDAQs....\n");
 			}
-			//Send the new addresses to the SDAQs
-			g_slist_foreach(list_Park, SDAQs_newaddress_list_to_SDAQs, &socket_num);
-			/*Autoconfig verification*/
+			//Send the new addresses to the SDAQs, and wait their confirmation.
 			if(!usr_flag->silent)
 			{
 				printf("-------Verification-------\n");
-				printf("Scan the BUS for %d sec.\n",usr_flag->timeout);
+				printf("Wait the SDAQs at their new address (up to %d sec).\n",usr_flag->timeout);
 			}
-			list_work = find_SDAQs(socket_num,usr_flag->timeout);//last argument is the scanning time
-			//check if the data->data of all the list_Park node is also in the list_work
-			for(i=0,j=g_slist_length(list_Park);i<j;i++)
+			if((unconfirmed = set_new_addresses(socket_num, new_addrs, amount_of_new, usr_flag->timeout)))
 			{
-				if(!g_slist_find_custom(list_work,g_slist_nth_data(list_Park,i),SDAQentry_find_autoconf))
+				if(!usr_flag->silent)
 				{
-					if(!usr_flag->silent)
-						printf("!!!!!! FAILURE !!!!!!!\n");
-					ret_val = EXIT_FAILURE;
-					break;
+					printf("!!!!!! FAILURE !!!!!!!\n");
+					for(i=0; i<amount_of_new; i++)
+						if(unconfirmed & ADDR_BIT(new_addrs[i].address))
+							printf("SDAQ with S/N: %010d not answering at Address: %hhu\n", new_addrs[i].serial_number, new_addrs[i].address);
 				}
+				ret_val = EXIT_FAILURE;
 			}
-			//Success message to the user
-			if(!usr_flag->silent && i==j)
+			else if(!usr_flag->silent)//Success message to the user
 				printf("SUCCESS\n");
+			//Update the address of the confirmed SDAQs, and record the found SDAQs to the registry.
+			for(i=0; i<amount_of_new; i++)
+				if(!(unconfirmed & ADDR_BIT(new_addrs[i].address)))
+					((struct SDAQentry *)g_hash_table_lookup(found.by_sn, GUINT_TO_POINTER(new_addrs[i].serial_number)))->address = new_addrs[i].address;
+			register_found_SDAQs(&found, usr_flag);
 		}
-		//free lists with only links
-		g_slist_free(list_Park);
-		g_slist_free(list_conflicts);
-		//free lists with linked data
-		g_slist_free_full(list_work, free_SDAQentry);
-		g_slist_free_full(list_SDAQs, free_SDAQentry);
 	}
 	else
 	{
 		if(!usr_flag->silent)
 			printf("No SDAQ found\n");
 	}
+	SDAQ_table_free(&found);
 	return ret_val;
 }
 
@@ -196,6 +250,23 @@ void free_SDAQentry(gpointer SDAQentry_node)
 }
 
 // print function for SDAQentry node
+void register_SDAQentry(gpointer SDAQentry, gpointer reg)
+{
+	struct SDAQentry *entry = (struct SDAQentry *)SDAQentry;
+	SDAQ_registry_seen((SDAQ_registry *)reg, entry->serial_number, entry->address, entry->dev_type);
+}
+
+void register_found_SDAQs(SDAQ_table *table, opt_flags *usr_flag)
+{
+	SDAQ_registry reg;
+
+	if(usr_flag->no_registry || SDAQ_registry_open(&reg, usr_flag->CANif_name))
+		return;
+	SDAQ_table_foreach(table, table->occupied, register_SDAQentry, &reg);
+	SDAQ_registry_save(&reg);
+	SDAQ_registry_close(&reg);
+}
+
 void printf_SDAQentry(gpointer SDAQentry, gpointer arg_pass)
 {
 	char address[5];
@@ -204,187 +275,187 @@ void printf_SDAQentry(gpointer SDAQentry, gpointer arg_pass)
 	else
 		sprintf(address,"Park");
 	if(SDAQentry)
-    	printf("%13s with S/N: %010d at Address: %s\n",((struct SDAQentry *) SDAQentry)->dev_type,
+    	printf("%13s with S/N: %010d at Address: %s\n",((struct SDAQentry *) SDAQentry)->dev_type ? ((struct SDAQentry *) SDAQentry)->dev_type : "Unknown",
 												  ((struct SDAQentry *) SDAQentry)->serial_number,
 												  address);
 }
 
-// GFunc function used with g_slist_foreach. Arguments: SDAQ_new_address_list, pointer to socket number
-void SDAQs_newaddress_list_to_SDAQs(gpointer SDAQentry, gpointer arg_pass)
+void SDAQ_table_init(SDAQ_table *table)
 {
-	//Configure with new address with arguments from the SDAQentry Node
-	SetDeviceAddress(*((int*)arg_pass),((struct SDAQentry *) SDAQentry)->serial_number,
-										((struct SDAQentry *) SDAQentry)->address);
-	return;
+	memset(table, 0, sizeof(SDAQ_table));
+	table->by_sn = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, free_SDAQentry);
 }
 
-void Discover_and_autoconf_timer_handler (int signum)
+void SDAQ_table_free(SDAQ_table *table)
 {
-	Discover_and_autoconf_TMR_exp = 0;
-	return;
+	for(int i=0; i<SDAQ_ADDR_TABLE_SIZE; i++)
+		g_slist_free(table->by_addr[i]);
+	g_hash_table_destroy(table->by_sn);
+	memset(table, 0, sizeof(SDAQ_table));
 }
-/*return a list with all the SDAQs on bus, sort by address*/
-GSList * find_SDAQs(int socket_num, unsigned int scanning_time)
+
+struct SDAQentry *SDAQ_table_add(SDAQ_table *table, unsigned int serial_number, unsigned char address, unsigned char dev_type)
 {
-	//Internal List with found SDAQs
-	GSList *ret_list = NULL;
 	struct SDAQentry *new_SDAQ_data;
+
+	if(address >= SDAQ_ADDR_TABLE_SIZE || g_hash_table_lookup(table->by_sn, GUINT_TO_POINTER(serial_number)))
+		return NULL;
+	// Allocates space for a new SDAQ entrance
+	if(!(new_SDAQ_data = g_slice_alloc0(sizeof(struct SDAQentry))))
+	{
+		fprintf(stderr,"Memory error\n");
+		exit(EXIT_FAILURE);
+	}
+	// set SDAQ info data
+	new_SDAQ_data->serial_number = serial_number;
+	new_SDAQ_data->address = address;
+	new_SDAQ_data->dev_type = dev_type < SDAQ_MAX_DEV_NUM ? dev_type_str[dev_type] : NULL;
+	g_hash_table_insert(table->by_sn, GUINT_TO_POINTER(serial_number), new_SDAQ_data);
+	if((table->occupied & ADDR_BIT(address)) && address != Parking_address)
+		table->conflicts |= ADDR_BIT(address);
+	table->occupied |= ADDR_BIT(address);
+	table->by_addr[address] = g_slist_insert_sorted(table->by_addr[address], new_SDAQ_data, SDAQentry_cmp_serial_number);
+	table->amount++;
+	return new_SDAQ_data;
+}
+
+void SDAQ_table_foreach(SDAQ_table *table, guint64 addrs, GFunc func, gpointer arg)
+{
+	int addr;
+
+	while(addrs)
+	{
+		addr = __builtin_ctzll(addrs);
+		g_slist_foreach(table->by_addr[addr], func, arg);
+		addrs &= addrs - 1;//Clear lowest set bit
+	}
+}
+
+//Return the time of the monotonic clock in msec.
+static inline unsigned long long mono_time_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000ULL + now.tv_nsec/1000000;
+}
+
+/*
+ * Fill table with the SDAQs that answer on the bus. The scan lasts up to scanning_time sec.
+ * It ends earlier after DISCOVERY_QUIET_TIME msec without a new SDAQ,
+ * or when table have 'expected' amount of SDAQs (0 for unknown).
+ */
+void find_SDAQs(int socket_num, SDAQ_table *table, unsigned int scanning_time, unsigned int expected)
+{
 	//CAN Socket and SDAQ related variables
+	SDAQ_rx_batch rx;
 	struct can_frame frame_rx;
 	int RX_bytes;
 	sdaq_can_id *id_dec = (sdaq_can_id *)&(frame_rx.can_id);
 	sdaq_status *status_dec = (sdaq_status *)(frame_rx.data);
-	//Timers related Variables
-	struct itimerval timer;//Scan Timeout
-
-	//link signal SIGALRM to timer's handler
-	signal(SIGALRM, Discover_and_autoconf_timer_handler);
-
-	//initialize timer expired time
-	Discover_and_autoconf_TMR_exp = 1;
-	memset (&timer, 0, sizeof(timer));
-	timer.it_value.tv_sec = scanning_time;
-	timer.it_value.tv_usec = 0;
-	setitimer (ITIMER_REAL, &timer, NULL);
+	//Timing related Variables
+	SDAQ_deadline dl;
+	unsigned long long end, quiet_end;
 
+	SDAQ_rx_init(&rx, socket_num);
+	if(SDAQ_deadline_init(&dl, &rx))
+	{
+		perror("Deadline");
+		return;
+	}
+	end = mono_time_ms() + scanning_time*1000ULL;
+	SDAQ_deadline_at(&dl, end);
 	//Query device info from every device
 	QueryDeviceInfo(socket_num,Broadcast);
-	while(Discover_and_autoconf_TMR_exp)
+	//Receive up to the nearest end of the scan.
+	while(!(expected && table->amount >= expected) && (RX_bytes=SDAQ_deadline_rx(&dl, &frame_rx, NULL)))
 	{
-		RX_bytes=read(socket_num, &frame_rx, sizeof(frame_rx));
-		if(RX_bytes==sizeof(frame_rx))
+		if(RX_bytes==sizeof(frame_rx) && id_dec->payload_type == Device_status)
 		{
-			if(id_dec->payload_type == Device_status)
+			// Store SDAQ if its serial number is not in the table, and restart the quiet period.
+			if(SDAQ_table_add(table, status_dec->dev_sn, id_dec->device_addr, status_dec->dev_type))
 			{
-				//target = CMP_Serial_Numbers; // set SDAQentry_find and SDAQentry_cmp to sort by serial number
-				// check if node with same Serial number exist in the list. if no, do store.
-				if(!g_slist_find_custom(ret_list,&(status_dec->dev_sn),SDAQentry_find_serial_number))
-				{
-					// Allocates space for a new SDAQ entrance
-					if((new_SDAQ_data = g_slice_alloc0(sizeof(struct SDAQentry))))
-					{
-						// set SDAQ info data
-						new_SDAQ_data->serial_number = status_dec->dev_sn;
-						new_SDAQ_data->address = id_dec->device_addr;
-						new_SDAQ_data->dev_type = dev_type_str[status_dec->dev_type];
-						ret_list = g_slist_insert_sorted(ret_list, new_SDAQ_data, SDAQentry_cmp);
-					}
-					else
-					{
-						fprintf(stderr,"Memory error\n");
-						exit(EXIT_FAILURE);
-					}
-				}
+				quiet_end = mono_time_ms() + DISCOVERY_QUIET_TIME;
+				SDAQ_deadline_at(&dl, quiet_end < end ? quiet_end : end);
 			}
 		}
+		else if(RX_bytes < 0 && errno != EAGAIN)
+			break;
 	}
-	return ret_list;
+	SDAQ_deadline_close(&dl);
 }
-/*return a list with all the SDAQs nodes (from head) that have Parking address, sort by Serial number*/
-GSList* find_SDAQs_inParking(GSList * head)
+
+/*
+ * Send the new addresses of new_addrs to the SDAQs, and wait each SDAQ to send a Device_status from its new address.
+ * The SDAQs that do not confirm within AUTOCONF_RETRY_TIME msec get their new address again.
+ * The wait ends when all are confirmed, or after scanning_time sec.
+ * Return: Bitmap of the new addresses that are not confirmed, 0 when all are confirmed.
+ */
+guint64 set_new_addresses(int socket_num, const struct SDAQentry *new_addrs, unsigned int amount, unsigned int scanning_time)
 {
-	GSList *t_lst = head, *ret_list=NULL;
-	for(int i=g_slist_length(head);i;i--)//Run for all head nodes.
+	//Pending SDAQs, indexed by their new address. Each new address is unique.
+	const struct SDAQentry *pending[SDAQ_ADDR_TABLE_SIZE] = {NULL};
+	guint64 unconfirmed = 0, laggards;
+	unsigned int i;
+	//CAN Socket and SDAQ related variables
+	SDAQ_rx_batch rx;
+	struct can_frame frame_rx;
+	int RX_bytes;
+	sdaq_can_id *id_dec = (sdaq_can_id *)&(frame_rx.can_id);
+	sdaq_status *status_dec = (sdaq_status *)(frame_rx.data);
+	//Timing related Variables
+	SDAQ_deadline dl;
+	unsigned long long now, end, retry;
+
+	SDAQ_rx_init(&rx, socket_num);
+	for(i=0; i<amount; i++)
 	{
-		//target = CMP_Addresses; // Set SDAQentry_find and SDAQentry_cmp to sort by device address
-		if(t_lst)
-		{
-			//look at the list t_lst (aka head, at first) for entrance with parking address
-			t_lst = g_slist_find_custom(t_lst,(gconstpointer) &(Parking_address),SDAQentry_find_address);
-			if(t_lst)
-			{
-				ret_list = g_slist_insert_sorted(ret_list, (gpointer) t_lst->data, SDAQentry_cmp);//sort by serial number
-				t_lst = t_lst->next; //goto next node
-			}
-			else
-				break; //Break the for loop if no Parking_address node found.
-		}
-		else
-			break;  //Break the for loop if end of list is reached.
+		pending[new_addrs[i].address] = &new_addrs[i];
+		unconfirmed |= ADDR_BIT(new_addrs[i].address);
 	}
-	return ret_list;
-}
-/*return a list with all the SDAQs nodes (from head) that have same address (aka conflict)*/
-GSList * find_SDAQs_Conflicts(GSList * head)
-{
-	GSList *ret_list=NULL; // function's return pointer
-	GSList *look_ptr, *start_ptr = head; //start_ptr pointer pointing the first node on list.
-	unsigned char cur_address=0;
-	if(g_slist_length(head)>1)
+	if(SDAQ_deadline_init(&dl, &rx))
 	{
-		//Place start_ptr pointer at first SDAQ list node that does not have parking address
-		while(start_ptr->next && ((((struct SDAQentry *)(start_ptr->data))->address)==Parking_address))
-			start_ptr = start_ptr->next; //move start_ptr to then next node
-		while(start_ptr->next)//Run until start_ptr pointer be at the end node of the list.
+		perror("Deadline");
+		return unconfirmed;
+	}
+	for(i=0; i<amount; i++)
+		SetDeviceAddress(socket_num, new_addrs[i].serial_number, new_addrs[i].address);
+	now = mono_time_ms();
+	end = now + scanning_time*1000ULL;
+	retry = now + AUTOCONF_RETRY_TIME;
+	SDAQ_deadline_at(&dl, retry < end ? retry : end);
+	while(unconfirmed && now < end)
+	{
+		//Resend the new address to the SDAQs that are not confirmed yet.
+		if(now >= retry)
 		{
-			ret_list = g_slist_append (ret_list, (gpointer) start_ptr->data); //append node that looked by start pointer in ret_list, as a possible conflict.
-			look_ptr = start_ptr->next;//look_ptr pointer pointing the next node after the start_ptr
-			while(look_ptr)//Run until look_ptr pointer be NULL. aka, pass from the last node.
-			{
-				//Check if the address field of the start_ptr node is the same with the node that point the look_ptr. aka if true, conflict found.
-				if(((struct SDAQentry *)(start_ptr->data))->address == ((struct SDAQentry *)(look_ptr->data))->address)
-				{
-					ret_list = g_slist_append(ret_list, look_ptr->data);
-					cur_address = (((struct SDAQentry *)(look_ptr->data))->address);
-				}
-				//Avoid, look_ptr points nodes with Parking address
-				do{
-					look_ptr = look_ptr->next; //move look_ptr pointer to next node
-				}while(look_ptr && (((struct SDAQentry *)(look_ptr->data))->address)==Parking_address);
-			}
-			//delete last appending on ret_list if does not have conflict address. aka above check with look_ptr give false.
-			if(g_slist_last(ret_list)->data == start_ptr->data)
-				ret_list = g_slist_delete_link(ret_list,g_slist_last(ret_list));
-			//Avoid, start_ptr points nodes with already checked address and nodes with Parking address
-			do{
-				start_ptr = start_ptr->next;//move start_ptr to then next node
-			}while(start_ptr->next && (((((struct SDAQentry *)(start_ptr->data))->address)==cur_address)
-							   ||  ((((struct SDAQentry *)(start_ptr->data))->address)==Parking_address)));
+			for(laggards = unconfirmed; laggards; laggards &= laggards - 1)
+				SetDeviceAddress(socket_num, pending[__builtin_ctzll(laggards)]->serial_number, __builtin_ctzll(laggards));
+			retry = now + AUTOCONF_RETRY_TIME;
+			SDAQ_deadline_at(&dl, retry < end ? retry : end);
 		}
+		RX_bytes=SDAQ_deadline_rx(&dl, &frame_rx, NULL);
+		if(RX_bytes==sizeof(frame_rx) && id_dec->payload_type == Device_status &&
+		   (unconfirmed & ADDR_BIT(id_dec->device_addr)) &&
+		   pending[id_dec->device_addr]->serial_number == status_dec->dev_sn &&
+		   pending[id_dec->device_addr]->dev_type ==
+		   (status_dec->dev_type < SDAQ_MAX_DEV_NUM ? dev_type_str[status_dec->dev_type] : NULL))
+			unconfirmed &= ~ADDR_BIT(id_dec->device_addr);
+		else if(RX_bytes < 0 && errno != EAGAIN)
+		{
+			perror("Reception");
+			break;
+		}
+		now = mono_time_ms();
 	}
-	return ret_list;
-}
-
-/*
-	Comparing function used in g_slist_insert_sorted.
-*/
-gint SDAQentry_cmp (gconstpointer a, gconstpointer b)
-{
-	if(((struct SDAQentry *)a)->address != ((struct SDAQentry *)b)->address)
-		return (((struct SDAQentry *)a)->address <= ((struct SDAQentry *)b)->address) ?  0 : 1;
-	else
-		return (((struct SDAQentry *)a)->serial_number <= ((struct SDAQentry *)b)->serial_number) ?  0 : 1;
+	SDAQ_deadline_close(&dl);
+	return unconfirmed;
 }
 
 /*
-	Comparing function used in g_slist_find_custom, compare to find node with address == *arg
+	Comparing function used in g_slist_insert_sorted, sort by serial number.
 */
-gint SDAQentry_find_address (gconstpointer node, gconstpointer arg)
+gint SDAQentry_cmp_serial_number (gconstpointer a, gconstpointer b)
 {
-	const unsigned char *arg_t = arg;
-	struct SDAQentry *node_dec = (struct SDAQentry *) node;
-	return node_dec->address == (unsigned char)*arg_t ?  0 : 1;
-}
-
-/*
-	Comparing function used in g_slist_find_custom, compare to find node with serial_number == *arg
-*/
-gint SDAQentry_find_serial_number (gconstpointer node, gconstpointer arg)
-{
-	const unsigned int *arg_t = arg;
-	struct SDAQentry *node_dec = (struct SDAQentry *) node;
-	return node_dec->serial_number == (unsigned int) *arg_t ?  0 : 1;
-}
-
-/*
-	Comparing function used in g_slist_find_custom when is called in autoconfig
-*/
-gint SDAQentry_find_autoconf (gconstpointer node, gconstpointer arg)
-{
-	struct SDAQentry *node_dec = (struct SDAQentry *) node;
-	struct SDAQentry *arg_dec = (struct SDAQentry *) arg;
-	if(node_dec->serial_number == arg_dec->serial_number && node_dec->address == arg_dec->address && node_dec->dev_type == arg_dec->dev_type)
-		return 0;
-	else
-		return 1;
+	return (((struct SDAQentry *)a)->serial_number <= ((struct SDAQentry *)b)->serial_number) ?  0 : 1;
 }
@@ -14,11 +14,23 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
+#define _GNU_SOURCE
+
+#define LOG_RING_SIZE (1<<16) //Amount of records in the RX->writer ring. Must be power of 2.
+#define LOG_WR_BATCH 4096 //Max amount of records per write() call.
+#define LOG_FLUSH_INTERVAL 500 //Max time (msec) that a record waits in the writer's buffer.
+#define LOG_IDLE_SLEEP 1 //Sleep time (msec) of the writer when the ring is empty.
+#define LOG_COL_SIZE 512 //Max amount of samples in a block of a device's channel. Used with logging of all devices.
+#define LOG_OUT_BUFF_SIZE (1<<20) //Size of the writer's output buffer for the blocks of the columnar format.
+#define LOG_AMOUNT_OF_ADDRESSES 62 //Amount of valid SDAQ addresses (1..Parking_address-1).
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
 #include <math.h>
 #include <signal.h>
 #include <pthread.h>
@@ -28,10 +40,477 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "SDAQ_drv.h"
 #include "Modes.h"
+#include "Logging.h"
+
+/*
+ * Single producer (RX thread), single consumer (writer thread) ring of sdaq_log_rec.
+ * head is written only by the producer and tail only by the consumer.
+ */
+typedef struct log_ring_struct{
+	unsigned int head __attribute__((aligned(64)));
+	unsigned int tail __attribute__((aligned(64)));
+	sdaq_log_rec *recs;
+}log_ring;
+
+struct log_thread_arguments{
+	int socket_num;
+	int log_fd;
+	unsigned char dev_addr;
+	log_ring ring;
+	//Shared between the threads, accessed with __atomic_* builtins.
+	_Bool rx_active;//Cleared after the end of the RX thread.
+	_Bool rx_error;//Set by the RX thread on reception failure.
+	_Bool wr_error;//Set by the writer thread on I/O failure.
+	unsigned long long rx_cnt, dropped_cnt;//Updated only by the RX thread.
+	unsigned long long wr_cnt;//Updated only by the writer thread.
+	pthread_t rx_thread_id, wr_thread_id;
+};
+
+/*
+ * Columnar buffers, used with logging of all devices.
+ * Each channel of each device has its own column buffer, the records are demultiplexed
+ * to them by the writer, and full (or on flush) columns are serialized as blocks to out.
+ */
+typedef struct log_column_struct{
+	unsigned short amount;
+	unsigned long long rx_time[LOG_COL_SIZE];
+	float meas[LOG_COL_SIZE];
+	unsigned short timestamp[LOG_COL_SIZE];
+	unsigned char unit[LOG_COL_SIZE];
+	unsigned char status[LOG_COL_SIZE];
+}log_column;
+
+typedef struct log_column_buffers_struct{
+	log_column *col[LOG_AMOUNT_OF_ADDRESSES][SDAQ_MAX_AMOUNT_OF_CHANNELS];//Allocated on first sample, Index:[dev_addr-1][channel-1]
+	unsigned char *out;//Serialized blocks, wait to be written.
+	size_t out_len;
+	unsigned int out_samples;//Amount of samples in out.
+	unsigned int pending;//Amount of samples in the columns.
+}log_col_buffs;
+
+//local functions
+void *log_RX(void *varg_pt);//Thread function. Receive and decode measurement messages to the ring.
+void *log_writer(void *varg_pt);//Thread function. Write the records of the ring to the log file.
+int log_file_open(const char *dir, unsigned char dev_addr, const char *CANif_name);//Return fd of the new log file, or -1 on failure.
+int write_all(int fd, const void *buff, size_t len);//write() until all bytes are written. Return 0 on success.
+log_col_buffs *log_columns_new(void);
+void log_columns_free(log_col_buffs *cols);
+int log_columns_put(struct log_thread_arguments *arg, log_col_buffs *cols, const sdaq_log_rec *rec);//Return 0 on success.
+int log_columns_flush(struct log_thread_arguments *arg, log_col_buffs *cols);//Serialize and write all the pending samples. Return 0 on success.
 
+static inline unsigned long long timespec_to_ns(const struct timespec *ts)
+{
+	return ts->tv_sec*1000000000ULL + ts->tv_nsec;
+}
+
+static inline int log_ring_push(log_ring *ring, const sdaq_log_rec *rec)
+{
+	unsigned int head = ring->head, tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+	if(head - tail >= LOG_RING_SIZE)
+		return 1;
+	ring->recs[head & (LOG_RING_SIZE-1)] = *rec;
+	__atomic_store_n(&ring->head, head+1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+//Pop up to max_amount records from ring to out. Return the amount of popped records.
+static inline unsigned int log_ring_pop(log_ring *ring, sdaq_log_rec *out, unsigned int max_amount)
+{
+	unsigned int tail = ring->tail, head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	unsigned int amount = head - tail, first_part, index = tail & (LOG_RING_SIZE-1);
+
+	if(amount > max_amount)
+		amount = max_amount;
+	if(!amount)
+		return 0;
+	first_part = LOG_RING_SIZE - index < amount ? LOG_RING_SIZE - index : amount;
+	memcpy(out, ring->recs+index, first_part*sizeof(sdaq_log_rec));
+	memcpy(out+first_part, ring->recs, (amount-first_part)*sizeof(sdaq_log_rec));
+	__atomic_store_n(&ring->tail, tail+amount, __ATOMIC_RELEASE);
+	return amount;
+}
 
 int Logging(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 {
-	printf("Not implemented\n");
+	int sig, retval;
+	unsigned long long rx_cnt, wr_cnt, dropped_cnt;
+	sigset_t quit_signals;
+	struct timespec status_interval = {.tv_sec = 1, .tv_nsec = 0};
+	SDAQ_log_session *session;
+
+	if(!usr_flag->logging_dir)
+	{
+		fprintf(stderr, "Logging directory is undefined!!!\n");
+		return EXIT_FAILURE;
+	}
+	//Block the quit signals, they handled by sigtimedwait().
+	sigemptyset(&quit_signals);
+	sigaddset(&quit_signals, SIGINT);
+	sigaddset(&quit_signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &quit_signals, NULL);
+	if(!(session = Logging_start(socket_num, dev_addr, usr_flag->logging_dir, usr_flag->CANif_name)))
+	{
+		pthread_sigmask(SIG_UNBLOCK, &quit_signals, NULL);
+		return EXIT_FAILURE;
+	}
+	if(!usr_flag->silent)
+	{
+		if(dev_addr == Broadcast)
+			printf("Logging of all SDAQs started, Ctrl+C to stop.\n");
+		else
+			printf("Logging of SDAQ with address %d started, Ctrl+C to stop.\n", dev_addr);
+	}
+	do{
+		sig = sigtimedwait(&quit_signals, NULL, &status_interval);
+		if(!usr_flag->silent)
+		{
+			Logging_stats(session, &rx_cnt, &wr_cnt, &dropped_cnt);
+			printf("\rReceived: %llu, Written: %llu, Dropped: %llu ", rx_cnt, wr_cnt, dropped_cnt);
+			fflush(stdout);
+		}
+	}while(sig < 0 && !Logging_stats(session, NULL, NULL, NULL));
+	Logging_stats(session, &rx_cnt, &wr_cnt, &dropped_cnt);
+	if((retval = Logging_stop(session)))
+		fprintf(stderr, "\nError at reception or at writing of the log file!!!\n");
+	pthread_sigmask(SIG_UNBLOCK, &quit_signals, NULL);
+	if(!usr_flag->silent)
+		printf("\nLogging stopped. Received: %llu, Written: %llu, Dropped: %llu\n", rx_cnt, wr_cnt, dropped_cnt);
+	return retval;
+}
+
+SDAQ_log_session *Logging_start(int socket_num, unsigned char dev_addr, const char *logging_dir, const char *CANif_name)
+{
+	sigset_t all_signals, old_mask;
+	SDAQ_log_session *session;
+
+	if(!(session = calloc(1, sizeof(SDAQ_log_session))))
+	{
+		fprintf(stderr,"Memory Error\n");
+		exit(EXIT_FAILURE);
+	}
+	if((session->log_fd = log_file_open(logging_dir, dev_addr, CANif_name)) < 0)
+	{
+		free(session);
+		return NULL;
+	}
+	if(!(session->ring.recs = malloc(LOG_RING_SIZE*sizeof(sdaq_log_rec))))
+	{
+		fprintf(stderr,"Memory Error\n");
+		exit(EXIT_FAILURE);
+	}
+	session->socket_num = socket_num;
+	session->dev_addr = dev_addr;
+	session->rx_active = 1;
+	//Signals are handled only by the caller's thread, the logging threads start with all of them blocked.
+	sigfillset(&all_signals);
+	pthread_sigmask(SIG_BLOCK, &all_signals, &old_mask);
+	pthread_create(&session->wr_thread_id, NULL, log_writer, session);
+	pthread_create(&session->rx_thread_id, NULL, log_RX, session);
+	pthread_sigmask(SIG_SETMASK, &old_mask, NULL);
+	Start(socket_num, dev_addr);
+	return session;
+}
+
+int Logging_stats(const SDAQ_log_session *session, unsigned long long *rx_cnt, unsigned long long *wr_cnt, unsigned long long *dropped_cnt)
+{
+	if(rx_cnt)
+		*rx_cnt = __atomic_load_n(&session->rx_cnt, __ATOMIC_RELAXED);
+	if(wr_cnt)
+		*wr_cnt = __atomic_load_n(&session->wr_cnt, __ATOMIC_RELAXED);
+	if(dropped_cnt)
+		*dropped_cnt = __atomic_load_n(&session->dropped_cnt, __ATOMIC_RELAXED);
+	return __atomic_load_n(&session->rx_error, __ATOMIC_ACQUIRE) || __atomic_load_n(&session->wr_error, __ATOMIC_ACQUIRE);
+}
+
+int Logging_stop(SDAQ_log_session *session)
+{
+	int retval = EXIT_SUCCESS;
+
+	//Stop reception, and wait the writer to drain the ring.
+	pthread_cancel(session->rx_thread_id);
+	pthread_join(session->rx_thread_id, NULL);
+	__atomic_store_n(&session->rx_active, 0, __ATOMIC_RELEASE);
+	pthread_join(session->wr_thread_id, NULL);
+	if(close(session->log_fd) || session->rx_error || session->wr_error)
+		retval = EXIT_FAILURE;
+	free(session->ring.recs);
+	free(session);
+	return retval;
+}
+
+//Thread function. Act as CAN-bus message receiver, decode and store measurement messages to the ring.
+void *log_RX(void *varg_pt)
+{
+	struct log_thread_arguments *arg = (struct log_thread_arguments *) varg_pt;
+	SDAQ_rx_batch rx;
+	struct can_frame frame_rx;
+	unsigned long long rx_time;
+	int RX_bytes;
+	sdaq_can_id *id_dec = (sdaq_can_id *)&(frame_rx.can_id);
+	sdaq_log_rec rec;
+
+	SDAQ_rx_init(&rx, arg->socket_num);
+	while(1)
+	{
+		RX_bytes=SDAQ_rx(&rx, &frame_rx, &rx_time);//rx_time: Kernel's reception time of the frame
+		if(RX_bytes==sizeof(frame_rx))
+		{
+			if(id_dec->payload_type == Measurement_value &&
+			  (id_dec->device_addr == arg->dev_addr ||
+			  (arg->dev_addr == Broadcast && id_dec->device_addr && id_dec->device_addr < Parking_address &&
+			   id_dec->channel_num && id_dec->channel_num <= SDAQ_MAX_AMOUNT_OF_CHANNELS)))
+			{
+				rec.rx_time = rx_time;
+				memcpy(&rec.meas, frame_rx.data, sizeof(sdaq_meas));
+				rec.dev_addr = id_dec->device_addr;
+				rec.channel = id_dec->channel_num;
+				if(log_ring_push(&arg->ring, &rec))
+					__atomic_store_n(&arg->dropped_cnt, arg->dropped_cnt+1, __ATOMIC_RELAXED);
+				__atomic_store_n(&arg->rx_cnt, arg->rx_cnt+1, __ATOMIC_RELAXED);
+			}
+		}
+		else if(RX_bytes<0 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR)
+		{
+			perror("Logging RX");
+			//The writer drains the ring and ends, the caller sees the failure at Logging_stats().
+			__atomic_store_n(&arg->rx_error, 1, __ATOMIC_RELEASE);
+			__atomic_store_n(&arg->rx_active, 0, __ATOMIC_RELEASE);
+			break;
+		}
+	}
+	return NULL;
+}
+
+//Thread function. Collect records from the ring, and write them to the log file in batches.
+void *log_writer(void *varg_pt)
+{
+	struct log_thread_arguments *arg = (struct log_thread_arguments *) varg_pt;
+	struct timespec now, last_flush, idle = {.tv_sec = 0, .tv_nsec = LOG_IDLE_SLEEP*1000000};
+	sdaq_log_rec *wr_buff;
+	log_col_buffs *cols = NULL;
+	unsigned int i, amount, buff_cnt = 0;
+	_Bool rx_done, flush_time;
+	int err = 0;
+
+	if(!(wr_buff = malloc(LOG_WR_BATCH*sizeof(sdaq_log_rec))))
+	{
+		fprintf(stderr,"Memory Error\n");
+		exit(EXIT_FAILURE);
+	}
+	if(arg->dev_addr == Broadcast)
+		cols = log_columns_new();
+	clock_gettime(CLOCK_MONOTONIC, &last_flush);
+	while(1)
+	{
+		rx_done = !__atomic_load_n(&arg->rx_active, __ATOMIC_ACQUIRE);//Sampled before the pop, so nothing pushed before the end of RX is missed.
+		amount = log_ring_pop(&arg->ring, wr_buff+buff_cnt, LOG_WR_BATCH-buff_cnt);
+		buff_cnt += amount;
+		if(cols)//Logging of all devices, demultiplex the records to the columns of their device's channel.
+		{
+			for(i=0; i<buff_cnt && !err; i++)
+				err = log_columns_put(arg, cols, wr_buff+i);
+			buff_cnt = 0;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		flush_time = rx_done || (timespec_to_ns(&now)-timespec_to_ns(&last_flush))/1000000 >= LOG_FLUSH_INTERVAL;
+		if(!err && cols)
+		{
+			if(flush_time && (cols->pending || cols->out_len))
+			{
+				err = log_columns_flush(arg, cols);
+				last_flush = now;
+			}
+		}
+		else if(!err && (buff_cnt == LOG_WR_BATCH || (buff_cnt && flush_time)))
+		{
+			if(!(err = write_all(arg->log_fd, wr_buff, buff_cnt*sizeof(sdaq_log_rec))))
+			{
+				__atomic_store_n(&arg->wr_cnt, arg->wr_cnt+buff_cnt, __ATOMIC_RELAXED);
+				buff_cnt = 0;
+				last_flush = now;
+			}
+		}
+		if(err)
+		{
+			perror("Logging write");
+			__atomic_store_n(&arg->wr_error, 1, __ATOMIC_RELEASE);
+			break;
+		}
+		if(!amount)
+		{
+			if(rx_done)
+				break;
+			nanosleep(&idle, NULL);
+		}
+	}
+	if(cols)
+		log_columns_free(cols);
+	free(wr_buff);
+	return NULL;
+}
+
+int log_file_open(const char *dir, unsigned char dev_addr, const char *CANif_name)
+{
+	int fd;
+	char *file_path, date_str[20];
+	struct timespec start_time;
+	struct tm start_tm;
+	char addr_str[4] = "all";
+	sdaq_log_header header = {.magic = SDAQ_LOG_MAGIC,
+							  .version = SDAQ_LOG_VERSION,
+							  .format = log_rows,
+							  .rec_size = sizeof(sdaq_log_rec)};
+
+	if(dev_addr == Broadcast)
+	{
+		header.format = log_columns;
+		header.rec_size = SDAQ_LOG_COL_SAMPLE_SIZE;
+	}
+	else
+		sprintf(addr_str, "%d", dev_addr);
+	clock_gettime(CLOCK_REALTIME, &start_time);
+	localtime_r(&start_time.tv_sec, &start_tm);
+	strftime(date_str, sizeof(date_str), "%Y%m%d-%H%M%S", &start_tm);
+	if(asprintf(&file_path, "%s/SDAQ_%s_%s_%s"SDAQ_LOG_FILE_EXT, dir, CANif_name, addr_str, date_str) < 0)
+	{
+		fprintf(stderr,"Memory Error\n");
+		exit(EXIT_FAILURE);
+	}
+	if((fd = open(file_path, O_WRONLY|O_CREAT|O_EXCL, 0644)) < 0)
+	{
+		perror(file_path);
+		free(file_path);
+		return -1;
+	}
+	header.dev_addr = dev_addr;
+	header.start_time = timespec_to_ns(&start_time);
+	strncpy(header.CANif_name, CANif_name, sizeof(header.CANif_name)-1);
+	if(write_all(fd, &header, sizeof(header)))
+	{
+		perror(file_path);
+		close(fd);
+		fd = -1;
+	}
+	free(file_path);
+	return fd;
+}
+
+int write_all(int fd, const void *buff, size_t len)
+{
+	ssize_t ret;
+	const char *ptr = buff;
+
+	while(len)
+	{
+		if((ret = write(fd, ptr, len)) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			return 1;
+		}
+		ptr += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+log_col_buffs *log_columns_new(void)
+{
+	log_col_buffs *cols;
+
+	if(!(cols = calloc(1, sizeof(log_col_buffs))) || !(cols->out = malloc(LOG_OUT_BUFF_SIZE)))
+	{
+		fprintf(stderr,"Memory Error\n");
+		exit(EXIT_FAILURE);
+	}
+	return cols;
+}
+
+void log_columns_free(log_col_buffs *cols)
+{
+	int i, j;
+
+	for(i=0; i<LOG_AMOUNT_OF_ADDRESSES; i++)
+		for(j=0; j<SDAQ_MAX_AMOUNT_OF_CHANNELS; j++)
+			free(cols->col[i][j]);
+	free(cols->out);
+	free(cols);
+}
+
+//Write the serialized blocks of out to the log file.
+static int log_columns_write(struct log_thread_arguments *arg, log_col_buffs *cols)
+{
+	if(!cols->out_len)
+		return 0;
+	if(write_all(arg->log_fd, cols->out, cols->out_len))
+		return 1;
+	__atomic_store_n(&arg->wr_cnt, arg->wr_cnt+cols->out_samples, __ATOMIC_RELAXED);
+	cols->out_len = 0;
+	cols->out_samples = 0;
+	return 0;
+}
+
+//Serialize the samples of a column as a block at the end of out. out is written first if it has not enough space.
+static int log_column_to_block(struct log_thread_arguments *arg, log_col_buffs *cols, unsigned char dev_addr, unsigned char channel)
+{
+	log_column *col = cols->col[dev_addr-1][channel-1];
+	sdaq_log_col_header block_header = {.dev_addr = dev_addr, .channel = channel, .amount = col->amount};
+	unsigned char *ptr;
+
+	if(cols->out_len + sizeof(block_header) + col->amount*SDAQ_LOG_COL_SAMPLE_SIZE > LOG_OUT_BUFF_SIZE)
+		if(log_columns_write(arg, cols))
+			return 1;
+	ptr = cols->out + cols->out_len;
+	memcpy(ptr, &block_header, sizeof(block_header));
+	ptr += sizeof(block_header);
+	memcpy(ptr, col->rx_time, col->amount*sizeof(*col->rx_time));
+	ptr += col->amount*sizeof(*col->rx_time);
+	memcpy(ptr, col->meas, col->amount*sizeof(*col->meas));
+	ptr += col->amount*sizeof(*col->meas);
+	memcpy(ptr, col->timestamp, col->amount*sizeof(*col->timestamp));
+	ptr += col->amount*sizeof(*col->timestamp);
+	memcpy(ptr, col->unit, col->amount*sizeof(*col->unit));
+	ptr += col->amount*sizeof(*col->unit);
+	memcpy(ptr, col->status, col->amount*sizeof(*col->status));
+	ptr += col->amount*sizeof(*col->status);
+	cols->out_len = ptr - cols->out;
+	cols->out_samples += col->amount;
+	cols->pending -= col->amount;
+	col->amount = 0;
 	return 0;
 }
+
+int log_columns_put(struct log_thread_arguments *arg, log_col_buffs *cols, const sdaq_log_rec *rec)
+{
+	log_column **col_pt = &(cols->col[rec->dev_addr-1][rec->channel-1]), *col;
+
+	if(!*col_pt && !(*col_pt = calloc(1, sizeof(log_column))))
+	{
+		fprintf(stderr,"Memory Error\n");
+		exit(EXIT_FAILURE);
+	}
+	col = *col_pt;
+	col->rx_time[col->amount] = rec->rx_time;
+	col->meas[col->amount] = rec->meas.meas;
+	col->timestamp[col->amount] = rec->meas.timestamp;
+	col->unit[col->amount] = rec->meas.unit;
+	col->status[col->amount] = rec->meas.status;
+	col->amount++;
+	cols->pending++;
+	if(col->amount == LOG_COL_SIZE)
+		return log_column_to_block(arg, cols, rec->dev_addr, rec->channel);
+	return 0;
+}
+
+int log_columns_flush(struct log_thread_arguments *arg, log_col_buffs *cols)
+{
+	int i, j;
+
+	for(i=0; i<LOG_AMOUNT_OF_ADDRESSES && cols->pending; i++)
+		for(j=0; j<SDAQ_MAX_AMOUNT_OF_CHANNELS; j++)
+			if(cols->col[i][j] && cols->col[i][j]->amount)
+				if(log_column_to_block(arg, cols, i+1, j+1))
+					return 1;
+	return log_columns_write(arg, cols);
+}
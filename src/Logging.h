@@ -0,0 +1,85 @@
+/*
+File: Logging.h, Declaration of the binary log format of mode "logging"
+Copyright (C) 12019-12021  Sam harry Tzavaras
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, version 3 of the License, or any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef LOGGING_H
+#define LOGGING_H
+
+#include "SDAQ_drv.h"
+
+#define SDAQ_LOG_MAGIC "SDAQLOG"
+#define SDAQ_LOG_VERSION 1
+#define SDAQ_LOG_FILE_EXT ".sdaqlog"
+
+/*
+ * Layout of a log file (all fields in host byte order):
+ *	log_rows: sdaq_log_header, followed by records of sdaq_log_header.rec_size bytes each (sdaq_log_rec).
+ *	log_columns: sdaq_log_header, followed by blocks. Each block is a sdaq_log_col_header
+ *	             followed by the columns of the block's samples, in order:
+ *	             rx_time[amount], meas[amount], timestamp[amount], unit[amount], status[amount].
+ *	             sdaq_log_header.rec_size is the size of one sample over all the columns.
+ */
+enum SDAQ_log_format{
+	log_rows = 1, //Fixed-width sdaq_log_rec records in reception order.
+	log_columns //Blocks of samples of one device's channel, in columnar order. Used for logging of all devices.
+};
+
+#pragma pack(push, 1)//use pragma pack() to pack the following structs to 1 byte size (aka no zero padding)
+
+/* Header at the start of every log file */
+typedef struct SDAQ_log_file_header{
+	char magic[8];//SDAQ_LOG_MAGIC, null terminated
+	unsigned char version;
+	unsigned char format;//enum SDAQ_log_format
+	unsigned char dev_addr;//Address of the logged SDAQ, Broadcast for logging of all devices
+	unsigned char rec_size;//sizeof(sdaq_log_rec)
+	unsigned long long start_time;//Logging start time, nsec since Epoch
+	char CANif_name[16];
+}sdaq_log_header;
+
+/* Record of a decoded measurement message */
+typedef struct SDAQ_log_record{
+	unsigned long long rx_time;//Host reception time, nsec since Epoch
+	sdaq_meas meas;//Decoded payload of the Measurement_value message
+	unsigned char dev_addr;
+	unsigned char channel;
+}sdaq_log_rec;
+
+/* Header of a block of samples, used with format log_columns */
+typedef struct SDAQ_log_column_block_header{
+	unsigned char dev_addr;
+	unsigned char channel;
+	unsigned short amount;//Amount of samples in the block
+}sdaq_log_col_header;
+
+#define SDAQ_LOG_COL_SAMPLE_SIZE (sizeof(unsigned long long)+sizeof(float)+sizeof(unsigned short)+2*sizeof(unsigned char))
+
+#pragma pack(pop)//Disable packing
+
+//Logging session, receiver and writer threads of a log file.
+typedef struct log_thread_arguments SDAQ_log_session;
+
+/*
+ * Function that start the logging of the SDAQ at dev_addr (Broadcast for all the SDAQs) from socket_num,
+ * to a new log file at logging_dir. The threads of the session started with all the signals blocked.
+ * Return: The session, or NULL on failure.
+ */
+SDAQ_log_session *Logging_start(int socket_num, unsigned char dev_addr, const char *logging_dir, const char *CANif_name);
+//Function that get the counters of session. Counter arguments are nullable. Return: Non zero if the receiver or the writer of session is failed.
+int Logging_stats(const SDAQ_log_session *session, unsigned long long *rx_cnt, unsigned long long *wr_cnt, unsigned long long *dropped_cnt);
+//Function that stop and free session. Return: EXIT_SUCCESS, or EXIT_FAILURE on error at reception or at writing of the log file.
+int Logging_stop(SDAQ_log_session *session);
+
+#endif //LOGGING_H
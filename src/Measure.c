@@ -197,6 +197,7 @@ void * CAN_socket_RX(void *varg_pt)
 	//local variables for CAN Socket frame and SDAQ messages decoders
 	unsigned char dev_type = 0;
 	char timediff_str[20];
+	SDAQ_rx_batch rx;
 	struct can_frame frame_rx;
 	int RX_bytes;
 	sdaq_can_id *id_dec = (sdaq_can_id *)&(frame_rx.can_id);
@@ -205,9 +206,10 @@ void * CAN_socket_RX(void *varg_pt)
 	sdaq_info *info_dec = (sdaq_info *)frame_rx.data;
 	sdaq_sysvar *sysvar_dec = (sdaq_sysvar *)frame_rx.data;
 	sdaq_sync_debug_data *ts_dec = (sdaq_sync_debug_data *)frame_rx.data;
+	SDAQ_rx_init(&rx, arg->socket_num);
 	while(running)
 	{
-		RX_bytes=read(arg->socket_num, &frame_rx, sizeof(frame_rx));
+		RX_bytes=SDAQ_rx(&rx, &frame_rx, NULL);
 		if(RX_bytes==sizeof(frame_rx))
 		{
 			if(arg->dev_addr==id_dec->device_addr)
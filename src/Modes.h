@@ -28,20 +28,24 @@ typedef struct option_flags{
 	char *timestamp_format;
 	char *info_file;
 	char *ext_com;
+	char *logging_dir;
 	unsigned silent : 1;
 	unsigned formatted_output :1;
 	unsigned verify : 1;
 	unsigned resize : 1;
+	unsigned no_registry : 1;//Bypass the registry of the known SDAQs.
+	unsigned no_daemon : 1;//Access the CAN-IF directly, even if a daemon serves it.
+	unsigned delta : 1;//Upload to the SDAQ only the differences of the calibration.
 	unsigned int timeout;
+	unsigned int expected_devs;//Amount of SDAQs that ends a bus scan, 0 for unknown.
 }opt_flags;
 
-/*The following two type defs structs used in info.c file and SDAQ_xml.c*/
+/*The following type defs structs used in info.c file and SDAQ_xml.c*/
 /*	Struct SDAQ_information_and_calibration_data
 		used in mode info and calibration.
 		Contains:
 			 internal struct SDAQ info.
-			 A List with calibration points data (aka sdaq_calibration_data) for each channel
-			 A list with dates and amount of data (aka sdaq_calibration_date) for each channel
+			 The calibration model (aka SDAQ_cal_model) with the dates and the points data of all the channels
 */
 typedef struct SDAQ_information_and_calibration_data{
 	struct SDAQ_info{
@@ -52,12 +56,12 @@ typedef struct SDAQ_information_and_calibration_data{
 		unsigned char num_of_ch;
 		unsigned char sample_rate;
 		unsigned char max_cal_point;
+		unsigned char status;//Status byte, as received with the serial number.
 	}SDAQ_info;
-	struct GSList *Calibration_date_list; //list with data type date_list_data_of_node
-	struct GSList **Cal_points_data_lists;//array of lists with data type sdaq_calibration_points_data
+	struct SDAQ_calibration_model *cal;//Nullable, allocated with the first date or point.
 }SDAQ_info_cal_data;
 
-//struct used as container type for the data of the Calibration_date_list
+//struct used as container type for the calibration date of a channel
 typedef struct calibration_date{
 	unsigned char ch_num;
 	unsigned char year;//after 12000
@@ -68,11 +72,34 @@ typedef struct calibration_date{
 	unsigned char cal_unit;
 }date_list_data_of_node;
 
+#define CAL_POINT_COMPLETE ((1<<MAX_DATA_ON_POINT)-1) //Value of point_valid for a point with all its data
+/*
+ * Calibration model of an SDAQ, allocated as one block. Indexed by channel (0 for CH1), point and type (0 for meas).
+ * date_valid and point_valid are the presence bitmaps of the dates and the data of the points.
+ */
+typedef struct SDAQ_calibration_model{
+	unsigned int date_valid;//Bitmap of the channels with received calibration date, bit 0 for CH1.
+	date_list_data_of_node date[SDAQ_MAX_AMOUNT_OF_CHANNELS];
+	unsigned char point_valid[SDAQ_MAX_AMOUNT_OF_CHANNELS][MAX_AMOUNT_OF_POINTS];//Bitmap of the data of each point, bit 0 for type meas.
+	float point[SDAQ_MAX_AMOUNT_OF_CHANNELS][MAX_AMOUNT_OF_POINTS][MAX_DATA_ON_POINT];
+}SDAQ_cal_model;
+
 /*All the functions return EXIT_SUCCESS at success and EXIT_FAILURE on failure*/
 
 //Declaration of function for Discovery mode. Implemented at Discover_and_autoconfig.c
 int Discover(int socket_num, opt_flags *usr_flag);
 
+//Declaration of function that print the report of Discovery mode for amount SDAQs, given as arrays. Implemented at Discover_and_autoconfig.c
+int Discover_report(unsigned int amount, const unsigned int *serial_number, const unsigned char *address, const unsigned char *dev_type, opt_flags *usr_flag);
+
+/*
+ * Declaration of function that scan the bus for SDAQs. Implemented at Discover_and_autoconfig.c
+ * serial_number: Array of 64 entries, filled with the serial number of the SDAQ at each returned address.
+ * conflicts: Nullable, filled with the bitmap of the addresses with more than one SDAQ.
+ * Return: Bitmap of the addresses (bit n for address n) with exactly one SDAQ, Broadcast and Parking excluded.
+ */
+unsigned long long Discover_scan(int socket_num, unsigned int *serial_number, unsigned long long *conflicts, opt_flags *usr_flag);
+
 //Declaration of function for Autoconf mode. Implemented at Discover_and_autoconfig.c
 int Autoconfig(int socket_num, opt_flags *usr_flag);
 
@@ -90,3 +117,13 @@ int getinfo(int socket_num,unsigned char dev_addr, opt_flags *usr_flag);
 
 //Declaration of function for SetInfo mode. Implemented at Dev_info.c
 int setinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag);
+
+//Declaration of function for Daemon mode. Implemented at Daemon.c
+int Daemon(int socket_num, opt_flags *usr_flag);
+
+/*
+ * Declaration of function that forward a request of a mode to the daemon of usr_flag->CANif_name. Implemented at Daemon.c
+ * The output of the request is printed at stdout. Mode 'logging' without logging_dir stops the logging of the daemon.
+ * Return: The exit code of the request, or -1 if the mode is not served or there is no daemon.
+ */
+int Daemon_request(const char *mode, unsigned char dev_addr, unsigned int serial_number, opt_flags *usr_flag);
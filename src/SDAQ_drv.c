@@ -14,14 +14,22 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
+#define _GNU_SOURCE
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 #include <math.h>
 #include <time.h>
 
+#include <poll.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <arpa/inet.h>
 #include <linux/can.h>
 #include <linux/can/raw.h>
@@ -148,6 +156,462 @@ const char * status_byte_dec(unsigned char status_byte,unsigned char field)
 }
 
 				/*TX Functions*/
+/*	Filter for CAN messages	-- SocketCAN Filters act as: <received_can_id> & mask == can_id & mask	*/
+void SDAQ_filter_build(struct can_filter *filter, enum SDAQ_msg_direction dir, unsigned char dev_address, unsigned char payload_type)
+{
+	sdaq_can_id *can_filter_enc;
+
+	//load filter's can_id member
+	can_filter_enc = (sdaq_can_id *)&filter->can_id;//Set encoder to filter.can_id
+	memset(can_filter_enc, 0, sizeof(sdaq_can_id));
+	can_filter_enc->flags = 4;//set the EFF
+	can_filter_enc->protocol_id = PROTOCOL_ID; // Received Messages with protocol_id == PROTOCOL_ID
+	can_filter_enc->payload_type = payload_type ? payload_type : dir; // Exact payload type, or only the direction bit.
+	can_filter_enc->device_addr = dev_address;
+	//load filter's can_mask member
+	can_filter_enc = (sdaq_can_id *)&filter->can_mask; //Set encoder to filter.can_mask
+	memset(can_filter_enc, 0, sizeof(sdaq_can_id));
+	can_filter_enc->flags = 4;//Received only messages with extended ID (29bit)
+	can_filter_enc->protocol_id = -1; // Protocol_id field marked for examination
+	can_filter_enc->payload_type = payload_type ? -1 : 0x80; // Examine all the payload type, or only the most significant bit(direction).
+	if(dev_address != Broadcast)
+		can_filter_enc->device_addr = -1; // Mark device_addr field to be examined.
+}
+
+int SDAQ_socket_open(const char *CANif_name, const struct can_filter *filters, unsigned int amount_of_filters, unsigned int timeout)
+{
+	int socket_num;
+	struct sockaddr_can addr = {0};
+	struct timeval tv = {.tv_sec = timeout, .tv_usec = 0};
+
+	if(!amount_of_filters || amount_of_filters > SDAQ_MAX_FILTERS)
+		return -1;
+	//CAN Socket Opening
+	if((socket_num = socket(PF_CAN, SOCK_RAW, CAN_RAW)) < 0)
+	{
+		perror("Error while opening socket");
+		return -1;
+	}
+	//Link interface name to socket
+	if(!(addr.can_ifindex = if_nametoindex(CANif_name)))
+	{
+		perror("CAN-IF");
+		close(socket_num);
+		return -1;
+	}
+	setsockopt(socket_num, SOL_CAN_RAW, CAN_RAW_FILTER, filters, amount_of_filters*sizeof(struct can_filter));
+	// Add timeout option to the CAN Socket
+	if(timeout)
+		setsockopt(socket_num, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+	//Bind CAN Socket to address
+	addr.can_family = AF_CAN;
+	if(bind(socket_num, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		perror("Error in socket bind");
+		close(socket_num);
+		return -1;
+	}
+	return socket_num;
+}
+
+void SDAQ_rx_init(SDAQ_rx_batch *rx, int socket_fd)
+{
+	const int enable = 1;
+
+	rx->socket_fd = socket_fd;
+	rx->amount = 0;
+	rx->index = 0;
+	setsockopt(socket_fd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+}
+
+int SDAQ_rx(SDAQ_rx_batch *rx, struct can_frame *frame, unsigned long long *timestamp)
+{
+	struct timespec rx_time;
+	struct mmsghdr msgs[SDAQ_RX_BATCH_SIZE];
+	struct iovec iovs[SDAQ_RX_BATCH_SIZE];
+	struct cmsghdr *cmsg;
+	int i, ret;
+
+	if(rx->index >= rx->amount)//No pending frames, receive a new batch.
+	{
+		memset(msgs, 0, sizeof(msgs));
+		for(i=0; i<SDAQ_RX_BATCH_SIZE; i++)
+		{
+			iovs[i].iov_base = &rx->frames[i];
+			iovs[i].iov_len = sizeof(struct can_frame);
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_control = rx->ctrl[i];
+			msgs[i].msg_hdr.msg_controllen = SDAQ_RX_CTRL_SIZE;
+		}
+		//Block until the first frame, and then get all the already received ones.
+		if((ret = recvmmsg(rx->socket_fd, msgs, SDAQ_RX_BATCH_SIZE, MSG_WAITFORONE, NULL)) <= 0)
+			return -1;
+		rx->amount = 0;
+		rx->index = 0;
+		for(i=0; i<ret; i++)
+		{
+			if(msgs[i].msg_len != sizeof(struct can_frame))//Skip incomplete frames.
+				continue;
+			if(rx->amount != i)
+				rx->frames[rx->amount] = rx->frames[i];
+			rx_time.tv_sec = 0;
+			for(cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg))
+				if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPNS)
+					memcpy(&rx_time, CMSG_DATA(cmsg), sizeof(struct timespec));
+			if(!rx_time.tv_sec)//Timestamp not available from kernel.
+				clock_gettime(CLOCK_REALTIME, &rx_time);
+			rx->timestamps[rx->amount] = rx_time.tv_sec*1000000000ULL + rx_time.tv_nsec;
+			rx->amount++;
+		}
+		if(!rx->amount)
+		{
+			errno = EAGAIN;
+			return -1;
+		}
+	}
+	*frame = rx->frames[rx->index];
+	if(timestamp)
+		*timestamp = rx->timestamps[rx->index];
+	rx->index++;
+	return sizeof(struct can_frame);
+}
+
+int SDAQ_deadline_init(SDAQ_deadline *dl, SDAQ_rx_batch *rx)
+{
+	struct epoll_event ev = {.events = EPOLLIN};
+
+	dl->rx = rx;
+	dl->timer_fd = -1;
+	if((dl->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+		return -1;
+	if((dl->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC|TFD_NONBLOCK)) < 0)
+	{
+		SDAQ_deadline_close(dl);
+		return -1;
+	}
+	ev.data.fd = rx->socket_fd;
+	if(epoll_ctl(dl->epoll_fd, EPOLL_CTL_ADD, rx->socket_fd, &ev))
+	{
+		SDAQ_deadline_close(dl);
+		return -1;
+	}
+	ev.data.fd = dl->timer_fd;
+	if(epoll_ctl(dl->epoll_fd, EPOLL_CTL_ADD, dl->timer_fd, &ev))
+	{
+		SDAQ_deadline_close(dl);
+		return -1;
+	}
+	return 0;
+}
+
+void SDAQ_deadline_set(SDAQ_deadline *dl, unsigned long long msec)
+{
+	struct itimerspec its = {0};
+
+	its.it_value.tv_sec = msec / 1000;
+	its.it_value.tv_nsec = (msec % 1000) * 1000000;
+	timerfd_settime(dl->timer_fd, 0, &its, NULL);
+}
+
+void SDAQ_deadline_at(SDAQ_deadline *dl, unsigned long long mono_msec)
+{
+	struct itimerspec its = {0};
+
+	its.it_value.tv_sec = mono_msec / 1000;
+	its.it_value.tv_nsec = (mono_msec % 1000) * 1000000;
+	if(!mono_msec)//Zero disarms the timer, the epoch of CLOCK_MONOTONIC is already past.
+		its.it_value.tv_nsec = 1;
+	timerfd_settime(dl->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+int SDAQ_deadline_rx(SDAQ_deadline *dl, struct can_frame *frame, unsigned long long *timestamp)
+{
+	struct epoll_event ev[2];
+	unsigned long long expirations;
+	int i, ret;
+
+	while(!SDAQ_rx_pending(dl->rx))
+	{
+		if((ret = epoll_wait(dl->epoll_fd, ev, 2, -1)) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+		for(i=0; i<ret; i++)
+			if(ev[i].data.fd == dl->timer_fd && read(dl->timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+				return 0;
+		for(i=0; i<ret; i++)
+			if(ev[i].data.fd == dl->rx->socket_fd)
+				return SDAQ_rx(dl->rx, frame, timestamp);
+	}
+	return SDAQ_rx(dl->rx, frame, timestamp);
+}
+
+void SDAQ_deadline_close(SDAQ_deadline *dl)
+{
+	if(dl->timer_fd >= 0)
+		close(dl->timer_fd);
+	if(dl->epoll_fd >= 0)
+		close(dl->epoll_fd);
+	dl->timer_fd = -1;
+	dl->epoll_fd = -1;
+}
+
+static inline unsigned long long mono_time_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000ULL + now.tv_nsec/1000000;
+}
+
+int SDAQ_trans_engine_init(SDAQ_trans_engine *eng, int socket_fd)
+{
+	eng->socket_fd = socket_fd;
+	eng->in_flight = NULL;
+	eng->amount = 0;
+	eng->submissions = 0;
+	SDAQ_rx_init(&eng->rx, socket_fd);
+	return SDAQ_deadline_init(&eng->dl, &eng->rx);
+}
+
+//Remove trans from the in-flight list of eng, and report its result.
+static void SDAQ_trans_complete(SDAQ_trans_engine *eng, SDAQ_trans *trans, enum SDAQ_trans_result result)
+{
+	SDAQ_trans **pp;
+
+	for(pp = &eng->in_flight; *pp; pp = &(*pp)->next)
+		if(*pp == trans)
+		{
+			*pp = trans->next;
+			eng->amount--;
+			break;
+		}
+	trans->next = NULL;
+	trans->result = result;
+	if(trans->on_done)
+		trans->on_done(trans, result);
+}
+
+void SDAQ_trans_engine_close(SDAQ_trans_engine *eng)
+{
+	while(eng->in_flight)
+		SDAQ_trans_complete(eng, eng->in_flight, SDAQ_trans_failed);
+	SDAQ_deadline_close(&eng->dl);
+}
+
+int SDAQ_trans_submit(SDAQ_trans_engine *eng, SDAQ_trans *trans)
+{
+	SDAQ_trans **pp;
+
+	trans->attempt = 0;
+	trans->next = NULL;
+	if(trans->request(eng->socket_fd, trans))
+	{
+		trans->result = SDAQ_trans_failed;
+		return 1;
+	}
+	trans->result = SDAQ_trans_pending;
+	trans->deadline = mono_time_ms() + trans->timeout;
+	trans->seq = ++eng->submissions;
+	for(pp = &eng->in_flight; *pp; pp = &(*pp)->next)
+		;
+	*pp = trans;
+	eng->amount++;
+	return 0;
+}
+
+//Dispatch frame to the in-flight transactions of eng that expect it.
+static void SDAQ_trans_dispatch(SDAQ_trans_engine *eng, const struct can_frame *frame)
+{
+	const sdaq_can_id *id_dec = (const sdaq_can_id *)&(frame->can_id);
+	SDAQ_trans *trans, *next;
+	unsigned long long last_seq = eng->submissions;
+	int ret = 0;
+
+	if(!(id_dec->payload_type & SDAQ_to_Master))
+		return;
+	for(trans = eng->in_flight; trans; trans = next)
+	{
+		next = trans->next;//trans can leave the list.
+		//Transactions submitted by on_done during the dispatch are after the frame.
+		if(trans->seq > last_seq)
+			break;
+		if(trans->dev_addr != id_dec->device_addr || !(trans->reply_set & SDAQ_REPLY(id_dec->payload_type)))
+			continue;
+		if(trans->channel && id_dec->channel_num && trans->channel != id_dec->channel_num)
+			continue;
+		if(!trans->on_reply || (ret = trans->on_reply(trans, frame)) > 0)
+			SDAQ_trans_complete(eng, trans, SDAQ_trans_done);
+		else if(ret < 0)
+			SDAQ_trans_complete(eng, trans, SDAQ_trans_failed);
+	}
+}
+
+//Retry or time out the in-flight transactions of eng with expired deadline.
+static void SDAQ_trans_expire(SDAQ_trans_engine *eng)
+{
+	unsigned long long now = mono_time_ms();
+	SDAQ_trans *trans, *next;
+
+	for(trans = eng->in_flight; trans; trans = next)
+	{
+		next = trans->next;
+		if(trans->deadline > now)
+			continue;
+		if(trans->attempt >= trans->retries)
+			SDAQ_trans_complete(eng, trans, SDAQ_trans_timeout);
+		else
+		{
+			trans->attempt++;
+			if(trans->on_reply)
+				trans->on_reply(trans, NULL);
+			if(trans->request(eng->socket_fd, trans))
+				SDAQ_trans_complete(eng, trans, SDAQ_trans_failed);
+			else
+				trans->deadline = now + trans->timeout;
+		}
+	}
+}
+
+int SDAQ_trans_step(SDAQ_trans_engine *eng)
+{
+	return SDAQ_trans_step_until(eng, 0);
+}
+
+int SDAQ_trans_step_until(SDAQ_trans_engine *eng, unsigned long long wake_at)
+{
+	struct can_frame frame;
+	unsigned long long nearest = wake_at;
+	SDAQ_trans *trans;
+	int ret;
+
+	if(!eng->in_flight && !wake_at)
+		return 0;
+	for(trans = eng->in_flight; trans; trans = trans->next)
+		if(!nearest || trans->deadline < nearest)
+			nearest = trans->deadline;
+	SDAQ_deadline_at(&eng->dl, nearest);
+	if((ret = SDAQ_deadline_rx(&eng->dl, &frame, NULL)) == sizeof(frame))
+		SDAQ_trans_dispatch(eng, &frame);
+	else if(ret < 0 && errno != EAGAIN)
+		return -1;
+	SDAQ_trans_expire(eng);
+	return eng->amount;
+}
+
+int SDAQ_trans_wait(SDAQ_trans_engine *eng)
+{
+	int ret;
+
+	while((ret = SDAQ_trans_step(eng)) > 0)
+		;
+	return ret;
+}
+
+int SDAQ_trans_req_info(int socket_fd, SDAQ_trans *trans)
+{
+	return QueryDeviceInfo(socket_fd, trans->dev_addr);
+}
+
+int SDAQ_trans_req_cal_data(int socket_fd, SDAQ_trans *trans)
+{
+	return QueryCalibrationData(socket_fd, trans->dev_addr, trans->channel);
+}
+
+int SDAQ_trans_req_sysvar(int socket_fd, SDAQ_trans *trans)
+{
+	return QuerySystemVariables(socket_fd, trans->dev_addr);
+}
+
+void SDAQ_tx_init(SDAQ_tx_batch *tx, int socket_fd, unsigned int burst, unsigned int gap)
+{
+	tx->socket_fd = socket_fd;
+	tx->amount = 0;
+	tx->sent = 0;
+	tx->retries = 0;
+	tx->burst = burst;
+	tx->gap = gap;
+}
+
+struct can_frame *SDAQ_tx_frame(SDAQ_tx_batch *tx)
+{
+	struct can_frame *frame;
+
+	if(tx->amount >= SDAQ_TX_BATCH_SIZE && SDAQ_tx_flush(tx))
+		return NULL;
+	frame = &tx->frames[tx->amount++];
+	memset(frame, 0, sizeof(struct can_frame));
+	return frame;
+}
+
+int SDAQ_tx_send_burst(SDAQ_tx_batch *tx)
+{
+	struct mmsghdr msgs[SDAQ_TX_BATCH_SIZE];
+	struct iovec iovs[SDAQ_TX_BATCH_SIZE];
+	unsigned int i, burst_len = SDAQ_tx_pending(tx);
+	int ret;
+
+	if(tx->burst && burst_len > tx->burst)
+		burst_len = tx->burst;
+	if(burst_len == 1)//Single frame, plain send() as the single frame writes.
+		ret = send(tx->socket_fd, &tx->frames[tx->sent], sizeof(struct can_frame), MSG_DONTWAIT) == sizeof(struct can_frame) ? 1 : -1;
+	else if(burst_len)
+	{
+		memset(msgs, 0, burst_len*sizeof(struct mmsghdr));
+		for(i=0; i<burst_len; i++)
+		{
+			iovs[i].iov_base = &tx->frames[tx->sent+i];
+			iovs[i].iov_len = sizeof(struct can_frame);
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		ret = sendmmsg(tx->socket_fd, msgs, burst_len, MSG_DONTWAIT);
+	}
+	if(burst_len && ret <= 0)
+	{
+		//CAN-IF's TX queue is full, frames remain queued for retry.
+		if((errno == ENOBUFS || errno == EAGAIN || errno == EINTR) && tx->retries++ < SDAQ_TX_MAX_RETRIES)
+			return SDAQ_tx_pending(tx);
+		ret = -1;
+	}
+	else
+	{
+		tx->sent += burst_len ? ret : 0;
+		tx->retries = 0;
+		if((ret = SDAQ_tx_pending(tx)))
+			return ret;
+	}
+	tx->amount = 0;
+	tx->sent = 0;
+	tx->retries = 0;
+	return ret;
+}
+
+int SDAQ_tx_flush(SDAQ_tx_batch *tx)
+{
+	struct pollfd pfd = {.fd = tx->socket_fd, .events = POLLOUT};
+	unsigned int last_sent;
+
+	while(SDAQ_tx_pending(tx))
+	{
+		last_sent = tx->sent;
+		if(SDAQ_tx_send_burst(tx) < 0)
+			return 1;
+		if(SDAQ_tx_pending(tx) && tx->sent == last_sent)
+		{
+			//No progress, wait for space at CAN-IF's TX queue and retry.
+			poll(&pfd, 1, SDAQ_TX_BACKOFF);
+			continue;
+		}
+		if(tx->gap)
+			usleep(tx->gap);
+	}
+	return 0;
+}
+
 //Synchronize the SDAQ devices. Requested by broadcast only.
 int Sync(int socket_fd, unsigned short time_seed)
 {
@@ -289,11 +753,35 @@ int Req_Raw_meas(int socket_fd,unsigned char dev_address,const unsigned char Con
 //Write the calibration date data of the channel 'channel_num' of the SDAQ with address 'dev_address'
 int WriteCalibrationDate(int socket_fd, unsigned char dev_address, unsigned char channel_num, void *date_ptr, unsigned char period, unsigned char NumOfPoints, unsigned char unit)
 {
-	struct can_frame frame_tx = {0};
+	SDAQ_tx_batch tx;
+
+	SDAQ_tx_init(&tx, socket_fd, SDAQ_CAL_TX_BURST, SDAQ_CAL_TX_GAP);
+	if(SDAQ_tx_WriteCalibrationDate(&tx, dev_address, channel_num, date_ptr, period, NumOfPoints, unit))
+		return 1;
+	return SDAQ_tx_flush(&tx);
+}
+//Write the calibration point data 'NumOfPoint' of the channel 'channel_num' of the SDAQ with address 'dev_address'
+int WriteCalibrationPoint(int socket_fd, unsigned char dev_address, unsigned char channel_num, float point_val, unsigned char point_num, unsigned char type)
+{
+	SDAQ_tx_batch tx;
+
+	SDAQ_tx_init(&tx, socket_fd, SDAQ_CAL_TX_BURST, SDAQ_CAL_TX_GAP);
+	if(SDAQ_tx_WriteCalibrationPoint(&tx, dev_address, channel_num, point_val, point_num, type))
+		return 1;
+	return SDAQ_tx_flush(&tx);
+}
+//Queue the calibration date data of the channel 'channel_num' of the SDAQ with address 'dev_address'
+int SDAQ_tx_WriteCalibrationDate(SDAQ_tx_batch *tx, unsigned char dev_address, unsigned char channel_num, void *date_ptr, unsigned char period, unsigned char NumOfPoints, unsigned char unit)
+{
+	struct can_frame *frame_tx;
 	struct tm *date = date_ptr;
-	sdaq_calibration_date *sdaq_cal_date_enc = (sdaq_calibration_date*) frame_tx.data;
-	sdaq_can_id *sdaq_id_ptr = (sdaq_can_id *)&(frame_tx.can_id);
+	sdaq_calibration_date *sdaq_cal_date_enc;
+	sdaq_can_id *sdaq_id_ptr;
 
+	if(!(frame_tx = SDAQ_tx_frame(tx)))
+		return 1;
+	sdaq_cal_date_enc = (sdaq_calibration_date*) frame_tx->data;
+	sdaq_id_ptr = (sdaq_can_id *)&(frame_tx->can_id);
 	//construct identifier for "Write_calibration_Date" command
 	sdaq_id_ptr->flags = 4;//set the EFF
 	sdaq_id_ptr->priority = 4;//From the SDAQ White paper
@@ -301,39 +789,37 @@ int WriteCalibrationDate(int socket_fd, unsigned char dev_address, unsigned char
 	sdaq_id_ptr->payload_type = Write_calibration_Date;//Payload type for "Write_calibration_Date" command
 	sdaq_id_ptr->device_addr = dev_address;
 	sdaq_id_ptr->channel_num = channel_num;
-	frame_tx.can_dlc = sizeof(sdaq_calibration_date);//Payload size
+	frame_tx->can_dlc = sizeof(sdaq_calibration_date);//Payload size
 	sdaq_cal_date_enc->year = date->tm_year - 100;//100 = 2000-1900
 	sdaq_cal_date_enc->month = date->tm_mon + 1;
 	sdaq_cal_date_enc->day = date->tm_mday;
 	sdaq_cal_date_enc->period = period;
 	sdaq_cal_date_enc->amount_of_points = NumOfPoints;
 	sdaq_cal_date_enc->cal_units = unit;
-	if(write(socket_fd, &frame_tx, sizeof(struct can_frame))<0)
-		return 1;
-	usleep(10000);
 	return 0;
 }
-//Write the calibration point data 'NumOfPoint' of the channel 'channel_num' of the SDAQ with address 'dev_address'
-int WriteCalibrationPoint(int socket_fd, unsigned char dev_address, unsigned char channel_num, float point_val, unsigned char point_num, unsigned char type)
+//Queue the calibration point data 'NumOfPoint' of the channel 'channel_num' of the SDAQ with address 'dev_address'
+int SDAQ_tx_WriteCalibrationPoint(SDAQ_tx_batch *tx, unsigned char dev_address, unsigned char channel_num, float point_val, unsigned char point_num, unsigned char type)
 {
-	struct can_frame frame_tx = {0};
-	sdaq_calibration_points_data *sdaq_cal_point_data_enc = (sdaq_calibration_points_data*) frame_tx.data;
-	sdaq_can_id *sdaq_id_ptr = (sdaq_can_id *)&(frame_tx.can_id);
+	struct can_frame *frame_tx;
+	sdaq_calibration_points_data *sdaq_cal_point_data_enc;
+	sdaq_can_id *sdaq_id_ptr;
 
-	//construct identifier for "Write_calibration_Date" command
+	if(!(frame_tx = SDAQ_tx_frame(tx)))
+		return 1;
+	sdaq_cal_point_data_enc = (sdaq_calibration_points_data*) frame_tx->data;
+	sdaq_id_ptr = (sdaq_can_id *)&(frame_tx->can_id);
+	//construct identifier for "Write_calibration_Point_Data" command
 	sdaq_id_ptr->flags = 4;//set the EFF
 	sdaq_id_ptr->priority = 4;//From the SDAQ White paper
 	sdaq_id_ptr->protocol_id = PROTOCOL_ID;
 	sdaq_id_ptr->payload_type = Write_calibration_Point_Data;//Payload type for "Write_calibration_Point_Data" command
 	sdaq_id_ptr->device_addr = dev_address;
 	sdaq_id_ptr->channel_num = channel_num;
-	frame_tx.can_dlc = sizeof(sdaq_calibration_points_data);//Payload size
+	frame_tx->can_dlc = sizeof(sdaq_calibration_points_data);//Payload size
 	sdaq_cal_point_data_enc->data_of_point = point_val;
 	sdaq_cal_point_data_enc->type = type;
 	sdaq_cal_point_data_enc->points_num = point_num;
-	if(write(socket_fd, &frame_tx, sizeof(struct can_frame))<0)
-		return 1;
-	usleep(10000);
 	return 0;
 }
 
@@ -395,34 +881,58 @@ int SDAQ_write_header(int socket_fd, unsigned char dev_address, unsigned int sta
 //Write to page buffer.
 int SDAQ_write_page_buff(int socket_fd, unsigned char dev_address, unsigned char *data)
 {
-	struct can_frame frame_tx = {0};
-	sdaq_can_id *sdaq_id_ptr = (sdaq_can_id *)&(frame_tx.can_id);
+	SDAQ_tx_batch tx;
 
-	//construct identifier for "Write_to_page_buff" command.
-	sdaq_id_ptr->flags = 4;//set the EFF
-	sdaq_id_ptr->priority = 0;
-	sdaq_id_ptr->protocol_id = PROTOCOL_ID;
-	sdaq_id_ptr->payload_type = Write_to_page_buff;
-	sdaq_id_ptr->device_addr = dev_address;
-	frame_tx.can_dlc = 8;//Maximum Payload size
-	//Load data to payload and send
-	do{
-		memcpy(frame_tx.data, data, frame_tx.can_dlc);
-		usleep(1000);//Delay to prevent FIFO overflow.
-		if(write(socket_fd, &frame_tx, sizeof(struct can_frame))<0)
-			return 1;
-		sdaq_id_ptr->channel_num++;
-		data += frame_tx.can_dlc;
-	}while(sdaq_id_ptr->channel_num<PAGE_SECTIONS);
-	return 0;
+	SDAQ_tx_init(&tx, socket_fd, SDAQ_PAGE_TX_BURST, SDAQ_PAGE_TX_GAP);
+	if(SDAQ_tx_write_page_buff(&tx, dev_address, data))
+		return 1;
+	return SDAQ_tx_flush(&tx);
 }
 //Transfer page buffer to Flash memory.
 int SDAQ_Transfer_to_flash(int socket_fd, unsigned char dev_address, unsigned int addr)
 {
-	struct can_frame frame_tx = {0};
-	sdaq_transfer_buffer *sdaq_transfer_buffer_enc = (sdaq_transfer_buffer*) frame_tx.data;
-	sdaq_can_id *sdaq_id_ptr = (sdaq_can_id *)&(frame_tx.can_id);
+	SDAQ_tx_batch tx;
+
+	SDAQ_tx_init(&tx, socket_fd, 0, 0);
+	if(SDAQ_tx_Transfer_to_flash(&tx, dev_address, addr))
+		return 1;
+	return SDAQ_tx_flush(&tx);
+}
+//Queue the PAGE_SIZE bytes of data to page buffer.
+int SDAQ_tx_write_page_buff(SDAQ_tx_batch *tx, unsigned char dev_address, unsigned char *data)
+{
+	struct can_frame *frame_tx;
+	sdaq_can_id *sdaq_id_ptr;
 
+	for(int section=0; section<PAGE_SECTIONS; section++)
+	{
+		if(!(frame_tx = SDAQ_tx_frame(tx)))
+			return 1;
+		sdaq_id_ptr = (sdaq_can_id *)&(frame_tx->can_id);
+		//construct identifier for "Write_to_page_buff" command.
+		sdaq_id_ptr->flags = 4;//set the EFF
+		sdaq_id_ptr->priority = 0;
+		sdaq_id_ptr->protocol_id = PROTOCOL_ID;
+		sdaq_id_ptr->payload_type = Write_to_page_buff;
+		sdaq_id_ptr->device_addr = dev_address;
+		sdaq_id_ptr->channel_num = section;
+		frame_tx->can_dlc = 8;//Maximum Payload size
+		memcpy(frame_tx->data, data, frame_tx->can_dlc);
+		data += frame_tx->can_dlc;
+	}
+	return 0;
+}
+//Queue transfer of page buffer to Flash memory.
+int SDAQ_tx_Transfer_to_flash(SDAQ_tx_batch *tx, unsigned char dev_address, unsigned int addr)
+{
+	struct can_frame *frame_tx;
+	sdaq_transfer_buffer *sdaq_transfer_buffer_enc;
+	sdaq_can_id *sdaq_id_ptr;
+
+	if(!(frame_tx = SDAQ_tx_frame(tx)))
+		return 1;
+	sdaq_transfer_buffer_enc = (sdaq_transfer_buffer*) frame_tx->data;
+	sdaq_id_ptr = (sdaq_can_id *)&(frame_tx->can_id);
 	//construct identifier for "Write_page_buff_to_flash" command.
 	sdaq_id_ptr->flags = 4;//set the EFF
 	sdaq_id_ptr->priority = 0;
@@ -430,10 +940,8 @@ int SDAQ_Transfer_to_flash(int socket_fd, unsigned char dev_address, unsigned in
 	sdaq_id_ptr->payload_type = Write_page_buff_to_flash;
 	sdaq_id_ptr->device_addr = dev_address;
 	//construct payload
-	frame_tx.can_dlc = sizeof(sdaq_transfer_buffer);//Payload size
+	frame_tx->can_dlc = sizeof(sdaq_transfer_buffer);//Payload size
 	sdaq_transfer_buffer_enc->addr = addr;
-	if(write(socket_fd, &frame_tx, sizeof(struct can_frame))<0)
-		return 1;
 	return 0;
 }
 
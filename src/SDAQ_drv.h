@@ -17,6 +17,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #ifndef SDAQ_DRV_h
 #define SDAQ_DRV_h
 
+#include <linux/can.h>
+
 #define SDAQ_MAX_DEV_NUM 20 //Maximum number for SDAQ Device type
 #define SDAQ_MAX_AMOUNT_OF_CHANNELS 16 //can be up to 63, from white paper.
 #define MAX_AMOUNT_OF_POINTS 16
@@ -30,6 +32,16 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #define PAGE_SIZE 256 // Value from White paper.
 #define PAGE_SECTIONS 32 // 32 = 256/8, 8 is maximum Payload size.
 #define INP_MODE_MAX_COL 8
+#define SDAQ_MAX_FILTERS 8 //Max amount of CAN_RAW filters on a SDAQ socket.
+#define SDAQ_RX_BATCH_SIZE 32 //Max amount of frames received with one system call.
+#define SDAQ_RX_CTRL_SIZE 64 //Size of control buffer for each frame, fit the kernel timestamp cmsg.
+#define SDAQ_TX_BATCH_SIZE 64 //Max amount of queued frames of a batch transmitter.
+#define SDAQ_TX_MAX_RETRIES 100 //Max amount of retries of a burst, when the CAN-IF's TX queue is full.
+#define SDAQ_TX_BACKOFF 1 //Wait time (msec) before retry of a burst, when the CAN-IF's TX queue is full.
+#define SDAQ_CAL_TX_BURST 1 //Amount of calibration data frames per burst, SDAQ stores each frame before the next.
+#define SDAQ_CAL_TX_GAP 10000 //Gap (usec) after each calibration data burst, as the delay of the single frame writes.
+#define SDAQ_PAGE_TX_BURST 1 //Amount of Page_buff frames per burst, SDAQ's RX FIFO is not known to hold more.
+#define SDAQ_PAGE_TX_GAP 1000 //Gap (usec) after each Page_buff burst, prevent overflow of SDAQ's RX FIFO.
 
 extern const char *unit_str[];
 extern const char *dev_type_str[];
@@ -232,11 +244,184 @@ typedef struct pSDAQ_sync_debug_data{
 
 #pragma pack(pop)//Disable packing
 
+/*
+ * Transmitter of CAN frames in batches. Frames are encoded at the queue by the SDAQ_tx_* functions,
+ * and sent with one system call per burst by SDAQ_tx_flush(). A burst of one frame is a plain send(),
+ * so the uploads with SDAQ_CAL_TX_BURST and SDAQ_PAGE_TX_BURST of 1 make one system call per frame.
+ */
+typedef struct SDAQ_tx_batch{
+	int socket_fd;
+	unsigned int amount;//Amount of queued frames
+	unsigned int sent;//Amount of the queued frames that are sent
+	unsigned int retries;//Amount of bursts without progress, because of full CAN-IF's TX queue.
+	unsigned int burst;//Max amount of frames per burst, 0 for no limit.
+	unsigned int gap;//Time (usec) after each burst.
+	struct can_frame frames[SDAQ_TX_BATCH_SIZE];
+}SDAQ_tx_batch;
+
+/*
+ * Receiver of CAN frames in batches. Frames are received with one system call per batch,
+ * each with the kernel's receive timestamp, and returned one by one from SDAQ_rx().
+ * Frames that are still pending when the receiver is no longer used are discarded.
+ */
+typedef struct SDAQ_rx_batch{
+	int socket_fd;
+	unsigned int amount;//Amount of frames in the batch
+	unsigned int index;//Index of the next frame to return
+	struct can_frame frames[SDAQ_RX_BATCH_SIZE];
+	unsigned long long timestamps[SDAQ_RX_BATCH_SIZE];//Receive time of the frames, nsec since Epoch
+	char ctrl[SDAQ_RX_BATCH_SIZE][SDAQ_RX_CTRL_SIZE];
+}SDAQ_rx_batch;
+
+/*
+ * Deadline of an operation on a CAN socket. The socket and a timerfd are waited together on an epoll instance,
+ * so each operation has its own timing, without signals or process-wide timers. Used with SDAQ_deadline_rx().
+ */
+typedef struct SDAQ_deadline{
+	int epoll_fd;
+	int timer_fd;
+	SDAQ_rx_batch *rx;
+}SDAQ_deadline;
+
+/*
+ * Request/response transaction. The caller declares the request, the reply set, the deadline of each attempt
+ * and the amount of retries, and submit it to a transaction engine. Any amount of transactions can be in flight
+ * on the engine's socket, each frame is dispatched to the transactions that expect it.
+ */
+#define SDAQ_REPLY(payload_type) (1ULL << ((payload_type) & 0x3f)) /*Bit of an SDAQ -> Master payload type at reply_set*/
+enum SDAQ_trans_result{
+	SDAQ_trans_pending = 0,
+	SDAQ_trans_done,
+	SDAQ_trans_timeout,//No complete reply set after all the retries
+	SDAQ_trans_failed,//Request not sent, aborted by its reply handler, or cancelled
+};
+typedef struct SDAQ_transaction SDAQ_trans;
+//Send the request of trans on socket_fd. Called for the first attempt and each retry. Return 0 on success and 1 on failure.
+typedef int (*SDAQ_trans_request_fn)(int socket_fd, SDAQ_trans *trans);
+/*
+ * Handle a frame of the reply set of trans. Called with frame NULL before each retry, to discard a partial reply set.
+ * Return 1 when the reply set is complete, 0 if more frames are expected, or -1 to abort the transaction.
+ */
+typedef int (*SDAQ_trans_reply_fn)(SDAQ_trans *trans, const struct can_frame *frame);
+//Called once, when trans is completed with result. trans can be re-submitted or freed from here.
+typedef void (*SDAQ_trans_done_fn)(SDAQ_trans *trans, enum SDAQ_trans_result result);
+struct SDAQ_transaction{
+	//Request, set by the caller
+	unsigned char dev_addr;
+	unsigned char channel;//Non zero: Frames of other channels are not part of the reply set.
+	unsigned long long reply_set;//SDAQ_REPLY() of each accepted payload type from dev_addr.
+	unsigned int timeout;//Deadline of each attempt, msec.
+	unsigned int retries;//Amount of attempts after the first.
+	SDAQ_trans_request_fn request;
+	SDAQ_trans_reply_fn on_reply;//Nullable, the first frame of the reply set completes the transaction.
+	SDAQ_trans_done_fn on_done;//Nullable.
+	void *arg;//Argument of the caller.
+	//State, managed by the engine
+	enum SDAQ_trans_result result;//SDAQ_trans_pending while in flight.
+	unsigned int attempt;
+	unsigned long long deadline;//msec on CLOCK_MONOTONIC
+	unsigned long long seq;//Number of the submission at the engine.
+	SDAQ_trans *next;
+};
+//Engine of transactions, multiplexed over one socket.
+typedef struct SDAQ_transaction_engine{
+	int socket_fd;
+	SDAQ_rx_batch rx;
+	SDAQ_deadline dl;
+	SDAQ_trans *in_flight;//List of the in-flight transactions, in order of submission.
+	unsigned int amount;//Amount of in-flight transactions
+	unsigned long long submissions;//Amount of submissions, numbers the transactions.
+}SDAQ_trans_engine;
+
 //Decoder for the status byte field from "CAN Device_ID/Status" message
 const char * status_byte_dec(unsigned char status_byte,unsigned char field);
 //Decoder for the status byte field from "Measure" message
 const char * Channel_status_byte_dec(unsigned char status_byte);
 
+				/*CAN Socket related Functions*/
+//Direction of the messages that a SDAQ filter accepts.
+enum SDAQ_msg_direction{
+	Master_to_SDAQ = 0x00,
+	SDAQ_to_Master = 0x80
+};
+/*
+ * Build a CAN_RAW filter for SDAQ messages of direction 'dir'.
+ * dev_address: Accepted address, Broadcast for any address.
+ * payload_type: Accepted payload type, 0 for any payload type of the direction.
+ */
+void SDAQ_filter_build(struct can_filter *filter, enum SDAQ_msg_direction dir, unsigned char dev_address, unsigned char payload_type);
+/*
+ * Open and bind a CAN_RAW socket on interface CANif_name with the 'amount_of_filters' filters of 'filters'.
+ * timeout: Receive timeout in seconds, 0 for blocking receive.
+ * Return the socket's file descriptor on success, or -1 on failure.
+ */
+int SDAQ_socket_open(const char *CANif_name, const struct can_filter *filters, unsigned int amount_of_filters, unsigned int timeout);
+//Initialize a batch receiver for socket_fd, and enable the kernel receive timestamps on it.
+void SDAQ_rx_init(SDAQ_rx_batch *rx, int socket_fd);
+/*
+ * Get the next received frame. Receive a new batch if there are no pending frames, blocking as read() does.
+ * timestamp: Nullable. If used, filled with the frame's receive time, nsec since Epoch.
+ * Return sizeof(struct can_frame) on success, or -1 with errno set, as read().
+ */
+int SDAQ_rx(SDAQ_rx_batch *rx, struct can_frame *frame, unsigned long long *timestamp);
+//Return the amount of frames that are received and not yet returned by SDAQ_rx().
+static inline unsigned int SDAQ_rx_pending(const SDAQ_rx_batch *rx)
+{
+	return rx->amount - rx->index;
+}
+//Initialize a deadline for the receiver rx, initially disarmed. Return 0 on success, or -1 on failure.
+int SDAQ_deadline_init(SDAQ_deadline *dl, SDAQ_rx_batch *rx);
+//Arm the deadline to expire after msec, 0 to disarm. Discards an expiration that is not yet reported.
+void SDAQ_deadline_set(SDAQ_deadline *dl, unsigned long long msec);
+//Arm the deadline to expire at mono_msec, msec on CLOCK_MONOTONIC.
+void SDAQ_deadline_at(SDAQ_deadline *dl, unsigned long long mono_msec);
+/*
+ * Get the next received frame, waiting for it up to the deadline. Pending frames of the receiver are returned first.
+ * timestamp: As SDAQ_rx().
+ * Return sizeof(struct can_frame) on success, 0 if the deadline expired, or -1 with errno set on failure.
+ */
+int SDAQ_deadline_rx(SDAQ_deadline *dl, struct can_frame *frame, unsigned long long *timestamp);
+//Release the resources of the deadline. The receiver and its socket are not closed.
+void SDAQ_deadline_close(SDAQ_deadline *dl);
+//Initialize the transaction engine eng for socket_fd. Return 0 on success, or -1 on failure.
+int SDAQ_trans_engine_init(SDAQ_trans_engine *eng, int socket_fd);
+//Cancel the in-flight transactions of eng, and release its resources. The socket is not closed.
+void SDAQ_trans_engine_close(SDAQ_trans_engine *eng);
+//Send the request of trans and add it to the in-flight transactions of eng. Return 0 on success, or 1 if the request is not sent.
+int SDAQ_trans_submit(SDAQ_trans_engine *eng, SDAQ_trans *trans);
+/*
+ * Wait for a frame or for the nearest deadline, and advance the in-flight transactions of eng.
+ * Return the amount of in-flight transactions, or -1 on reception failure.
+ */
+int SDAQ_trans_step(SDAQ_trans_engine *eng);
+/*
+ * As SDAQ_trans_step(), with the wait ended also at wake_at (msec on CLOCK_MONOTONIC, 0 for none),
+ * for the caller's work between the frames. Return as SDAQ_trans_step().
+ */
+int SDAQ_trans_step_until(SDAQ_trans_engine *eng, unsigned long long wake_at);
+//Advance the in-flight transactions of eng until all are completed. Return 0 on success, or -1 on reception failure.
+int SDAQ_trans_wait(SDAQ_trans_engine *eng);
+//Request functions of the queries, for SDAQ_trans.request
+int SDAQ_trans_req_info(int socket_fd, SDAQ_trans *trans);//QueryDeviceInfo() of trans->dev_addr
+int SDAQ_trans_req_cal_data(int socket_fd, SDAQ_trans *trans);//QueryCalibrationData() of trans->dev_addr and trans->channel
+int SDAQ_trans_req_sysvar(int socket_fd, SDAQ_trans *trans);//QuerySystemVariables() of trans->dev_addr
+//Initialize a batch transmitter for socket_fd. Queued frames sent in bursts of 'burst' frames (0 for no limit), with 'gap' usec after each burst.
+void SDAQ_tx_init(SDAQ_tx_batch *tx, int socket_fd, unsigned int burst, unsigned int gap);
+//Return a cleared frame at the end of the queue. Flush the queue first if it's full. Return NULL on flush failure.
+struct can_frame *SDAQ_tx_frame(SDAQ_tx_batch *tx);
+//Send all the queued frames. Wait and retry while the CAN-IF's TX queue is full. Return 0 on success and 1 on failure.
+int SDAQ_tx_flush(SDAQ_tx_batch *tx);
+/*
+ * Send the next burst of queued frames, without waiting for the gap or for the CAN-IF's TX queue.
+ * Return the amount of frames that remain queued, or -1 on failure. Queue is cleared when all are sent or on failure.
+ */
+int SDAQ_tx_send_burst(SDAQ_tx_batch *tx);
+//Return the amount of frames that are queued and not yet sent.
+static inline unsigned int SDAQ_tx_pending(const SDAQ_tx_batch *tx)
+{
+	return tx->amount - tx->sent;
+}
+
 				/*Master -> SDAQ Functions*/
 /*All the functions return 0 in success and 1 on failure */
 //Request start of measure from the SDAQ device. For all: dev_addr=0
@@ -259,6 +444,9 @@ int QuerySystemVariables(int socket_fd, unsigned char dev_address);
 int WriteCalibrationDate(int socket_fd, unsigned char dev_address, unsigned char channel_num, void *date_ptr, unsigned char period, unsigned char NumOfPoints, unsigned char unit);
 //Write the calibration point data 'NumOfPoint' of the channel 'channel_num' of the SDAQ with address 'dev_address'
 int WriteCalibrationPoint(int socket_fd, unsigned char dev_address, unsigned char channel_num, float point_val, unsigned char Point_num, unsigned char type);
+//Queue versions of the above, frames are sent on SDAQ_tx_flush(). Return 0 on success and 1 on failure.
+int SDAQ_tx_WriteCalibrationDate(SDAQ_tx_batch *tx, unsigned char dev_address, unsigned char channel_num, void *date_ptr, unsigned char period, unsigned char NumOfPoints, unsigned char unit);
+int SDAQ_tx_WriteCalibrationPoint(SDAQ_tx_batch *tx, unsigned char dev_address, unsigned char channel_num, float point_val, unsigned char Point_num, unsigned char type);
 		/*SDAQ's Bootloader related functions*/
 //Set execution code of SDAQ's uC.
 int SDAQ_goto(int socket_fd, unsigned char dev_address, _Bool code_reg_fl);
@@ -274,6 +462,9 @@ int SDAQ_write_header(int socket_fd, unsigned char dev_address, unsigned int sta
 int SDAQ_write_page_buff(int socket_fd, unsigned char dev_address, unsigned char *data);
 //Transfer page buffer to Flash memory.
 int SDAQ_Transfer_to_flash(int socket_fd, unsigned char dev_address, unsigned int addr);
+//Queue versions of the above, frames are sent on SDAQ_tx_flush(). Return 0 on success and 1 on failure.
+int SDAQ_tx_write_page_buff(SDAQ_tx_batch *tx, unsigned char dev_address, unsigned char *data);
+int SDAQ_tx_Transfer_to_flash(SDAQ_tx_batch *tx, unsigned char dev_address, unsigned int addr);
 
 
 //The following RX Functions used on the pseudo_SDAQ Simulator
@@ -19,6 +19,9 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #define SDAQ_in_Bootloader 0x80
 #define RETRY_LIMIT 2 /*Amount of failure CANBUS message receptions*/
+#define SDAQ_PROG_TIMEOUT 2 /*Time in sec without reception from a target, counted as failure*/
+#define SDAQ_PROG_TICK 100 /*Max time in msec of the event loop's wait*/
+#define SDAQ_PROG_ADDR_MAP_SIZE 64 /*Size of the map from SDAQ address to target*/
 
 
 #include <stdio.h>
@@ -26,10 +29,12 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
+#include <time.h>
 #include <signal.h>
 #include <pthread.h>
 
 #include <sys/select.h>
+#include <sys/epoll.h>
 #include <sys/time.h>
 #include <sys/types.h>
 
@@ -46,15 +51,51 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include "../SDAQ_drv.h"
 #include "../CANif_discovery.h"
 #include "iHEX.h"
+#include "fw_cache.h"
 #include "../ver.h"
 
 //Global variables.
 static volatile _Bool run = TRUE;
 
+enum SDAQ_prog_FSM_states{
+	SDAQ_flash_erase,
+	SDAQ_image_header,
+	SDAQ_flash_prog,
+	SDAQ_goto_app,
+	SDAQ_prog_done,
+	SDAQ_prog_failed
+};
+
+//Programming context of a target SDAQ
+typedef struct SDAQ_prog_target_context{
+	unsigned char addr;
+	unsigned char FSM_state;
+	unsigned char retry_times;
+	unsigned char progress;//Last reported progress in %
+	unsigned char buff[PAGE_SIZE];//Page on SDAQ's page buffer
+	unsigned int page_addr;
+	unsigned int pages_cnt;
+	_Bool tx_ready;//Queued frames of tx are released for transmission.
+	struct timespec prog_start, prog_end, last_rx, next_burst;
+	SDAQ_tx_batch tx;
+}SDAQ_prog_target;
+
+//Shared context of the programming
+typedef struct SDAQ_prog_context{
+	int socket_fd;
+	unsigned char fw_dev_type;
+	rom_data *SDAQ_flash;
+	unsigned int first_addr, last_addr, addr_range, crc;
+	_Bool report;
+	_Bool multi;//More than one target, report per target.
+}SDAQ_prog_ctx;
+
 //Application functions
 GByteArray *SDAQ_flash_get_first_data_blk(rom_data *SDAQ_flash);
 unsigned int SDAQ_flash_get_crc(rom_data *SDAQ_flash);
-int SDAQ_prog(char *CAN_IF, unsigned char SDAQ_addr, unsigned char fw_dev_type, rom_data *SDAQ_flash, _Bool report);
+int SDAQ_flash_get_info(rom_data *SDAQ_flash, SDAQ_fw_info *fw_info);
+int SDAQ_prog(char *CAN_IF, unsigned char *SDAQ_addrs, unsigned int amount_of_targets, const SDAQ_fw_info *fw_info, rom_data *SDAQ_flash, _Bool report);
+int SDAQ_parse_addr_list(char *str, unsigned char *addrs);
 void print_usage(char *prog_name);//Print the usage manual
 
 //Handler function for quit signals
@@ -65,14 +106,14 @@ inline static void quit_signal_handler(int signum)
 
 int main(int argc, char *argv[])
 {
-	_Bool Silent = FALSE, fl_stdin = FALSE;
+	_Bool Silent = FALSE, fl_stdin = FALSE, use_cache = TRUE, cached = FALSE;
 	char *iHEX_file_path = NULL, *CAN_if_name = NULL;
-	unsigned char SDAQ_addr, fw_dev_type, *fw_dev_type_550X_ptr, *fw_dev_type_ptr, *fw_rev_ptr;
-	GByteArray *SDAQ_flash_data;
-	GString *iHEX_file_mem;
+	unsigned char SDAQ_addrs[SDAQ_PROG_ADDR_MAP_SIZE];
+	gchar *fw_cache_key_str = NULL;
 	rom_data SDAQ_flash = {0};
+	SDAQ_fw_info fw_info;
 	//Option parsing variables
-	int c, retval=EXIT_FAILURE;
+	int c, retval=EXIT_FAILURE, amount_of_targets;
 
 	if(argc == 1)
 	{
@@ -81,7 +122,7 @@ int main(int argc, char *argv[])
 	}
 
 	opterr = 1;
-	while((c = getopt(argc, argv, "hvlsi")) != -1)
+	while((c = getopt(argc, argv, "hvlsiC")) != -1)
 	{
 		switch(c)
 		{
@@ -100,6 +141,9 @@ int main(int argc, char *argv[])
 			case 'i'://Interpreter
 				fl_stdin = TRUE;
 				break;
+			case 'C'://No firmware cache
+				use_cache = FALSE;
+				break;
 			case '?':
 				exit(EXIT_FAILURE);
 		}
@@ -117,10 +161,9 @@ int main(int argc, char *argv[])
 		fprintf(stderr, "CAN-IF name too big (>=%d)\n", IFNAMSIZ);
 		exit(EXIT_FAILURE);
 	}
-	SDAQ_addr = atoi(argv[optind+1]);
-	if(!SDAQ_addr || SDAQ_addr>=Parking_address)
+	if((amount_of_targets = SDAQ_parse_addr_list(argv[optind+1], SDAQ_addrs)) <= 0)
 	{
-		fprintf(stderr, "Address is out of range!!!\n");
+		fprintf(stderr, "ADDRESS is invalid or out of range!!!\n");
 		exit(EXIT_FAILURE);
 	}
 	iHEX_file_path = argv[optind+2];
@@ -134,65 +177,45 @@ int main(int argc, char *argv[])
 	{
 		if(!Silent)
 			printf("Enter the iHEX file in stdin and close it with EOF (Ctrl+D)\n");
-		if(!(iHEX_file_mem = g_string_new(NULL)))
+		retval = iHEX_read_fp(stdin, &SDAQ_flash, TRUE);
+	}
+	else if(iHEX_file_path)
+	{
+		//Load the pre-parsed image from the cache, or parse the file.
+		if(use_cache && (fw_cache_key_str = fw_cache_key(iHEX_file_path)) &&
+		   !fw_cache_load(fw_cache_key_str, &SDAQ_flash, &fw_info))
 		{
-			fprintf(stderr, "Memory Error!!!\n");
-			exit(EXIT_FAILURE);
+			cached = TRUE;
+			retval = EXIT_SUCCESS;
 		}
-		while((c = getchar()) != EOF)
-			iHEX_file_mem = g_string_append_c(iHEX_file_mem, c);
-		retval = iHEX_read(NULL, iHEX_file_mem->str, &SDAQ_flash, TRUE);
-		g_string_free(iHEX_file_mem, TRUE);
+		else
+			retval = iHEX_read(iHEX_file_path, NULL, &SDAQ_flash, TRUE);
 	}
-	else if(iHEX_file_path)
-		retval = iHEX_read(iHEX_file_path, NULL, &SDAQ_flash, TRUE);
 	else
 		fprintf(stderr, "File path is undefined!!!\n");
+	if(!retval && !cached)
+	{
+		if(!(retval = SDAQ_flash_get_info(&SDAQ_flash, &fw_info)) && fw_cache_key_str)
+			fw_cache_store(fw_cache_key_str, &SDAQ_flash, &fw_info);
+	}
 	if(!retval)
 	{
-		if((SDAQ_flash_data = SDAQ_flash_get_first_data_blk(&SDAQ_flash)))
-		{
-			if(!((fw_dev_type_ptr = memmem(SDAQ_flash_data->data, SDAQ_flash_data->len, DEVID_indexer_str, DEVID_indexer_str_len)) ||
-			     (fw_dev_type_550X_ptr = memmem(SDAQ_flash_data->data, SDAQ_flash_data->len, DEVID_indexer_str_550X, DEVID_indexer_str_550X_len))))
-			{
-				fprintf(stderr, "No device type reference found!!!\n");
-				retval = EXIT_FAILURE;
-			}
-			if(!(fw_rev_ptr = memmem(SDAQ_flash_data->data, SDAQ_flash_data->len, REV_indexer_str, REV_indexer_str_len)))
-			{
-				fprintf(stderr, "No device revision reference found!!!\n");
-				retval = EXIT_FAILURE;
-			}
-			fw_dev_type = fw_dev_type_ptr ? *(fw_dev_type_ptr + DEVID_indexer_str_len) : strtol((char*)(fw_dev_type_550X_ptr+DEVID_indexer_str_550X_len), NULL, 16);
-			fw_rev_ptr += REV_indexer_str_len;
-			if(fw_dev_type>SDAQ_MAX_DEV_NUM || !dev_type_str[fw_dev_type])
-			{
-				fprintf(stderr, "Firmware's Device type is Unknown!!!\n");
-				retval = EXIT_FAILURE;
-			}
-			else
-			{
-				if(!Silent)
-				{
-					printf("SDAQ firmware for %s(%d), SW_Rev:%d, 0x%X - 0x%X (%d bytes), CRC:0x%X\n",
-																 dev_type_str[fw_dev_type],
-																 fw_dev_type,
-																 *fw_rev_ptr,
-																 iHEX_first_taddr(&SDAQ_flash),
-																 iHEX_last_taddr(&SDAQ_flash),
-																 iHEX_taddr_range(&SDAQ_flash),
-																 SDAQ_flash_get_crc(&SDAQ_flash));
-					//g_list_foreach(SDAQ_flash.data_blks, print_data_blks, DATA_PRINT_OFF);
-				}
-				retval = SDAQ_prog(CAN_if_name, SDAQ_addr, fw_dev_type, &SDAQ_flash, !Silent);
-			}
-		}
-		else
+		if(!Silent)
 		{
-			fprintf(stderr, "Firmware does not have data!!!\n");
-			retval = EXIT_FAILURE;
+			printf("SDAQ firmware for %s(%d), SW_Rev:%d, 0x%X - 0x%X (%d bytes), CRC:0x%X%s\n",
+														 dev_type_str[fw_info.dev_type],
+														 fw_info.dev_type,
+														 fw_info.rev,
+														 iHEX_first_taddr(&SDAQ_flash),
+														 iHEX_last_taddr(&SDAQ_flash),
+														 iHEX_taddr_range(&SDAQ_flash),
+														 fw_info.crc,
+														 cached ? " (cached)" : "");
+			//g_list_foreach(SDAQ_flash.data_blks, print_data_blks, DATA_PRINT_OFF);
 		}
+		retval = SDAQ_prog(CAN_if_name, SDAQ_addrs, amount_of_targets, &fw_info, &SDAQ_flash, !Silent);
 	}
+	g_free(fw_cache_key_str);
 	free_rom_data(&SDAQ_flash);
 	return retval;
 }
@@ -208,6 +231,42 @@ GByteArray *SDAQ_flash_get_first_data_blk(rom_data *SDAQ_flash)
 		return NULL;
 	return SDAQ_flash_blk->blk_data;
 }
+/*
+ * Function that extract the device type and the revision from the first data block of SDAQ_flash,
+ * and calculate its crc32. Info are stored at fw_info.
+ * Return: EXIT_SUCCESS, or EXIT_FAILURE if info are not found or are invalid.
+ */
+int SDAQ_flash_get_info(rom_data *SDAQ_flash, SDAQ_fw_info *fw_info)
+{
+	GByteArray *SDAQ_flash_data;
+	unsigned char *fw_dev_type_ptr, *fw_dev_type_550X_ptr = NULL, *fw_rev_ptr;
+
+	if(!(SDAQ_flash_data = SDAQ_flash_get_first_data_blk(SDAQ_flash)))
+	{
+		fprintf(stderr, "Firmware does not have data!!!\n");
+		return EXIT_FAILURE;
+	}
+	if(!((fw_dev_type_ptr = memmem(SDAQ_flash_data->data, SDAQ_flash_data->len, DEVID_indexer_str, DEVID_indexer_str_len)) ||
+	     (fw_dev_type_550X_ptr = memmem(SDAQ_flash_data->data, SDAQ_flash_data->len, DEVID_indexer_str_550X, DEVID_indexer_str_550X_len))))
+	{
+		fprintf(stderr, "No device type reference found!!!\n");
+		return EXIT_FAILURE;
+	}
+	if(!(fw_rev_ptr = memmem(SDAQ_flash_data->data, SDAQ_flash_data->len, REV_indexer_str, REV_indexer_str_len)))
+	{
+		fprintf(stderr, "No device revision reference found!!!\n");
+		return EXIT_FAILURE;
+	}
+	fw_info->dev_type = fw_dev_type_ptr ? *(fw_dev_type_ptr + DEVID_indexer_str_len) : strtol((char*)(fw_dev_type_550X_ptr+DEVID_indexer_str_550X_len), NULL, 16);
+	fw_info->rev = *(fw_rev_ptr + REV_indexer_str_len);
+	fw_info->crc = SDAQ_flash_get_crc(SDAQ_flash);
+	if(fw_info->dev_type>SDAQ_MAX_DEV_NUM || !dev_type_str[fw_info->dev_type])
+	{
+		fprintf(stderr, "Firmware's Device type is Unknown!!!\n");
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
 //Return crc32 for first data_blk of SDAQ_flash.
 unsigned int SDAQ_flash_get_crc(rom_data *SDAQ_flash)
 {
@@ -228,19 +287,60 @@ void print_usage(char *prog_name)
 	};
 	const char manual[] = {
 		"CAN-IF: The name of the CANBUS interface.\n\n"
-		"ADDRESS: A valid SDAQ address (Resolution:1..62).\n\n"
+		"ADDRESS: A valid SDAQ address (Resolution:1..62), or a list of them (e.g. 1,4,10-20).\n"
+		"         The SDAQs of a list are programmed concurrently.\n\n"
 		"Options:\n"
 		"           -h : Print help.\n"
 		"           -v : Version.\n"
 		"           -s : Silent mode.\n"
 		"           -l : Print a list of the available CAN-IFs.\n"
 		"           -i : In-line mode.\n"
+		"           -C : Don't use the cache of the parsed firmware images.\n"
 		"\n"
 	};
 	printf("%s\nUsage: %s [Options] CAN-IF ADDRESS [Path to ROM File]\n\n%s",preamp, prog_name, manual);
 	return;
 }
 
+/*
+ * Function that parse a list of SDAQ addresses (e.g. "1,4,10-20") to addrs.
+ * Return: Amount of addresses, or negative one on invalid, out of range or duplicated address.
+ */
+int SDAQ_parse_addr_list(char *str, unsigned char *addrs)
+{
+	_Bool used[SDAQ_PROG_ADDR_MAP_SIZE] = {FALSE};
+	long first, last;
+	int amount = 0;
+	char *end;
+
+	if(!str || !addrs)
+		return -1;
+	do{
+		first = strtol(str, &end, 10);
+		last = first;
+		if(end == str)
+			return -1;
+		if(*end == '-')
+		{
+			str = end+1;
+			last = strtol(str, &end, 10);
+			if(end == str)
+				return -1;
+		}
+		if(first <= 0 || last >= Parking_address || first > last)
+			return -1;
+		for(; first<=last; first++)
+		{
+			if(used[first])
+				return -1;
+			used[first] = TRUE;
+			addrs[amount++] = first;
+		}
+		str = end+1;
+	}while(*end == ',');
+	return *end ? -1 : amount;
+}
+
 /*
  * Function that copy PAGE_SIZE amount of bytes from rom_data's first block to buff_out, started from last_addr position.
  * Return: Zero if data remain in rom_data's first block, one if all are copied, or negative one on error;
@@ -272,221 +372,355 @@ int SDAQ_get_page(rom_data *SDAQ_flash, unsigned char *buff_out, unsigned int la
 	return 0;
 }
 
-int SDAQ_prog(char *CAN_IF_name, unsigned char SDAQ_addr, unsigned char fw_dev_type, rom_data *SDAQ_flash, _Bool report)
+/*
+ * Function that prepare the page of SDAQ_flash at page_addr. Copy it to buff, and queue to tx
+ * the loading of it to SDAQ's page buffer and the transfer of the page buffer to flash.
+ * Return: Zero if data remain in rom_data's first block, one if it's the last page, or negative one on error;
+ */
+int SDAQ_prep_page(SDAQ_tx_batch *tx, rom_data *SDAQ_flash, unsigned char SDAQ_addr, unsigned char *buff, unsigned int page_addr)
 {
-	enum SDAQ_prog_FSM_states{
-		SDAQ_flash_erase,
-		SDAQ_image_header,
-		SDAQ_flash_prog,
-		SDAQ_goto_app,
-		SDAQ_prog_done
-	};
-	unsigned int SDAQ_flash_first_addr, SDAQ_flash_addr_range, SDAQ_flash_page_addr;
-	unsigned char FSM_state=SDAQ_flash_erase, buff[PAGE_SIZE], retry_times=0;
-	//Variables for Socket CAN
-	struct timeval tv = {0};
-	struct ifreq ifr = {0};
-	struct sockaddr_can addr = {0};
-	struct can_filter RX_filter = {0};
-	struct can_frame frame_rx;
-	int CAN_socket_num, RX_bytes;
-	//SDAQ message Decoders
-	sdaq_can_id *sdaq_id_dec;
-	sdaq_status *status_dec;
-	sdaq_bootloader_response *sdaq_bl_resp_dec;
-
+	int ret;
 
-	//Chech arguments for invalid entry.
-	if(!CAN_IF_name || !SDAQ_flash || (!SDAQ_addr || SDAQ_addr>=Parking_address))
-		return EXIT_FAILURE;
+	if((ret = SDAQ_get_page(SDAQ_flash, buff, page_addr)) < 0)
+		return -1;
+	if(SDAQ_tx_write_page_buff(tx, SDAQ_addr, buff) || SDAQ_tx_Transfer_to_flash(tx, SDAQ_addr, page_addr))
+		return -1;
+	return ret;
+}
 
-	//Check if SDAQ_flash have data block.
-	if(!SDAQ_flash->data_blks)
-		return EXIT_FAILURE;
+static inline double timespec_diff(const struct timespec *end, const struct timespec *start)
+{
+	return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec)/1000000000.0;
+}
 
-	//CAN Socket Opening
-	if((CAN_socket_num = socket(PF_CAN, SOCK_RAW, CAN_RAW)) < 0)
-	{
-		perror("Error while opening socket");
-		return EXIT_FAILURE;
-	}
-	//Link interface name to socket
-	strcpy(ifr.ifr_name, CAN_IF_name);
-	if(ioctl(CAN_socket_num, SIOCGIFINDEX, &ifr))
-	{
-		perror("CAN-IF");
-		return EXIT_FAILURE;
-	}
-	/* Filter for CAN messages	-- SocketCAN Filters act as: <received_can_id> & mask == can_id & mask */
-	//load filter's can_id member
-	sdaq_id_dec = (sdaq_can_id *)&RX_filter.can_id;//Set encoder to filter.can_id
-	memset(sdaq_id_dec, 0, sizeof(sdaq_can_id));
-	sdaq_id_dec->flags = 4;//set the EFF
-	sdaq_id_dec->protocol_id = PROTOCOL_ID; // Received Messages with protocol_id == PROTOCOL_ID
-	sdaq_id_dec->payload_type = 0x80; //  Received Messages with payload_type & 0x80 == TRUE, aka Master <- SDAQ.
-	sdaq_id_dec->device_addr = SDAQ_addr; // Receive only messages from SDAQ with address == SDAQ_addr.
-	//load filter's can_mask member
-	sdaq_id_dec = (sdaq_can_id *)&RX_filter.can_mask; //Set encoder to filter.can_mask
-	memset(sdaq_id_dec, 0, sizeof(sdaq_can_id));
-	sdaq_id_dec->flags = 4;//Received only messages with extended ID (29bit)
-	sdaq_id_dec->protocol_id = -1; // Protocol_id field marked for examination
-	sdaq_id_dec->payload_type = 0x80; // + The most significant bit of Payload_type field marked for examination.
-	sdaq_id_dec->device_addr = -1; // Mark device_addr field to be examined.
-	setsockopt(CAN_socket_num, SOL_CAN_RAW, CAN_RAW_FILTER, &RX_filter, sizeof(RX_filter));
-
-	// Add timeout option to the CAN Socket
-	tv.tv_sec = 2;//interval for timeout.
-	tv.tv_usec = 0;
-	setsockopt(CAN_socket_num, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
-
-	//Bind CAN Socket to address
-	addr.can_family  = AF_CAN;
-	addr.can_ifindex = ifr.ifr_ifindex;
-	if(bind(CAN_socket_num, (struct sockaddr *)&addr, sizeof(addr)) < 0)
-	{
-		perror("Error in socket bind");
-		return EXIT_FAILURE;
-	}
+//Mark target as failed and print the reason.
+void SDAQ_prog_fail(SDAQ_prog_ctx *ctx, SDAQ_prog_target *t, const char *reason)
+{
+	if(ctx->multi)
+		fprintf(stderr, "SDAQ %2d: Error: %s\n", t->addr, reason);
+	else
+		fprintf(stderr, " Error: %s\n", reason);
+	t->FSM_state = SDAQ_prog_failed;
+}
 
-	//Initialize SDAQ related variables
-	sdaq_id_dec = (sdaq_can_id *)&frame_rx.can_id;
-	status_dec = (sdaq_status *)frame_rx.data;
-	sdaq_bl_resp_dec = (sdaq_bootloader_response *)frame_rx.data;
-	SDAQ_flash_first_addr = iHEX_first_taddr(SDAQ_flash);
-	SDAQ_flash_page_addr = SDAQ_flash_first_addr;
-	SDAQ_flash_addr_range = iHEX_taddr_range(SDAQ_flash);
-	//SDAQ_prog's FSM
-	SDAQ_goto(CAN_socket_num, SDAQ_addr, bootloader);
-	if(report)
-		printf("Attempt to enter Bootloader\n");
-	while(run)
+//Programming FSM of a target. Called for each received message from the target.
+void SDAQ_prog_rx(SDAQ_prog_ctx *ctx, SDAQ_prog_target *t, struct can_frame *frame_rx)
+{
+	sdaq_can_id *sdaq_id_dec = (sdaq_can_id *)&frame_rx->can_id;
+	sdaq_status *status_dec = (sdaq_status *)frame_rx->data;
+	sdaq_bootloader_response *sdaq_bl_resp_dec = (sdaq_bootloader_response *)frame_rx->data;
+	unsigned char progress;
+	int ret;
+	char err_str[80];
+	double prog_time, prog_rate;
+
+	clock_gettime(CLOCK_MONOTONIC, &t->last_rx);
+	switch(sdaq_id_dec->payload_type)//Check the received message type.
 	{
-		RX_bytes=read(CAN_socket_num, &frame_rx, sizeof(frame_rx));
-		if(RX_bytes==sizeof(frame_rx))
-		{
-			switch(sdaq_id_dec->payload_type)//Check the received message type.
+		case Device_status:
+			if(status_dec->dev_type != ctx->fw_dev_type)
 			{
-				case Device_status:
-					if(status_dec->dev_type != fw_dev_type)
+				snprintf(err_str, sizeof(err_str), "Firmware is not for this device type!!! (%u != %u)", ctx->fw_dev_type, status_dec->dev_type);
+				SDAQ_prog_fail(ctx, t, err_str);
+				SDAQ_goto(ctx->socket_fd, t->addr, application);
+				break;
+			}
+			if(status_dec->status == SDAQ_in_Bootloader && t->FSM_state == SDAQ_flash_erase)
+			{
+				if(ctx->report)
+				{
+					if(ctx->multi)
+						printf("SDAQ %2d: Erase Flash\n", t->addr);
+					else
+						printf("\tErase SDAQ's Flash... ");
+					fflush(stdout);
+				}
+				SDAQ_erase_flash(ctx->socket_fd, t->addr, (ctx->first_addr-SDAQ_IMG_ADDR_OFFSET), ctx->last_addr);
+				t->retry_times = 0;
+			}
+			else if(t->FSM_state == SDAQ_goto_app)
+			{
+				t->FSM_state = SDAQ_prog_done;
+				if(ctx->report)
+				{
+					if(ctx->multi)
+						printf("SDAQ %2d: Done, Request SDAQ's info\n", t->addr);
+					else
+						printf("Request SDAQ's info\n");
+				}
+				QueryDeviceInfo(ctx->socket_fd, t->addr);
+			}
+			break;
+		case Bootloader_reply:
+			if(sdaq_bl_resp_dec->error_code || sdaq_bl_resp_dec->IAP_ret)
+			{
+				SDAQ_prog_fail(ctx, t, "Bootloader reply with Error!!!");
+				SDAQ_goto(ctx->socket_fd, t->addr, application);
+				break;
+			}
+			switch(t->FSM_state)
+			{
+				case SDAQ_flash_erase:
+					if(ctx->report)
 					{
-						fprintf(stderr, "Error: Firmware is not for this device type!!! (%u != %u)\n", fw_dev_type, status_dec->dev_type);
-						SDAQ_goto(CAN_socket_num, SDAQ_addr, application);
-						run = FALSE;
-						break;
+						if(ctx->multi)
+							printf("SDAQ %2d: Write Flash Header\n", t->addr);
+						else
+							printf("Okay\n\tWrite SDAQ's Flash Header... ");
+						fflush(stdout);
 					}
-					if(status_dec->status == SDAQ_in_Bootloader && FSM_state == SDAQ_flash_erase)
+					t->FSM_state = SDAQ_image_header;
+					//fall through
+				case SDAQ_image_header:
+					if(ctx->report && !ctx->multi)
 					{
-						if(report)
-						{
-							printf("\tErase SDAQ's Flash... ");
-							fflush(stdout);
-						}
-						SDAQ_erase_flash(CAN_socket_num, SDAQ_addr, (SDAQ_flash_first_addr-SDAQ_IMG_ADDR_OFFSET), iHEX_last_taddr(SDAQ_flash));
-						retry_times = 0;
+						printf("Okay\n\tPrograming SDAQ's Flash [00%%]");
+						fflush(stdout);
 					}
-					else if(FSM_state == SDAQ_goto_app)
+					if(SDAQ_write_header(ctx->socket_fd, t->addr, ctx->first_addr, ctx->addr_range, ctx->crc, t->buff) ||
+					   SDAQ_Transfer_to_flash(ctx->socket_fd, t->addr, (ctx->first_addr-SDAQ_IMG_ADDR_OFFSET)))
 					{
-						FSM_state = SDAQ_prog_done;
-						if(report)
-							printf("Request SDAQ's info\n");
-						QueryDeviceInfo(CAN_socket_num, SDAQ_addr);
-						run = FALSE;
+						SDAQ_prog_fail(ctx, t, "Image header writing!!!");
+						break;
 					}
+					clock_gettime(CLOCK_MONOTONIC, &t->prog_start);
+					t->FSM_state = SDAQ_flash_prog;
 					break;
-				case Bootloader_reply:
-					if(!sdaq_bl_resp_dec->error_code && !sdaq_bl_resp_dec->IAP_ret)
+				case SDAQ_flash_prog:
+					//SDAQ's page buffer is free after the reply for the flash write of the previous page.
+					if((ret = SDAQ_prep_page(&t->tx, ctx->SDAQ_flash, t->addr, t->buff, t->page_addr)) < 0)
 					{
-						switch(FSM_state)
-						{
-							case SDAQ_flash_erase:
-								if(report)
-								{
-									printf("Okay\n\tWrite SDAQ's Flash Header... ");
-									fflush(stdout);
-								}
-								FSM_state = SDAQ_image_header;
-							case SDAQ_image_header:
-								if(report)
-								{
-									printf("Okay\n\tPrograming SDAQ's Flash [00%%]");
-									fflush(stdout);
-								}
-								if(!SDAQ_write_header(CAN_socket_num, SDAQ_addr,
-													  SDAQ_flash_first_addr,
-													  SDAQ_flash_addr_range,
-													  SDAQ_flash_get_crc(SDAQ_flash),
-													  buff))
-									SDAQ_Transfer_to_flash(CAN_socket_num, SDAQ_addr, (SDAQ_flash_first_addr-SDAQ_IMG_ADDR_OFFSET));
-								else
-								{
-									fprintf(stderr, " Error at image header writing!!!\n");
-									run = FALSE;
-								}
-								FSM_state = SDAQ_flash_prog;
-								break;
-							case SDAQ_flash_prog:
-								if(SDAQ_get_page(SDAQ_flash, buff, SDAQ_flash_page_addr))
-									FSM_state = SDAQ_goto_app;
-								if(!SDAQ_write_page_buff(CAN_socket_num, SDAQ_addr, buff))
-								{
-									if(report)
-									{
-										printf("\b\b\b\b%02d%%]", 1+(100*(SDAQ_flash_page_addr-SDAQ_flash_first_addr))/SDAQ_flash_addr_range);
-										fflush(stdout);
-									}
-									SDAQ_Transfer_to_flash(CAN_socket_num, SDAQ_addr, SDAQ_flash_page_addr);
-									SDAQ_flash_page_addr += PAGE_SIZE;
-								}
-								else
-								{
-									fprintf(stderr, " Error at SDAQ flash's page loading!!!\n");
-									run = FALSE;
-								}
-								break;
-							case SDAQ_goto_app:
-								if(report)
-									printf("\nExit Bootloader\n");
-								SDAQ_goto(CAN_socket_num, SDAQ_addr, application);
-								break;
-						}
-					}
-					else
-					{
-						fprintf(stderr, " Bootloader reply with Error!!!\n");
-						SDAQ_goto(CAN_socket_num, SDAQ_addr, application);
-						run = FALSE;
+						SDAQ_prog_fail(ctx, t, "SDAQ flash's page loading!!!");
 						break;
 					}
-					retry_times = 0;
-					break;
-				case Page_buff:
-					if(memcmp(buff+(sdaq_id_dec->channel_num*frame_rx.can_dlc), frame_rx.data, frame_rx.can_dlc))
+					//Release the page for transmission.
+					t->tx_ready = TRUE;
+					if(ret)
+						t->FSM_state = SDAQ_goto_app;
+					if(ctx->report)
 					{
-						fprintf(stderr, " Error: SDAQ's flash verification!!!\n");
-						run = FALSE;
+						progress = 1+(100*(t->page_addr-ctx->first_addr))/ctx->addr_range;
+						if(!ctx->multi)
+						{
+							printf("\b\b\b\b%02d%%]", progress);
+							fflush(stdout);
+						}
+						else if(progress/10 != t->progress/10)
+							printf("SDAQ %2d: Programing Flash [%02d%%]\n", t->addr, progress);
+						t->progress = progress;
 					}
-					retry_times = 0;
+					t->page_addr += PAGE_SIZE;
+					t->pages_cnt++;
 					break;
-				default:
-					retry_times++;
-					if(retry_times >= RETRY_LIMIT)
+				case SDAQ_goto_app:
+					if(ctx->report)
 					{
-						fprintf(stderr, "Error: SDAQ's bootloader not responding!!!\n");
-						run = FALSE;
+						clock_gettime(CLOCK_MONOTONIC, &t->prog_end);
+						prog_time = timespec_diff(&t->prog_end, &t->prog_start);
+						prog_rate = prog_time > 0 ? t->pages_cnt/prog_time : 0;
+						if(ctx->multi)
+							printf("SDAQ %2d: %u pages in %.2f sec (%.1f pages/s), Exit Bootloader\n", t->addr, t->pages_cnt, prog_time, prog_rate);
+						else
+						{
+							printf("\n\t%u pages in %.2f sec (%.1f pages/s)", t->pages_cnt, prog_time, prog_rate);
+							printf("\nExit Bootloader\n");
+						}
 					}
+					SDAQ_goto(ctx->socket_fd, t->addr, application);
 					break;
 			}
+			t->retry_times = 0;
+			break;
+		case Page_buff:
+			if(memcmp(t->buff+(sdaq_id_dec->channel_num*frame_rx->can_dlc), frame_rx->data, frame_rx->can_dlc))
+				SDAQ_prog_fail(ctx, t, "SDAQ's flash verification!!!");
+			t->retry_times = 0;
+			break;
+		default:
+			t->retry_times++;
+			if(t->retry_times >= RETRY_LIMIT)
+				SDAQ_prog_fail(ctx, t, "SDAQ's bootloader not responding!!!");
+			break;
+	}
+}
+
+/*
+ * Send the next burst of a target's released frames, if the gap after its previous burst is passed.
+ * Update wait_ms to the time until the next burst, if it's less.
+ */
+void SDAQ_prog_tx(SDAQ_prog_ctx *ctx, SDAQ_prog_target *t, const struct timespec *now, int *wait_ms)
+{
+	int remain, t_wait;
+
+	if(!t->tx_ready)
+		return;
+	if((t_wait = (int)(timespec_diff(&t->next_burst, now)*1000)) > 0)
+	{
+		if(t_wait < *wait_ms)
+			*wait_ms = t_wait;
+		return;
+	}
+	if((remain = SDAQ_tx_send_burst(&t->tx)) < 0)
+	{
+		SDAQ_prog_fail(ctx, t, "SDAQ flash's page loading!!!");
+		return;
+	}
+	t->next_burst = *now;
+	t->next_burst.tv_nsec += (remain ? t->tx.gap : 0)*1000 + (t->tx.retries ? SDAQ_TX_BACKOFF*1000000 : 0);
+	if(t->next_burst.tv_nsec >= 1000000000)
+	{
+		t->next_burst.tv_sec++;
+		t->next_burst.tv_nsec -= 1000000000;
+	}
+	if(remain)
+	{
+		*wait_ms = 1;
+		return;
+	}
+	//Page and transfer are sent, the next page is sent after the reply for the flash write.
+	t->tx_ready = FALSE;
+}
+
+/*
+ * Programming of the SDAQs with addresses SDAQ_addrs, with the firmware of SDAQ_flash.
+ * Each SDAQ has its own programming FSM. All run from one event loop over one CAN socket.
+ * SDAQ's bootloader has a single page buffer, that can be reloaded only after the reply for the flash write of its page,
+ * so each page is prepared and sent after the reply for the previous one.
+ */
+int SDAQ_prog(char *CAN_IF_name, unsigned char *SDAQ_addrs, unsigned int amount_of_targets, const SDAQ_fw_info *fw_info, rom_data *SDAQ_flash, _Bool report)
+{
+	SDAQ_prog_ctx ctx = {0};
+	SDAQ_prog_target *targets, *t, *addr_map[SDAQ_PROG_ADDR_MAP_SIZE] = {NULL};
+	unsigned int i, active, done_cnt = 0;
+	int epoll_fd, wait_ms;
+	struct epoll_event ev = {.events = EPOLLIN}, ready_ev;
+	struct timespec now;
+	//Variables for Socket CAN
+	struct can_filter RX_filters[SDAQ_MAX_FILTERS];
+	SDAQ_rx_batch rx;
+	struct can_frame frame_rx;
+	sdaq_can_id *sdaq_id_dec = (sdaq_can_id *)&frame_rx.can_id;
+
+	//Chech arguments for invalid entry.
+	if(!CAN_IF_name || !SDAQ_flash || !fw_info || !SDAQ_addrs || !amount_of_targets)
+		return EXIT_FAILURE;
+	for(i=0; i<amount_of_targets; i++)
+		if(!SDAQ_addrs[i] || SDAQ_addrs[i]>=Parking_address)
+			return EXIT_FAILURE;
+	//Check if SDAQ_flash have data block.
+	if(!SDAQ_flash->data_blks)
+		return EXIT_FAILURE;
+
+	//CAN Socket Opening, receive only messages from the target SDAQs.
+	if(amount_of_targets <= SDAQ_MAX_FILTERS)
+		for(i=0; i<amount_of_targets; i++)
+			SDAQ_filter_build(&RX_filters[i], SDAQ_to_Master, SDAQ_addrs[i], 0);
+	else
+		SDAQ_filter_build(&RX_filters[0], SDAQ_to_Master, Broadcast, 0);
+	if((ctx.socket_fd = SDAQ_socket_open(CAN_IF_name, RX_filters, amount_of_targets <= SDAQ_MAX_FILTERS ? amount_of_targets : 1, 1)) < 0)
+		return EXIT_FAILURE;
+	SDAQ_rx_init(&rx, ctx.socket_fd);
+	if((epoll_fd = epoll_create1(0)) < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, ctx.socket_fd, &ev))
+	{
+		perror("epoll");
+		if(epoll_fd >= 0)
+			close(epoll_fd);
+		close(ctx.socket_fd);
+		return EXIT_FAILURE;
+	}
+
+	//Initialize the shared and the targets' contexts
+	ctx.fw_dev_type = fw_info->dev_type;
+	ctx.SDAQ_flash = SDAQ_flash;
+	ctx.first_addr = iHEX_first_taddr(SDAQ_flash);
+	ctx.last_addr = iHEX_last_taddr(SDAQ_flash);
+	ctx.addr_range = iHEX_taddr_range(SDAQ_flash);
+	ctx.crc = fw_info->crc;
+	ctx.report = report;
+	ctx.multi = amount_of_targets > 1;
+	if(!(targets = calloc(amount_of_targets, sizeof(SDAQ_prog_target))))
+	{
+		fprintf(stderr, "Memory Error!!!\n");
+		exit(EXIT_FAILURE);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	for(i=0; i<amount_of_targets; i++)
+	{
+		t = &targets[i];
+		t->addr = SDAQ_addrs[i];
+		t->FSM_state = SDAQ_flash_erase;
+		t->page_addr = ctx.first_addr;
+		t->last_rx = now;
+		SDAQ_tx_init(&t->tx, ctx.socket_fd, SDAQ_PAGE_TX_BURST, SDAQ_PAGE_TX_GAP);
+		addr_map[t->addr] = t;
+		//SDAQ_prog's FSM
+		SDAQ_goto(ctx.socket_fd, t->addr, bootloader);
+		if(report)
+		{
+			if(ctx.multi)
+				printf("SDAQ %2d: Attempt to enter Bootloader\n", t->addr);
+			else
+				printf("Attempt to enter Bootloader\n");
 		}
-		else
+	}
+	active = amount_of_targets;
+	while(run && active)
+	{
+		//Send the next bursts of the targets' pages.
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		wait_ms = SDAQ_PROG_TICK;
+		for(i=0; i<amount_of_targets; i++)
+			if(targets[i].FSM_state < SDAQ_prog_done)
+				SDAQ_prog_tx(&ctx, &targets[i], &now, &wait_ms);
+		//Wait and demultiplex the received messages to the targets' FSMs.
+		if(epoll_wait(epoll_fd, &ready_ev, 1, wait_ms) > 0)
 		{
-			retry_times++;
-			if(retry_times >= RETRY_LIMIT)
+			do{
+				if(SDAQ_rx(&rx, &frame_rx, NULL) == sizeof(frame_rx) &&
+				   (t = addr_map[sdaq_id_dec->device_addr]) &&
+				   t->FSM_state < SDAQ_prog_done)
+					SDAQ_prog_rx(&ctx, t, &frame_rx);
+			}while(SDAQ_rx_pending(&rx));
+		}
+		//Check the targets for timeout, and count the active ones.
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		for(i=0, active=0; i<amount_of_targets; i++)
+		{
+			t = &targets[i];
+			if(t->FSM_state >= SDAQ_prog_done)
+				continue;
+			if(timespec_diff(&now, &t->last_rx) >= SDAQ_PROG_TIMEOUT)
 			{
-				fprintf(stderr, "Error: SDAQ not responding!!!\n");
-				run = FALSE;
+				t->last_rx = now;
+				t->retry_times++;
+				if(t->retry_times >= RETRY_LIMIT)
+				{
+					SDAQ_prog_fail(&ctx, t, "SDAQ not responding!!!");
+					continue;
+				}
 			}
+			active++;
+		}
+	}
+	//Summary of the programming
+	for(i=0; i<amount_of_targets; i++)
+		if(targets[i].FSM_state == SDAQ_prog_done)
+			done_cnt++;
+	if(ctx.multi)
+	{
+		if(report)
+			printf("Programmed %u of %u SDAQs\n", done_cnt, amount_of_targets);
+		if(done_cnt != amount_of_targets)
+		{
+			fprintf(stderr, "Failed SDAQs:");
+			for(i=0; i<amount_of_targets; i++)
+				if(targets[i].FSM_state != SDAQ_prog_done)
+					fprintf(stderr, " %d", targets[i].addr);
+			fprintf(stderr, "\n");
 		}
 	}
-	close(CAN_socket_num);//Close CAN_socket
-	return FSM_state != SDAQ_prog_done ? EXIT_FAILURE : EXIT_SUCCESS;
+	free(targets);
+	close(epoll_fd);
+	close(ctx.socket_fd);//Close CAN_socket
+	return done_cnt != amount_of_targets ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,266 @@
+/*
+File: fw_cache.c Implementation of the cache of the pre-parsed firmware images.
+Copyright (C) 12019-12021  Sam harry Tzavaras
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, version 3 of the License, or any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#define _GNU_SOURCE
+#define FW_CACHE_DIR "SDAQ_prog" /*Name of the cache's directory*/
+#define FW_CACHE_MAGIC "SDAQFWC"
+#define FW_CACHE_VERSION 1
+#define FW_CACHE_READ_SIZE 0x10000 /*Size of the read buffer of fw_cache_key()*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <zlib.h>
+
+#include "fw_cache.h"
+
+//Flags of fw_cache_hdr
+enum fw_cache_flags{
+	FW_CACHE_HAS_CS_IP = 1<<0,
+	FW_CACHE_HAS_IEP = 1<<1
+};
+
+/*
+ * Header of a cache entry. Followed by the payload, the block table (fw_cache_blk for each block)
+ * and the data of the blocks, in the order of the table. Entries are local to the host, fields are in host's byte order.
+ */
+typedef struct fw_cache_header{
+	char magic[8];
+	uint32_t version;
+	uint32_t amount_of_blks;
+	uint32_t payload_len;
+	uint32_t payload_crc;//crc32 of the payload
+	uint32_t fw_crc;
+	uint32_t iep;
+	uint16_t cs, ip;
+	uint8_t dev_type, rev, flags, reserved;
+}fw_cache_hdr;
+
+//Entry of the block table of a cache entry
+typedef struct fw_cache_block{
+	uint32_t ext_addr, start_addr, len;
+}fw_cache_blk;
+
+/*
+ * Function that return the path of key's entry, or of the cache directory if key is NULL.
+ * If mk_dir is set, the cache directory is created.
+ * Return: Path (Must be freed with g_free), or NULL on error.
+ */
+static gchar *fw_cache_path(const char *key, _Bool mk_dir)
+{
+	const char *base;
+	gchar *dir, *path;
+
+	if((base = getenv("XDG_CACHE_HOME")) && *base)
+		dir = g_strdup_printf("%s/"FW_CACHE_DIR, base);
+	else if((base = getenv("HOME")) && *base)
+		dir = g_strdup_printf("%s/.cache/"FW_CACHE_DIR, base);
+	else
+		return NULL;
+	if(mk_dir && g_mkdir_with_parents(dir, 0700))
+	{
+		g_free(dir);
+		return NULL;
+	}
+	if(!key)
+		return dir;
+	path = g_strdup_printf("%s/%s.fwc", dir, key);
+	g_free(dir);
+	return path;
+}
+
+gchar *fw_cache_key(const char *path)
+{
+	unsigned char buff[FW_CACHE_READ_SIZE];
+	size_t rd;
+	gchar *key = NULL;
+	GChecksum *sha;
+	FILE *fp;
+
+	if(!path || !(fp = fopen(path, "rb")))
+		return NULL;
+	sha = g_checksum_new(G_CHECKSUM_SHA256);
+	while((rd = fread(buff, 1, sizeof(buff), fp)))
+		g_checksum_update(sha, buff, rd);
+	if(!ferror(fp))
+		key = g_strdup(g_checksum_get_string(sha));
+	g_checksum_free(sha);
+	fclose(fp);
+	return key;
+}
+
+int fw_cache_load(const char *key, rom_data *mem_table, SDAQ_fw_info *info)
+{
+	int ret = -1;
+	unsigned int i;
+	size_t data_len;
+	unsigned char *payload = NULL, *data;
+	gchar *path;
+	struct stat entry_stat;
+	fw_cache_hdr hdr;
+	fw_cache_blk *blk;
+	FILE *fp;
+
+	if(!key || !mem_table || !info || mem_table->data_blks)
+		return -1;
+	if(!(path = fw_cache_path(key, FALSE)))
+		return -1;
+	fp = fopen(path, "rb");
+	g_free(path);
+	if(!fp)
+		return -1;
+	//Check the header and the size of the entry.
+	if(fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	   memcmp(hdr.magic, FW_CACHE_MAGIC, sizeof(hdr.magic)) ||
+	   hdr.version != FW_CACHE_VERSION ||
+	   fstat(fileno(fp), &entry_stat) ||
+	   entry_stat.st_size != sizeof(hdr) + (off_t)hdr.payload_len ||
+	   !hdr.amount_of_blks ||
+	   hdr.amount_of_blks > hdr.payload_len / sizeof(fw_cache_blk))
+		goto exit;
+	if(!(payload = malloc(hdr.payload_len)))
+	{
+		fprintf(stderr, "Memory Error!!!\n");
+		exit(EXIT_FAILURE);
+	}
+	if(fread(payload, 1, hdr.payload_len, fp) != hdr.payload_len ||
+	   crc32(0, payload, hdr.payload_len) != hdr.payload_crc)
+		goto exit;
+	//Check that the block table match the data.
+	blk = (fw_cache_blk *)payload;
+	data = payload + hdr.amount_of_blks * sizeof(fw_cache_blk);
+	data_len = hdr.payload_len - (data - payload);
+	for(i=0; i<hdr.amount_of_blks; i++)
+	{
+		if(blk[i].len > data_len)
+			goto exit;
+		data_len -= blk[i].len;
+	}
+	if(data_len)
+		goto exit;
+	//Build the rom_data from the entry.
+	for(i=0; i<hdr.amount_of_blks; i++)
+	{
+		iHEX_add_blk(mem_table, blk[i].ext_addr, blk[i].start_addr, data, blk[i].len);
+		data += blk[i].len;
+	}
+	if(hdr.flags & FW_CACHE_HAS_CS_IP)
+	{
+		mem_table->cs = malloc(sizeof(unsigned short));
+		mem_table->ip = malloc(sizeof(unsigned short));
+		if(!mem_table->cs || !mem_table->ip)
+		{
+			fprintf(stderr, "Memory Error!!!\n");
+			exit(EXIT_FAILURE);
+		}
+		*mem_table->cs = hdr.cs;
+		*mem_table->ip = hdr.ip;
+	}
+	if(hdr.flags & FW_CACHE_HAS_IEP)
+	{
+		if(!(mem_table->iep = malloc(sizeof(unsigned int))))
+		{
+			fprintf(stderr, "Memory Error!!!\n");
+			exit(EXIT_FAILURE);
+		}
+		*mem_table->iep = hdr.iep;
+	}
+	mem_table->file_ended = TRUE;
+	info->dev_type = hdr.dev_type;
+	info->rev = hdr.rev;
+	info->crc = hdr.fw_crc;
+	ret = 0;
+exit:
+	free(payload);
+	fclose(fp);
+	return ret;
+}
+
+int fw_cache_store(const char *key, const rom_data *mem_table, const SDAQ_fw_info *info)
+{
+	int fd, ret = -1;
+	gchar *path, *tmp_path;
+	GList *blks_list_node;
+	rom_data_block *curr_blk;
+	fw_cache_blk blk;
+	fw_cache_hdr hdr = {.magic = FW_CACHE_MAGIC, .version = FW_CACHE_VERSION};
+	FILE *fp;
+
+	if(!key || !mem_table || !info || !mem_table->data_blks)
+		return -1;
+	if(!(path = fw_cache_path(key, TRUE)))
+		return -1;
+	//Entry is written to a temporary file, and renamed to its path when it's complete.
+	tmp_path = g_strdup_printf("%s.XXXXXX", path);
+	if((fd = mkstemp(tmp_path)) < 0)
+		goto exit;
+	if(!(fp = fdopen(fd, "wb")))
+	{
+		close(fd);
+		unlink(tmp_path);
+		goto exit;
+	}
+	hdr.dev_type = info->dev_type;
+	hdr.rev = info->rev;
+	hdr.fw_crc = info->crc;
+	if(mem_table->cs && mem_table->ip)
+	{
+		hdr.flags |= FW_CACHE_HAS_CS_IP;
+		hdr.cs = *mem_table->cs;
+		hdr.ip = *mem_table->ip;
+	}
+	if(mem_table->iep)
+	{
+		hdr.flags |= FW_CACHE_HAS_IEP;
+		hdr.iep = *mem_table->iep;
+	}
+	hdr.payload_crc = crc32(0, NULL, 0);
+	fwrite(&hdr, sizeof(hdr), 1, fp);//Placeholder, rewritten at the end.
+	for(blks_list_node = mem_table->data_blks; blks_list_node; blks_list_node = g_list_next(blks_list_node))
+	{
+		curr_blk = (rom_data_block *)blks_list_node->data;
+		blk.ext_addr = curr_blk->ext_addr;
+		blk.start_addr = curr_blk->start_addr;
+		blk.len = curr_blk->blk_data->len;
+		fwrite(&blk, sizeof(blk), 1, fp);
+		hdr.payload_crc = crc32(hdr.payload_crc, (unsigned char *)&blk, sizeof(blk));
+		hdr.payload_len += sizeof(blk);
+		hdr.amount_of_blks++;
+	}
+	for(blks_list_node = mem_table->data_blks; blks_list_node; blks_list_node = g_list_next(blks_list_node))
+	{
+		curr_blk = (rom_data_block *)blks_list_node->data;
+		fwrite(curr_blk->blk_data->data, 1, curr_blk->blk_data->len, fp);
+		hdr.payload_crc = crc32(hdr.payload_crc, curr_blk->blk_data->data, curr_blk->blk_data->len);
+		hdr.payload_len += curr_blk->blk_data->len;
+	}
+	rewind(fp);
+	fwrite(&hdr, sizeof(hdr), 1, fp);
+	if(ferror(fp) | fclose(fp) || rename(tmp_path, path))
+		unlink(tmp_path);
+	else
+		ret = 0;
+exit:
+	g_free(tmp_path);
+	g_free(path);
+	return ret;
+}
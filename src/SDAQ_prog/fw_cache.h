@@ -0,0 +1,46 @@
+/*
+File: fw_cache.h Declaration of the cache of the pre-parsed firmware images.
+Copyright (C) 12019-12021  Sam harry Tzavaras
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, version 3 of the License, or any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef FW_CACHE_H
+#define FW_CACHE_H
+
+#include <gmodule.h>
+#include "iHEX.h"
+
+//Information of an SDAQ firmware, extracted from the first data block of its image.
+typedef struct SDAQ_fw_info_struct{
+	unsigned char dev_type;
+	unsigned char rev;
+	unsigned int crc;//crc32 of the first data block.
+}SDAQ_fw_info;
+
+/*
+ * Function that calculate the cache key of the file at path, as the SHA-256 of its content.
+ * Return: Key as string (Must be freed with g_free), or NULL on error.
+ */
+gchar *fw_cache_key(const char *path);
+/*
+ * Function that load the cached image of key to mem_table, and its info to info.
+ * The cache is located at $XDG_CACHE_HOME/SDAQ_prog, or $HOME/.cache/SDAQ_prog.
+ * Return: Zero on hit, or negative one on miss or invalid entry.
+ */
+int fw_cache_load(const char *key, rom_data *mem_table, SDAQ_fw_info *info);
+/*
+ * Function that store the image of mem_table, and its info, to cache as entry for key.
+ * Return: Zero on success, or negative one on failure.
+ */
+int fw_cache_store(const char *key, const rom_data *mem_table, const SDAQ_fw_info *info);
+#endif //FW_CACHE_H
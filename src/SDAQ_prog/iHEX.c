@@ -18,12 +18,16 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #define CHECK_ADDR_RANGE(addr, node) addr - (node->start_addr - node->ext_addr) < node->blk_data->len? 1:0
 #define IHEX_REC_LEN_CALC(len, index) (len - index) > IHEX_RECORD_DATA_SIZE ? IHEX_RECORD_DATA_SIZE : len - index
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <arpa/inet.h>
 
 #include "iHEX.h"
@@ -44,8 +48,14 @@ enum _IHexDefinitions {
 	IHEX_DATA_OFFSET = 9,
 	IHEX_CHECKSUM_LEN = 2,
 	IHEX_MAX_DATA_LEN = 512,
+	// Max size of a rom_data_block. Block's records are contiguous and in the same 64KB segment.
+	IHEX_BLK_PREALLOC_SIZE = 0x10000 + IHEX_MAX_DATA_LEN/2,
+	// Size of the read buffer for streamed sources.
+	IHEX_STREAM_BUFF_SIZE = 0x10000,
 	// ASCII hex encoded length of a single byte
 	IHEX_ASCII_HEX_BYTE_LEN = 2,
+	// Amount of bytes of count, address and type fields
+	IHEX_HDR_LEN = (IHEX_COUNT_LEN+IHEX_ADDRESS_LEN+IHEX_TYPE_LEN)/2,
 	// Start code offset and value
 	IHEX_START_CODE_OFFSET = 0,
 	IHEX_START_CODE = ':'
@@ -70,6 +80,28 @@ typedef struct {
 	unsigned char checksum; 					// The checksum of this record.
 } iHEX_Record;
 
+// State of the parsing of an Intel hex source.
+typedef struct {
+	rom_data *out;								// Destination of the parsed records.
+	unsigned int line;							// Current line of the source.
+	_Bool whole_src;							// The source is parsed at once (mapped file or memory), and its size is known.
+	_Bool Print_error;
+} iHEX_parser;
+
+#ifndef IHEX_STRTOUL_DEC
+// Decoding table of ASCII hex digits. The entries of valid digits have the IHEX_HEX_DIGIT flag set.
+#define IHEX_HEX_DIGIT 0x10
+static const unsigned char iHEX_hex_tab[256] = {
+	['0'] = IHEX_HEX_DIGIT|0x0, ['1'] = IHEX_HEX_DIGIT|0x1, ['2'] = IHEX_HEX_DIGIT|0x2, ['3'] = IHEX_HEX_DIGIT|0x3,
+	['4'] = IHEX_HEX_DIGIT|0x4, ['5'] = IHEX_HEX_DIGIT|0x5, ['6'] = IHEX_HEX_DIGIT|0x6, ['7'] = IHEX_HEX_DIGIT|0x7,
+	['8'] = IHEX_HEX_DIGIT|0x8, ['9'] = IHEX_HEX_DIGIT|0x9,
+	['A'] = IHEX_HEX_DIGIT|0xA, ['B'] = IHEX_HEX_DIGIT|0xB, ['C'] = IHEX_HEX_DIGIT|0xC,
+	['D'] = IHEX_HEX_DIGIT|0xD, ['E'] = IHEX_HEX_DIGIT|0xE, ['F'] = IHEX_HEX_DIGIT|0xF,
+	['a'] = IHEX_HEX_DIGIT|0xA, ['b'] = IHEX_HEX_DIGIT|0xB, ['c'] = IHEX_HEX_DIGIT|0xC,
+	['d'] = IHEX_HEX_DIGIT|0xD, ['e'] = IHEX_HEX_DIGIT|0xE, ['f'] = IHEX_HEX_DIGIT|0xF
+};
+#endif
+
 static const char *iHEX_RecTypes_str[] = {
 	"Data_Record",
 	"End_of_file",
@@ -93,8 +125,11 @@ static const char *ERROR_strings[] = {
 		//--- Variables that define extern ---//
 gpointer DATA_PRINT_OFF = NULL, DATA_PRINT_ON = &DATA_PRINT_OFF;
 			//--- Local Functions ---//
-int iHEX_rec_to_rom_data(iHEX_Record *rec, rom_data *mem_table);
-int iHEX_Record_dec(char recordBuff[], iHEX_Record *rec);
+static int iHEX_parse(iHEX_parser *parser, const char *src, size_t len, _Bool last_chunk, size_t *consumed);
+static int iHEX_check_EOF(rom_data *rom_data_ptr, int last_error, _Bool Print_error);
+static rom_data_block *iHEX_new_blk(rom_data *rom_data_ptr, unsigned int ext_addr, size_t size_hint);
+int iHEX_rec_to_rom_data(iHEX_Record *rec, rom_data *mem_table, size_t size_hint);
+int iHEX_Record_dec(const char *recordBuff, size_t rec_len, iHEX_Record *rec);
 void Print_iHEX_Record(const iHEX_Record *iHEX_Record);
 unsigned char Checksum_iHEX_Record(const iHEX_Record *iHEX_Record);
 //GString in application append functions
@@ -106,16 +141,17 @@ void Append_Data(GString *iHEX_file_data, unsigned short addr, unsigned char *da
 			//--- Implementation of Share Functions ---//
 int iHEX_read(const char *iHEX_file_path, const char *iHEX_file_mem, rom_data *out_ptr, _Bool Print_error)
 {
-	int last_error = IHEX_OK, line=1, c;
-	char *iHEX_str_line;
-	GString *iHEX_file_data = NULL;
-	iHEX_Record curr_iHEX_Record={0};
+	int last_error;
+	size_t consumed;
+	struct stat iHEX_file_stat;
+	void *iHEX_file_map;
 	FILE *iHEX_fp;
+	iHEX_parser parser = {.out = out_ptr, .whole_src = TRUE, .Print_error = Print_error};
 
 	if(!out_ptr || (iHEX_file_path && iHEX_file_mem))
 		return IHEX_ERROR_INVALID_ARGUMENTS;
 
-	//Check iHEX_file input source, and load it to iHEX_file_data.
+	//Check iHEX_file input source, and parse it in place.
 	if(iHEX_file_path)
 	{
 		if(!(iHEX_fp = fopen(iHEX_file_path, "r")))
@@ -123,56 +159,65 @@ int iHEX_read(const char *iHEX_file_path, const char *iHEX_file_mem, rom_data *o
 			fprintf(stderr, "%s\n", iHEX_strerror(IHEX_ERROR_FILE));
 			return IHEX_ERROR_FILE;
 		}
-		fseek(iHEX_fp, 0, SEEK_END);//Go to end of file.
-		iHEX_file_data = g_string_sized_new(ftell(iHEX_fp));//Allocate iHEX_file_data.
-		rewind(iHEX_fp);
-		while((c = fgetc(iHEX_fp)) != EOF)
-			iHEX_file_data = g_string_append_c(iHEX_file_data, c);
-		fclose(iHEX_fp);
-	}
-	else if(iHEX_file_mem && strlen(iHEX_file_mem))
-	{
-		if(!(iHEX_file_data = g_string_new(iHEX_file_mem)))
+		//Regular files are mapped to memory, anything else (pipes, devices) is streamed.
+		if(fstat(fileno(iHEX_fp), &iHEX_file_stat) || !S_ISREG(iHEX_file_stat.st_mode) || !iHEX_file_stat.st_size ||
+		   (iHEX_file_map = mmap(NULL, iHEX_file_stat.st_size, PROT_READ, MAP_PRIVATE, fileno(iHEX_fp), 0)) == MAP_FAILED)
 		{
-			fprintf(stderr, "Memory Error!!!\n");
-			exit(EXIT_FAILURE);
+			last_error = iHEX_read_fp(iHEX_fp, out_ptr, Print_error);
+			fclose(iHEX_fp);
+			return last_error;
 		}
+		madvise(iHEX_file_map, iHEX_file_stat.st_size, MADV_SEQUENTIAL);
+		last_error = iHEX_parse(&parser, iHEX_file_map, iHEX_file_stat.st_size, TRUE, &consumed);
+		munmap(iHEX_file_map, iHEX_file_stat.st_size);
+		fclose(iHEX_fp);
 	}
+	else if(iHEX_file_mem && *iHEX_file_mem)
+		last_error = iHEX_parse(&parser, iHEX_file_mem, strlen(iHEX_file_mem), TRUE, &consumed);
 	else
 		return IHEX_ERROR_INVALID_ARGUMENTS;
-	//Analyze and convert iHEX_file_data, and store it to rom_data
-	iHEX_str_line = strtok(iHEX_file_data->str, "\n");
-	while(iHEX_str_line && !out_ptr->file_ended)
+	return iHEX_check_EOF(out_ptr, last_error, Print_error);
+}
+
+int iHEX_read_fp(FILE *iHEX_fp, rom_data *out_ptr, _Bool Print_error)
+{
+	int last_error = IHEX_OK;
+	char *buff;
+	size_t len = 0, rd, consumed;
+	iHEX_parser parser = {.out = out_ptr, .whole_src = FALSE, .Print_error = Print_error};
+
+	if(!iHEX_fp || !out_ptr)
+		return IHEX_ERROR_INVALID_ARGUMENTS;
+	if(!(buff = malloc(IHEX_STREAM_BUFF_SIZE)))
 	{
-		if(!(last_error = iHEX_Record_dec(iHEX_str_line, &curr_iHEX_Record)))
+		fprintf(stderr, "Memory Error!!!\n");
+		exit(EXIT_FAILURE);
+	}
+	do{
+		rd = fread(buff+len, 1, IHEX_STREAM_BUFF_SIZE-len, iHEX_fp);
+		if(!rd && ferror(iHEX_fp))
 		{
-			if((last_error = iHEX_rec_to_rom_data(&curr_iHEX_Record, out_ptr)))
-			{
-				if(Print_error)
-				{
-					fprintf(stderr, "%s @ L%d -> %s\n", iHEX_strerror(last_error), line, iHEX_str_line);
-					Print_iHEX_Record(&curr_iHEX_Record);
-				}
-				break;
-			}
+			last_error = IHEX_ERROR_FILE;
+			if(Print_error)
+				fprintf(stderr, "%s\n", iHEX_strerror(last_error));
+			break;
 		}
-		else
+		len += rd;
+		if((last_error = iHEX_parse(&parser, buff, len, !rd, &consumed)))
+			break;
+		//Move the incomplete last line to the start of buff.
+		len -= consumed;
+		memmove(buff, buff+consumed, len);
+		if(len == IHEX_STREAM_BUFF_SIZE)//Line without end that fills buff.
 		{
+			last_error = IHEX_ERROR_INVALID_RECORD;
 			if(Print_error)
-				fprintf(stderr, "%s @ L%d -> %s\n", iHEX_strerror(last_error), line, iHEX_str_line);
+				fprintf(stderr, "%s @ L%u\n", iHEX_strerror(last_error), parser.line+1);
 			break;
 		}
-		line++;
-		iHEX_str_line = strtok(NULL, "\n");
-	}
-	g_string_free(iHEX_file_data, TRUE);
-	if(!out_ptr->file_ended)
-	{
-		if(Print_error)
-			fprintf(stderr, "%s\n", iHEX_strerror(IHEX_NO_EOF));
-		return IHEX_NO_EOF;
-	}
-	return last_error;
+	}while(rd && !out_ptr->file_ended);
+	free(buff);
+	return iHEX_check_EOF(out_ptr, last_error, Print_error);
 }
 
 int iHEX_write(rom_data *in_ptr, const char *iHEX_file_path, GString *iHEX_file_mem)
@@ -332,13 +377,108 @@ void free_rom_data(rom_data *ptr)
 		free(ptr->iep);
 	g_list_free_full(ptr->data_blks, free_rom_data_block);
 	ptr->data_blks = NULL;
+	ptr->last_blk = NULL;
+	ptr->amount_of_blks = 0;
 	ptr->iep = NULL;
 	ptr->ip = NULL;
 	ptr->cs = NULL;
 }
 
+
+rom_data_block *iHEX_add_blk(rom_data *mem_table, unsigned int ext_addr, unsigned int start_addr, const unsigned char *data, unsigned int len)
+{
+	rom_data_block *new_rom_data_block;
+
+	if(!mem_table || (len && !data))
+		return NULL;
+	new_rom_data_block = iHEX_new_blk(mem_table, ext_addr, len);
+	new_rom_data_block->start_addr = start_addr;
+	if(len)
+		new_rom_data_block->blk_data = g_byte_array_append(new_rom_data_block->blk_data, data, len);
+	return new_rom_data_block;
+}
+
 			//--- Implementation of Local Functions  ---//
-int iHEX_rec_to_rom_data(iHEX_Record *rec, rom_data *rom_data_ptr)
+/*
+ * Parse the records of src (len bytes) in place, and store them to the rom_data of parser.
+ * Only lines that end with newline are parsed, unless last_chunk is set.
+ * The amount of the parsed bytes is returned at *consumed.
+ * Return IHEX_OK on success, or one of the iHEX_Errors codes at failure.
+ */
+static int iHEX_parse(iHEX_parser *parser, const char *src, size_t len, _Bool last_chunk, size_t *consumed)
+{
+	const char *pos = src, *end = src+len, *eol;
+	size_t rec_len, size_hint;
+	int last_error = IHEX_OK;
+	iHEX_Record curr_iHEX_Record;
+
+	while(pos < end && !parser->out->file_ended)
+	{
+		if(!(eol = memchr(pos, '\n', end-pos)))
+		{
+			if(!last_chunk)
+				break;
+			eol = end;
+		}
+		parser->line++;
+		if((rec_len = eol - pos))//Empty lines are skipped.
+		{
+			if(pos[rec_len-1] == '\r')
+				rec_len--;
+			//Storage for new blocks: Up to the maximum size of a block, limited by the data that can remain in source.
+			size_hint = IHEX_BLK_PREALLOC_SIZE;
+			if(parser->whole_src && (end-eol)/IHEX_ASCII_HEX_BYTE_LEN + IHEX_MAX_DATA_LEN/2 < size_hint)
+				size_hint = (end-eol)/IHEX_ASCII_HEX_BYTE_LEN + IHEX_MAX_DATA_LEN/2;
+			if((last_error = iHEX_Record_dec(pos, rec_len, &curr_iHEX_Record)))
+			{
+				if(parser->Print_error)
+					fprintf(stderr, "%s @ L%u -> %.*s\n", iHEX_strerror(last_error), parser->line, (int)rec_len, pos);
+				break;
+			}
+			if((last_error = iHEX_rec_to_rom_data(&curr_iHEX_Record, parser->out, size_hint)))
+			{
+				if(parser->Print_error)
+				{
+					fprintf(stderr, "%s @ L%u -> %.*s\n", iHEX_strerror(last_error), parser->line, (int)rec_len, pos);
+					Print_iHEX_Record(&curr_iHEX_Record);
+				}
+				break;
+			}
+		}
+		pos = eol < end ? eol+1 : end;
+	}
+	*consumed = pos - src;
+	return last_error;
+}
+
+//Check that the EOF record is parsed. Return last_error, or IHEX_NO_EOF if EOF record is missing.
+static int iHEX_check_EOF(rom_data *rom_data_ptr, int last_error, _Bool Print_error)
+{
+	if(!rom_data_ptr->file_ended)
+	{
+		if(Print_error)
+			fprintf(stderr, "%s\n", iHEX_strerror(IHEX_NO_EOF));
+		return IHEX_NO_EOF;
+	}
+	return last_error;
+}
+
+//Append a new block at the tail of rom_data's data_blks, with storage preallocated for size_hint bytes.
+static rom_data_block *iHEX_new_blk(rom_data *rom_data_ptr, unsigned int ext_addr, size_t size_hint)
+{
+	rom_data_block *new_rom_data_block = g_slice_new0(rom_data_block);
+
+	new_rom_data_block->ext_addr = ext_addr;
+	new_rom_data_block->blk_data = g_byte_array_sized_new(size_hint);
+	new_rom_data_block->blk_index = rom_data_ptr->amount_of_blks++;
+	if(!rom_data_ptr->last_blk)
+		rom_data_ptr->data_blks = rom_data_ptr->last_blk = g_list_append(NULL, new_rom_data_block);
+	else
+		rom_data_ptr->last_blk = g_list_append(rom_data_ptr->last_blk, new_rom_data_block)->next;
+	return new_rom_data_block;
+}
+
+int iHEX_rec_to_rom_data(iHEX_Record *rec, rom_data *rom_data_ptr, size_t size_hint)
 {
 	rom_data_block *new_rom_data_block = NULL, *curr_rom_data_block = NULL;
 
@@ -349,9 +489,9 @@ int iHEX_rec_to_rom_data(iHEX_Record *rec, rom_data *rom_data_ptr)
 		case Data_Rec:
 			if(!rec->dataLen)
 				return IHEX_ERROR_INVALID_RECORD;
-			if(rom_data_ptr->data_blks)
+			if(rom_data_ptr->last_blk)
 			{
-				curr_rom_data_block = (rom_data_block *)(g_list_last(rom_data_ptr->data_blks)->data);
+				curr_rom_data_block = (rom_data_block *)rom_data_ptr->last_blk->data;
 				if(CHECK_ADDR_RANGE(rec->address, curr_rom_data_block))
 					return IHEX_ERROR_ADDRESS_OUT_OF_RANGE;
 				if(!curr_rom_data_block->blk_data->len || CHECK_ADDR_EQU(rec->address, curr_rom_data_block))
@@ -364,34 +504,25 @@ int iHEX_rec_to_rom_data(iHEX_Record *rec, rom_data *rom_data_ptr)
 					break;
 				}
 			}
-			new_rom_data_block = g_slice_new0(rom_data_block);
-			if(curr_rom_data_block)
-				new_rom_data_block->ext_addr = curr_rom_data_block->ext_addr;
+			new_rom_data_block = iHEX_new_blk(rom_data_ptr, curr_rom_data_block ? curr_rom_data_block->ext_addr : 0, size_hint);
 			new_rom_data_block->start_addr = new_rom_data_block->ext_addr + rec->address;
-			new_rom_data_block->blk_data = g_byte_array_new();
 			new_rom_data_block->blk_data = g_byte_array_append(new_rom_data_block->blk_data,
 															   rec->data,
 															   rec->dataLen);
-			new_rom_data_block->blk_index = g_list_length(rom_data_ptr->data_blks);
-			rom_data_ptr->data_blks = g_list_append(rom_data_ptr->data_blks, new_rom_data_block);
 			break;
 		case Extended_Segment_address:
 		case Extended_Linear_Address:
 			if(rec->dataLen!=IHEX_EXTENTED_ADDR_TYPE_LEN || rec->address)
 				return IHEX_ERROR_INVALID_RECORD;
-			new_rom_data_block = g_slice_new0(rom_data_block);
 			switch(rec->type)
 			{
 				case Extended_Segment_address:
-					new_rom_data_block->ext_addr = ntohs(*(unsigned short*)rec->data)<<4;
+					iHEX_new_blk(rom_data_ptr, ntohs(*(unsigned short*)rec->data)<<4, size_hint);
 					break;
 				case Extended_Linear_Address:
-					new_rom_data_block->ext_addr = ntohs(*(unsigned short*)rec->data)<<16;
+					iHEX_new_blk(rom_data_ptr, ntohs(*(unsigned short*)rec->data)<<16, size_hint);
 					break;
 			}
-			new_rom_data_block->blk_data = g_byte_array_new();
-			new_rom_data_block->blk_index = g_list_length(rom_data_ptr->data_blks);
-			rom_data_ptr->data_blks = g_list_append(rom_data_ptr->data_blks, new_rom_data_block);
 			break;
 		case Start_Segment_Address:
 		case Start_Linear_Address:
@@ -440,7 +571,56 @@ int iHEX_rec_to_rom_data(iHEX_Record *rec, rom_data *rom_data_ptr)
 	return IHEX_OK;
 }
 
-unsigned short iHEX_field_to_val(char recordBuff[], size_t len)
+#ifndef IHEX_STRTOUL_DEC
+//Decode n bytes of ASCII hex from src to dst. Return the 8-bit sum of the decoded bytes, or negative one on non hex digit.
+static inline int iHEX_hex_dec(const char *src, unsigned char *dst, size_t n)
+{
+	const unsigned char *s = (const unsigned char *)src;
+	unsigned char hi, lo, valid = IHEX_HEX_DIGIT, sum = 0;
+
+	for(size_t i=0; i < n; i++, s+=IHEX_ASCII_HEX_BYTE_LEN)
+	{
+		hi = iHEX_hex_tab[s[0]];
+		lo = iHEX_hex_tab[s[1]];
+		valid &= hi & lo;//Cleared by any non hex digit.
+		dst[i] = hi<<4 | (lo & 0x0F);
+		sum += dst[i];
+	}
+	return valid ? sum : -1;
+}
+
+//Decode the record of rec_len characters at recordBuff (without <cr><lf>) to rec, and validate its checksum.
+int iHEX_Record_dec(const char *recordBuff, size_t rec_len, iHEX_Record *rec)
+{
+	unsigned char hdr[IHEX_HDR_LEN];
+	int hdr_sum, data_sum, checksum;
+
+	if(!recordBuff)
+		return IHEX_ERROR_INVALID_ARGUMENTS;
+	if(!rec_len)
+		return IHEX_ERROR_NEWLINE;
+	if(recordBuff[IHEX_START_CODE_OFFSET] != IHEX_START_CODE)//Check if recordBuff does not start with ':'
+		return IHEX_ERROR_INVALID_RECORD;
+	if(rec_len < IHEX_DATA_OFFSET+IHEX_CHECKSUM_LEN ||
+	   (hdr_sum = iHEX_hex_dec(recordBuff+IHEX_COUNT_OFFSET, hdr, IHEX_HDR_LEN)) < 0)
+		return IHEX_ERROR_INVALID_RECORD;
+	rec->dataLen = hdr[0];
+	//Check record size
+	if(rec_len != (1+IHEX_COUNT_LEN+IHEX_ADDRESS_LEN+IHEX_TYPE_LEN+rec->dataLen*2+IHEX_CHECKSUM_LEN))
+		return IHEX_ERROR_INVALID_RECORD;
+	if((data_sum = iHEX_hex_dec(recordBuff+IHEX_DATA_OFFSET, rec->data, rec->dataLen)) < 0 ||
+	   (checksum = iHEX_hex_dec(recordBuff+IHEX_DATA_OFFSET+rec->dataLen*2, &rec->checksum, 1)) < 0)
+		return IHEX_ERROR_INVALID_RECORD;
+	rec->address = hdr[1]<<8 | hdr[2];
+	rec->type = hdr[3];
+	//Check if record is valid by checksum: Sum of all the bytes of a valid record is zero.
+	if ((unsigned char)(hdr_sum + data_sum + checksum))
+		return IHEX_ERROR_CHECKSUM;
+	return IHEX_OK;
+}
+#else
+//Reference decoder, field by field with strtoul. Built with -D IHEX_STRTOUL_DEC by "make bench".
+unsigned short iHEX_field_to_val(const char *recordBuff, size_t len)
 {
 	char hexBuff[IHEX_ADDRESS_LEN+1];
 	strncpy(hexBuff, recordBuff, len);
@@ -448,28 +628,22 @@ unsigned short iHEX_field_to_val(char recordBuff[], size_t len)
 	return strtoul(hexBuff, NULL, 16);
 }
 
-int iHEX_Record_dec(char recordBuff[], iHEX_Record *rec)
+int iHEX_Record_dec(const char *recordBuff, size_t rec_len, iHEX_Record *rec)
 {
-	int dataCount;
-
 	if(!recordBuff)
 		return IHEX_ERROR_INVALID_ARGUMENTS;
-	if(!(dataCount = strlen(recordBuff)))
+	if(!rec_len)
 		return IHEX_ERROR_NEWLINE;
 	if(recordBuff[IHEX_START_CODE_OFFSET] != IHEX_START_CODE)//Check if recordBuff does not start with ':'
 		return IHEX_ERROR_INVALID_RECORD;
-	for(int i=0; i < dataCount; i++)//Check and condition the Record Buffer.
-	{
-		if(recordBuff[i]=='\r' || recordBuff[i]=='\n')//Replace <cr> and <lf> with null-termination
-			recordBuff[i] = '\0';
-		else if(!isxdigit(recordBuff[i]) && recordBuff[i]!=':')//Check for illegal characters
+	for(size_t i=1; i < rec_len; i++)//Check for illegal characters
+		if(!isxdigit((unsigned char)recordBuff[i]))
 			return IHEX_ERROR_INVALID_RECORD;
-	}
-	if(!(dataCount = strlen(recordBuff)))
-		return IHEX_ERROR_NEWLINE;
+	if(rec_len < IHEX_DATA_OFFSET+IHEX_CHECKSUM_LEN)
+		return IHEX_ERROR_INVALID_RECORD;
 	rec->dataLen = iHEX_field_to_val(recordBuff+IHEX_COUNT_OFFSET, IHEX_COUNT_LEN);
 	//Check record size
-	if(dataCount != (1+IHEX_COUNT_LEN+IHEX_ADDRESS_LEN+IHEX_TYPE_LEN+rec->dataLen*2+IHEX_CHECKSUM_LEN))
+	if(rec_len != (1+IHEX_COUNT_LEN+IHEX_ADDRESS_LEN+IHEX_TYPE_LEN+rec->dataLen*2+IHEX_CHECKSUM_LEN))
 		return IHEX_ERROR_INVALID_RECORD;
 	for (int i=0; i < rec->dataLen; i++)//Convert data
 		rec->data[i] = iHEX_field_to_val(recordBuff+IHEX_DATA_OFFSET+2*i, IHEX_ASCII_HEX_BYTE_LEN);
@@ -480,6 +654,7 @@ int iHEX_Record_dec(char recordBuff[], iHEX_Record *rec)
 		return IHEX_ERROR_CHECKSUM;
 	return IHEX_OK;
 }
+#endif
 
 void Print_iHEX_Record(const iHEX_Record *iHEX_Record)
 {
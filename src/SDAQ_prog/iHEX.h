@@ -17,6 +17,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #ifndef iHEX_H
 #define iHEX_H
 
+#include <stdio.h>
 #include <gmodule.h>
 
 //All possible error codes.
@@ -38,6 +39,8 @@ typedef struct memory_binary_str{
 	unsigned short *cs,*ip;
 	unsigned int *iep;
 	GList *data_blks;
+	GList *last_blk;//Tail of data_blks
+	unsigned int amount_of_blks;//Length of data_blks
 } rom_data;
 
 //Struct for data of each node of GList data_reg
@@ -57,6 +60,12 @@ extern gpointer DATA_PRINT_ON, DATA_PRINT_OFF;
  * 	Function will return IHEX_OK on success, or one of the iHEX_Errors codes at failure.
 */
 int iHEX_read(const char *iHEX_file_path, const char *iHEX_file_mem, rom_data *mem_table, _Bool Print_error);
+/*
+ * Function that read a Intel hex from an open stream (e.g. stdin), with the same parser as iHEX_read().
+ * 	The stream is read in chunks, and is not closed.
+ * 	Function will return IHEX_OK on success, or one of the iHEX_Errors codes at failure.
+*/
+int iHEX_read_fp(FILE *iHEX_fp, rom_data *mem_table, _Bool Print_error);
 /*
  * Function that create and write a Intel hex with data from (rom_data) *mem_table.
  * 	file_path or iHEX_file_mem set the destination.
@@ -78,6 +87,8 @@ const char * iHEX_strerror(unsigned int error_num);
 
 //Function that free contents of rom_data
 void free_rom_data(rom_data *ptr);
+//Function that append a block with len bytes of data at the tail of mem_table's data_blks. Return the new block or NULL on error.
+rom_data_block *iHEX_add_blk(rom_data *mem_table, unsigned int ext_addr, unsigned int start_addr, const unsigned char *data, unsigned int len);
 //Function that printing data_blks list, called from g_list_foreach().
 void print_data_blks(gpointer data, gpointer print_flag);
 #endif //iHEX_H
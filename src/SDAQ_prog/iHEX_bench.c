@@ -0,0 +1,166 @@
+/*
+File: iHEX_bench.c Microbenchmark of the Intel hex reader. Built by "make bench" with each record decoder.
+Copyright (C) 12019-12021  Sam harry Tzavaras
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, version 3 of the License, or any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#define _GNU_SOURCE
+#define DEFAULT_LOOPS 20
+#define SYNTH_BLK_SIZE 0x10000 //Size of the blocks of the synthetic images, one per 64KB segment.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "iHEX.h"
+
+#ifdef IHEX_STRTOUL_DEC
+	#define DECODER_NAME "strtoul"
+#else
+	#define DECODER_NAME "table"
+#endif
+
+static void print_usage(char *prog_name)
+{
+	printf("Usage: %s [Options] [iHEX_file ...]\n", prog_name);
+	printf("Time the iHEX_read() of each iHEX_file, and of synthetic images.\n");
+	printf("\tOptions:\n");
+	printf("\t\t-n N   : Amount of reads per image (default %u).\n", DEFAULT_LOOPS);
+	printf("\t\t-s KB  : Add a synthetic image with KB kilobytes of random data. Can be given many times.\n");
+	printf("\t\t-h     : Print help.\n");
+}
+
+//Time loops reads of an iHEX from file or memory, and print the result. Return EXIT_SUCCESS or EXIT_FAILURE on parse error.
+static int bench_iHEX_read(const char *name, const char *iHEX_file_path, const char *iHEX_file_mem, size_t src_size, unsigned int loops)
+{
+	struct timespec start, end;
+	rom_data mem_table;
+	double elapsed;
+	int ret;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(unsigned int i=0; i<loops; i++)
+	{
+		memset(&mem_table, 0, sizeof(mem_table));
+		ret = iHEX_read(iHEX_file_path, iHEX_file_mem, &mem_table, TRUE);
+		free_rom_data(&mem_table);
+		if(ret)
+		{
+			fprintf(stderr, "%s: %s\n", name, iHEX_strerror(ret));
+			return EXIT_FAILURE;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)/1e9;
+	printf("%-8s %-24s %10zu bytes %4u reads %10.3f ms/read %8.1f MB/s\n", DECODER_NAME, name, src_size, loops,
+		   elapsed*1000/loops, src_size*(double)loops/elapsed/1e6);
+	return EXIT_SUCCESS;
+}
+
+//Build a synthetic iHEX of size bytes of random data. Return it as GString or NULL on failure.
+static GString *synth_iHEX(size_t size)
+{
+	rom_data mem_table = {0};
+	GString *iHEX_file_mem = g_string_new(NULL);
+	unsigned char *data;
+	size_t len;
+
+	if(!(data = malloc(SYNTH_BLK_SIZE)))
+	{
+		fprintf(stderr,"Memory Error!!!\n");
+		exit(EXIT_FAILURE);
+	}
+	srand(size);//Same image for both decoders.
+	for(size_t addr=0; addr<size; addr+=SYNTH_BLK_SIZE)
+	{
+		len = size-addr > SYNTH_BLK_SIZE ? SYNTH_BLK_SIZE : size-addr;
+		for(size_t i=0; i<len; i++)
+			data[i] = rand();
+		iHEX_add_blk(&mem_table, addr, addr, data, len);
+	}
+	free(data);
+	if(iHEX_write(&mem_table, NULL, iHEX_file_mem))
+	{
+		g_string_free(iHEX_file_mem, TRUE);
+		iHEX_file_mem = NULL;
+	}
+	free_rom_data(&mem_table);
+	return iHEX_file_mem;
+}
+
+int main(int argc, char *argv[])
+{
+	int c, retval = EXIT_SUCCESS;
+	unsigned int loops = DEFAULT_LOOPS;
+	char name[32];
+	struct stat iHEX_file_stat;
+	GString *iHEX_file_mem;
+	GArray *synth_sizes = g_array_new(FALSE, FALSE, sizeof(size_t));
+	size_t size;
+
+	while((c = getopt(argc, argv, "hn:s:")) != -1)
+	{
+		switch(c)
+		{
+			case 'n':
+				if(!(loops = atoi(optarg)))
+				{
+					fprintf(stderr, "Invalid amount of reads!!!\n");
+					return EXIT_FAILURE;
+				}
+				break;
+			case 's':
+				if(!(size = strtoul(optarg, NULL, 10)*1024))
+				{
+					fprintf(stderr, "Invalid size of synthetic image!!!\n");
+					return EXIT_FAILURE;
+				}
+				g_array_append_val(synth_sizes, size);
+				break;
+			case 'h':
+				print_usage(argv[0]);
+				return EXIT_SUCCESS;
+			default:
+				print_usage(argv[0]);
+				return EXIT_FAILURE;
+		}
+	}
+	for(int i=optind; i<argc && !retval; i++)
+	{
+		if(stat(argv[i], &iHEX_file_stat))
+		{
+			fprintf(stderr, "%s: Can't access file!!!\n", argv[i]);
+			retval = EXIT_FAILURE;
+			break;
+		}
+		retval = bench_iHEX_read(basename(argv[i]), argv[i], NULL, iHEX_file_stat.st_size, loops);
+	}
+	for(unsigned int i=0; i<synth_sizes->len && !retval; i++)
+	{
+		size = g_array_index(synth_sizes, size_t, i);
+		if(!(iHEX_file_mem = synth_iHEX(size)))
+		{
+			fprintf(stderr, "Synthetic image of %zu KB failed!!!\n", size/1024);
+			retval = EXIT_FAILURE;
+			break;
+		}
+		snprintf(name, sizeof(name), "synthetic_%zuKB", size/1024);
+		retval = bench_iHEX_read(name, NULL, iHEX_file_mem->str, iHEX_file_mem->len, loops);
+		g_string_free(iHEX_file_mem, TRUE);
+	}
+	g_array_free(synth_sizes, TRUE);
+	return retval;
+}
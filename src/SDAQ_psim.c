@@ -189,12 +189,10 @@ void * pseudo_SDAQ(void *varg_pt)//Thread function. Act as an pseudo_SDAQ.
 	memcpy(&arg, varg_pt, sizeof(arg));//copy *varg_pt to arg (struct thread_arguments_passer)
 
 	//Variables for Socket CAN
+	SDAQ_rx_batch rx;
 	struct can_frame frame_rx;
 	int RX_bytes;
-	struct ifreq ifr = {0};
-	struct sockaddr_can addr = {0};
-	struct can_filter RX_filter = {0};
-	sdaq_can_id *can_filter_enc;
+	struct can_filter RX_filter;
 	int socket_num;
 	//Variables for SDAQ_dev
 	sdaq_can_id *id_dec = (sdaq_can_id *)&(frame_rx.can_id);
@@ -214,50 +212,11 @@ void * pseudo_SDAQ(void *varg_pt)//Thread function. Act as an pseudo_SDAQ.
 	//Return value
 	int retval;
 
-	//CAN Socket Opening
-	if((socket_num = socket(PF_CAN, SOCK_RAW, CAN_RAW)) < 0)
-	{
-		perror("Error while opening socket");
+	//CAN Socket Opening, receive Master -> SDAQ messages of any address.
+	SDAQ_filter_build(&RX_filter, Master_to_SDAQ, Broadcast, 0);
+	if((socket_num = SDAQ_socket_open(arg.can_if_name, &RX_filter, 1, 1)) < 0)
 		exit(1);
-	}
-
-	//Link interface name to socket
-	strcpy(ifr.ifr_name, arg.can_if_name); // get name from main arguments
-	if(ioctl(socket_num, SIOCGIFINDEX, &ifr))
-	{
-		printf("CANBUS interface name does not exist\n");
-		exit(1);
-	}
-
-	/*Filter for CAN messages	-- SocketCAN Filters act as: <received_can_id> & mask == can_id & mask*/
-	//load filter's can_id member
-	can_filter_enc = (sdaq_can_id *)&RX_filter.can_id;//Set encoder to filter.can_id
-	memset(can_filter_enc, 0, sizeof(sdaq_can_id));
-	can_filter_enc->flags = 4;//set the EFF
-	can_filter_enc->protocol_id = PROTOCOL_ID; // Received Messages with protocol_id == PROTOCOL_ID
-	can_filter_enc->payload_type = 0x00; //  Received Messages with payload_type & 0x80 == False, aka Master -> SDAQ.
-	//load filter's can_mask member
-	can_filter_enc = (sdaq_can_id *)&RX_filter.can_mask; //Set encoder to filter.can_mask
-	memset(can_filter_enc, 0, sizeof(sdaq_can_id));
-	can_filter_enc->flags = 4;//Received only messages with extended ID (29bit)
-	can_filter_enc->protocol_id = -1; // Protocol_id field marked for examination
-	can_filter_enc->payload_type = 0x80; // + The most significant bit of Payload_type field marked for examination.
-	setsockopt(socket_num, SOL_CAN_RAW, CAN_RAW_FILTER, &RX_filter, sizeof(RX_filter));
-
-
-	// Add timeout option to the CAN Socket
-	tv.tv_sec = 1;
-	tv.tv_usec = 0;
-	setsockopt(socket_num, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
-
-	//Bind CAN Socket to address
-	addr.can_family  = AF_CAN;
-	addr.can_ifindex = ifr.ifr_ifindex;
-	if(bind(socket_num, (struct sockaddr *)&addr, sizeof(addr)) < 0)
-	{
-		perror("Error in socket bind");
-		exit(1);
-	}
+	SDAQ_rx_init(&rx, socket_num);
 	//Send status and info on start and init status send counter
 	pthread_mutex_lock(&SDAQs_mem_access[arg.serial_number-arg.start_sn]);
 		p_DeviceID_and_status(socket_num, arg.pSDAQ_mem->address, arg.serial_number, arg.pSDAQ_mem->status);
@@ -276,8 +235,8 @@ void * pseudo_SDAQ(void *varg_pt)//Thread function. Act as an pseudo_SDAQ.
 		tv.tv_usec = loop_time_diff_acc * 1000;// timeout of select, ~100ms adjuster in every loop
 		if(!(arg.pSDAQ_mem->pSDAQ_flags&(1<<disable)))
 		{
-			//wait socket_num to be ready for read, or expired after timeout
-			retval = select(socket_num+1, &ready_for_read, NULL, NULL, &tv);
+			//wait socket_num to be ready for read, or expired after timeout. No wait if received frames are pending.
+			retval = SDAQ_rx_pending(&rx) ? 1 : select(socket_num+1, &ready_for_read, NULL, NULL, &tv);
 			if(retval == -1)
 			{
 				perror("select()");
@@ -286,7 +245,7 @@ void * pseudo_SDAQ(void *varg_pt)//Thread function. Act as an pseudo_SDAQ.
 			}
 			else if(retval)// Socket_num ready to read
 			{
-				RX_bytes=read(socket_num, &frame_rx, sizeof(frame_rx));
+				RX_bytes=SDAQ_rx(&rx, &frame_rx, NULL);
 				if(RX_bytes==sizeof(frame_rx))
 				{
 					pthread_mutex_lock(&SDAQs_mem_access[arg.serial_number-arg.start_sn]);
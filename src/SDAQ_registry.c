@@ -0,0 +1,398 @@
+/*
+File: SDAQ_registry.c Implementation of the on-disk registry of the known SDAQ devices.
+Copyright (C) 12019-12021  Sam harry Tzavaras
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, version 3 of the License, or any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#define REGISTRY_DIR "SDAQ_worker" /*Name of the registry's directory*/
+#define REGISTRY_MAGIC "SDAQREG"
+#define REGISTRY_VERSION 1
+#define REG_ENTRY_FIXED_SIZE offsetof(SDAQ_reg_entry, cal_dates) /*Size of the part of SDAQ_reg_entry before the calibration dump*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include <sys/file.h>
+
+#include <zlib.h>
+#include <glib.h>
+#include <gmodule.h>
+
+#include "info.h"//including -> "SDAQ_drv.h", "Modes.h"
+#include "SDAQ_registry.h"
+
+/*
+ * Header of the registry file. Followed by the payload, the entries of the registry. Each entry is the fixed part of
+ * SDAQ_reg_entry, and if cal_valid is set, num_of_ch dates and num_of_ch*max_cal_point points.
+ * The registry is local to the host, fields are in host's byte order.
+ */
+typedef struct SDAQ_registry_header{
+	char magic[8];
+	uint32_t version;
+	uint32_t amount_of_entries;
+	uint32_t payload_len;
+	uint32_t payload_crc;//crc32 of the payload
+}SDAQ_reg_hdr;
+
+//Function that return the code of the dev_type string, or zero (Pseudo_SDAQ) if it's unknown.
+static unsigned char dev_type_code(const char *dev_type)
+{
+	if(dev_type)
+		for(int i=0; i<SDAQ_MAX_DEV_NUM && dev_type_str[i]; i++)
+			if(dev_type == dev_type_str[i] || !strcmp(dev_type, dev_type_str[i]))
+				return i;
+	return 0;
+}
+
+//Function that return the size of the calibration dump of entry in the registry file.
+static size_t reg_entry_dump_size(const SDAQ_reg_entry *entry)
+{
+	if(!entry->cal_valid)
+		return 0;
+	return entry->num_of_ch * (sizeof(sdaq_calibration_date) + entry->max_cal_point * MAX_DATA_ON_POINT * sizeof(float));
+}
+
+static SDAQ_reg_entry *reg_entry_new(SDAQ_registry *reg, unsigned int serial_number)
+{
+	SDAQ_reg_entry *entry = g_slice_new0(SDAQ_reg_entry);
+	if(!entry)
+	{
+		fprintf(stderr,"Memory Error!!!\n");
+		exit(EXIT_FAILURE);
+	}
+	entry->serial_number = serial_number;
+	g_hash_table_insert(reg->by_sn, GUINT_TO_POINTER(serial_number), entry);
+	return entry;
+}
+
+static void reg_entry_free(gpointer entry)
+{
+	g_slice_free(SDAQ_reg_entry, entry);
+}
+
+//Function that parse the payload of a registry file to reg. Return: 0 on success or 1 on invalid payload.
+static int SDAQ_registry_parse(SDAQ_registry *reg, const unsigned char *payload, size_t len, unsigned int amount)
+{
+	SDAQ_reg_entry *entry, tmp;
+	size_t dump_size;
+
+	while(amount--)
+	{
+		if(len < REG_ENTRY_FIXED_SIZE)
+			return 1;
+		memcpy(&tmp, payload, REG_ENTRY_FIXED_SIZE);
+		payload += REG_ENTRY_FIXED_SIZE;
+		len -= REG_ENTRY_FIXED_SIZE;
+		if(tmp.num_of_ch > SDAQ_MAX_AMOUNT_OF_CHANNELS || tmp.max_cal_point > MAX_AMOUNT_OF_POINTS ||
+		   (dump_size = reg_entry_dump_size(&tmp)) > len ||
+		   g_hash_table_contains(reg->by_sn, GUINT_TO_POINTER(tmp.serial_number)))
+			return 1;
+		entry = reg_entry_new(reg, tmp.serial_number);
+		memcpy(entry, &tmp, REG_ENTRY_FIXED_SIZE);
+		if(entry->cal_valid)
+		{
+			memcpy(entry->cal_dates, payload, entry->num_of_ch * sizeof(sdaq_calibration_date));
+			payload += entry->num_of_ch * sizeof(sdaq_calibration_date);
+			for(int i=0; i<entry->num_of_ch; i++)
+				for(int j=0; j<entry->max_cal_point; j++)
+				{
+					memcpy(entry->cal_points[i][j], payload, sizeof(entry->cal_points[i][j]));
+					payload += sizeof(entry->cal_points[i][j]);
+				}
+		}
+		len -= dump_size;
+	}
+	return len ? 1 : 0;
+}
+
+//Function that load the registry file at reg->path to reg->by_sn. A missing or invalid file loaded as empty.
+static void SDAQ_registry_read(SDAQ_registry *reg)
+{
+	gchar *contents = NULL;
+	gsize len;
+	SDAQ_reg_hdr hdr;
+
+	if(!g_file_get_contents(reg->path, &contents, &len, NULL))
+		return;
+	//Check the header and the payload. An invalid registry is dropped.
+	if(len < sizeof(hdr))
+		goto exit;
+	memcpy(&hdr, contents, sizeof(hdr));
+	if(memcmp(hdr.magic, REGISTRY_MAGIC, sizeof(hdr.magic)) ||
+	   hdr.version != REGISTRY_VERSION ||
+	   len != sizeof(hdr) + (gsize)hdr.payload_len ||
+	   crc32(0, (unsigned char *)contents + sizeof(hdr), hdr.payload_len) != hdr.payload_crc)
+		goto exit;
+	if(SDAQ_registry_parse(reg, (unsigned char *)contents + sizeof(hdr), hdr.payload_len, hdr.amount_of_entries))
+		g_hash_table_remove_all(reg->by_sn);
+exit:
+	g_free(contents);
+}
+
+int SDAQ_registry_open(SDAQ_registry *reg, const char *CANif_name)
+{
+	const char *base;
+
+	if(!reg || !CANif_name)
+		return -1;
+	memset(reg, 0, sizeof(SDAQ_registry));
+	if((base = getenv("XDG_CACHE_HOME")) && *base)
+		reg->path = g_strdup_printf("%s/"REGISTRY_DIR"/%s.reg", base, CANif_name);
+	else if((base = getenv("HOME")) && *base)
+		reg->path = g_strdup_printf("%s/.cache/"REGISTRY_DIR"/%s.reg", base, CANif_name);
+	else
+		return -1;
+	reg->by_sn = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, reg_entry_free);
+	reg->changed = g_hash_table_new(g_direct_hash, g_direct_equal);
+	//The file is replaced by rename on save, it's read without the lock.
+	SDAQ_registry_read(reg);
+	return 0;
+}
+
+int SDAQ_registry_save(SDAQ_registry *reg)
+{
+	int fd, lock_fd, ret = -1;
+	gchar *dir, *lock_path, *tmp_path;
+	GHashTableIter iter;
+	gpointer key, value;
+	SDAQ_reg_entry *entry;
+	SDAQ_registry disk = {0};
+	GByteArray *payload;
+	SDAQ_reg_hdr hdr = {.magic = REGISTRY_MAGIC, .version = REGISTRY_VERSION};
+	FILE *fp;
+
+	if(!reg || !reg->path)
+		return -1;
+	if(!reg->modified)
+		return 0;
+	dir = g_path_get_dirname(reg->path);
+	fd = g_mkdir_with_parents(dir, 0700);
+	g_free(dir);
+	if(fd)
+		return -1;
+	/*
+	 * Concurrent runs and the workers of the daemon share the registry. The lock is held from the re-read
+	 * of the file to the rename of the new one. The entries of the file that reg didn't change are merged,
+	 * so the entries that others saved after the open of reg are kept.
+	 */
+	lock_path = g_strdup_printf("%s.lock", reg->path);
+	lock_fd = open(lock_path, O_RDWR|O_CREAT|O_CLOEXEC, 0600);
+	g_free(lock_path);
+	if(lock_fd < 0)
+		return -1;
+	if(flock(lock_fd, LOCK_EX))
+	{
+		close(lock_fd);
+		return -1;
+	}
+	disk.path = reg->path;
+	disk.by_sn = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, reg_entry_free);
+	SDAQ_registry_read(&disk);
+	g_hash_table_iter_init(&iter, disk.by_sn);
+	while(g_hash_table_iter_next(&iter, &key, &value))
+	{
+		if(g_hash_table_contains(reg->changed, key))
+			continue;
+		g_hash_table_iter_steal(&iter);
+		g_hash_table_replace(reg->by_sn, key, value);
+	}
+	g_hash_table_destroy(disk.by_sn);
+	//Construct the payload
+	payload = g_byte_array_new();
+	g_hash_table_iter_init(&iter, reg->by_sn);
+	while(g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		entry = (SDAQ_reg_entry *)value;
+		g_byte_array_append(payload, (guint8 *)entry, REG_ENTRY_FIXED_SIZE);
+		if(entry->cal_valid)
+		{
+			g_byte_array_append(payload, (guint8 *)entry->cal_dates, entry->num_of_ch * sizeof(sdaq_calibration_date));
+			for(int i=0; i<entry->num_of_ch; i++)
+				g_byte_array_append(payload, (guint8 *)entry->cal_points[i], entry->max_cal_point * sizeof(entry->cal_points[i][0]));
+		}
+		hdr.amount_of_entries++;
+	}
+	hdr.payload_len = payload->len;
+	hdr.payload_crc = crc32(0, payload->data, payload->len);
+	//Registry is written to a temporary file, and renamed to its path when it's complete.
+	tmp_path = g_strdup_printf("%s.XXXXXX", reg->path);
+	if((fd = mkstemp(tmp_path)) < 0)
+		goto exit;
+	if(!(fp = fdopen(fd, "wb")))
+	{
+		close(fd);
+		unlink(tmp_path);
+		goto exit;
+	}
+	fwrite(&hdr, sizeof(hdr), 1, fp);
+	fwrite(payload->data, 1, payload->len, fp);
+	if(ferror(fp) | fclose(fp) || rename(tmp_path, reg->path))
+		unlink(tmp_path);
+	else
+	{
+		g_hash_table_remove_all(reg->changed);
+		reg->modified = 0;
+		ret = 0;
+	}
+exit:
+	close(lock_fd);
+	g_free(tmp_path);
+	g_byte_array_free(payload, TRUE);
+	return ret;
+}
+
+void SDAQ_registry_close(SDAQ_registry *reg)
+{
+	if(!reg)
+		return;
+	if(reg->by_sn)
+		g_hash_table_destroy(reg->by_sn);
+	if(reg->changed)
+		g_hash_table_destroy(reg->changed);
+	g_free(reg->path);
+	memset(reg, 0, sizeof(SDAQ_registry));
+}
+
+SDAQ_reg_entry *SDAQ_registry_get(SDAQ_registry *reg, unsigned int serial_number)
+{
+	if(!reg || !reg->by_sn)
+		return NULL;
+	return g_hash_table_lookup(reg->by_sn, GUINT_TO_POINTER(serial_number));
+}
+
+SDAQ_reg_entry *SDAQ_registry_seen(SDAQ_registry *reg, unsigned int serial_number, unsigned char address, const char *dev_type)
+{
+	SDAQ_reg_entry *entry;
+	unsigned char type = dev_type_code(dev_type);
+
+	if(!reg || !reg->by_sn)
+		return NULL;
+	if(!(entry = SDAQ_registry_get(reg, serial_number)))
+	{
+		entry = reg_entry_new(reg, serial_number);
+		entry->dev_type = type;
+	}
+	else if(entry->dev_type != type)
+	{
+		entry->dev_type = type;
+		entry->cal_valid = 0;
+	}
+	entry->address = address;
+	entry->last_seen = time(NULL);
+	g_hash_table_add(reg->changed, GUINT_TO_POINTER(serial_number));
+	reg->modified = 1;
+	return entry;
+}
+
+void SDAQ_registry_store(SDAQ_registry *reg, unsigned char address, const SDAQ_info_cal_data *conf)
+{
+	SDAQ_reg_entry *entry;
+	const date_list_data_of_node *date;
+
+	if(!conf || !(entry = SDAQ_registry_seen(reg, conf->SDAQ_info.serial_number, address, conf->SDAQ_info.dev_type)))
+		return;
+	entry->cal_valid = 0;
+	if(conf->SDAQ_info.num_of_ch > SDAQ_MAX_AMOUNT_OF_CHANNELS || conf->SDAQ_info.max_cal_point > MAX_AMOUNT_OF_POINTS ||
+	   !conf->cal || conf->cal->date_valid >> conf->SDAQ_info.num_of_ch)
+		return;
+	entry->status = conf->SDAQ_info.status;
+	entry->firm_rev = conf->SDAQ_info.firm_rev;
+	entry->hw_rev = conf->SDAQ_info.hw_rev;
+	entry->num_of_ch = conf->SDAQ_info.num_of_ch;
+	entry->sample_rate = conf->SDAQ_info.sample_rate;
+	entry->max_cal_point = conf->SDAQ_info.max_cal_point;
+	memset(entry->cal_dates, 0, sizeof(entry->cal_dates));
+	for(int i=0; i<entry->num_of_ch; i++)
+	{
+		if(!(conf->cal->date_valid & 1U<<i))
+			continue;
+		date = &(conf->cal->date[i]);
+		entry->cal_dates[i] = (sdaq_calibration_date){.year = date->year, .month = date->month, .day = date->day,
+													   .period = date->period, .amount_of_points = date->amount_of_points,
+													   .cal_units = date->cal_unit};
+	}
+	//The dump has the layout of the calibration model.
+	memcpy(entry->cal_points, conf->cal->point, sizeof(entry->cal_points));
+	entry->cal_valid = 1;
+}
+
+void SDAQ_registry_invalidate(SDAQ_registry *reg, unsigned char address)
+{
+	GHashTableIter iter;
+	gpointer value;
+	SDAQ_reg_entry *entry;
+
+	if(!reg || !reg->by_sn)
+		return;
+	g_hash_table_iter_init(&iter, reg->by_sn);
+	while(g_hash_table_iter_next(&iter, NULL, &value))
+	{
+		entry = (SDAQ_reg_entry *)value;
+		if(entry->address == address && entry->cal_valid)
+		{
+			entry->cal_valid = 0;
+			g_hash_table_add(reg->changed, GUINT_TO_POINTER(entry->serial_number));
+			reg->modified = 1;
+		}
+	}
+}
+
+int SDAQ_registry_match(const SDAQ_reg_entry *entry, const SDAQ_info_cal_data *conf)
+{
+	const date_list_data_of_node *date;
+	const sdaq_calibration_date *reg_date;
+
+	if(!entry || !conf || !entry->cal_valid || !conf->cal ||
+	   entry->serial_number != conf->SDAQ_info.serial_number ||
+	   entry->dev_type != dev_type_code(conf->SDAQ_info.dev_type) ||
+	   entry->status != conf->SDAQ_info.status ||
+	   entry->firm_rev != conf->SDAQ_info.firm_rev ||
+	   entry->hw_rev != conf->SDAQ_info.hw_rev ||
+	   entry->num_of_ch != conf->SDAQ_info.num_of_ch ||
+	   entry->sample_rate != conf->SDAQ_info.sample_rate ||
+	   entry->max_cal_point != conf->SDAQ_info.max_cal_point)
+		return 0;
+	//The dates of all the channels are needed.
+	if(entry->num_of_ch > SDAQ_MAX_AMOUNT_OF_CHANNELS || conf->cal->date_valid != (1U<<entry->num_of_ch)-1)
+		return 0;
+	for(int i=0; i<entry->num_of_ch; i++)
+	{
+		date = &(conf->cal->date[i]);
+		reg_date = &(entry->cal_dates[i]);
+		if(reg_date->year != date->year || reg_date->month != date->month || reg_date->day != date->day ||
+		   reg_date->period != date->period || reg_date->amount_of_points != date->amount_of_points ||
+		   reg_date->cal_units != date->cal_unit)
+			return 0;
+	}
+	return 1;
+}
+
+int SDAQ_registry_load_points(const SDAQ_reg_entry *entry, SDAQ_info_cal_data *conf)
+{
+	SDAQ_cal_model *cal;
+
+	if(!entry || !conf || !entry->cal_valid || entry->num_of_ch != conf->SDAQ_info.num_of_ch)
+		return EXIT_FAILURE;
+	cal = SDAQ_cal_model_get(conf);
+	memcpy(cal->point, entry->cal_points, sizeof(cal->point));
+	memset(cal->point_valid, 0, sizeof(cal->point_valid));
+	for(int i=0; i<entry->num_of_ch; i++)
+		memset(cal->point_valid[i], CAL_POINT_COMPLETE, entry->max_cal_point);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+/*
+File: SDAQ_registry.h Declaration of the on-disk registry of the known SDAQ devices.
+Copyright (C) 12019-12021  Sam harry Tzavaras
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, version 3 of the License, or any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef SDAQ_REGISTRY_H
+#define SDAQ_REGISTRY_H
+
+#include <time.h>
+#include <gmodule.h>
+#include "SDAQ_drv.h"
+
+struct SDAQ_information_and_calibration_data;//aka SDAQ_info_cal_data, declared at Modes.h
+
+//Entry of the registry, one for each serial number.
+typedef struct SDAQ_registry_entry{
+	unsigned int serial_number;
+	long long last_seen;//Time (sec since Epoch) of the last update of the entry.
+	unsigned char address;
+	unsigned char dev_type;
+	unsigned char status;
+	unsigned char firm_rev;
+	unsigned char hw_rev;
+	unsigned char num_of_ch;
+	unsigned char sample_rate;
+	unsigned char max_cal_point;
+	unsigned char cal_valid;//Info, cal_dates and cal_points are valid.
+	sdaq_calibration_date cal_dates[SDAQ_MAX_AMOUNT_OF_CHANNELS];
+	float cal_points[SDAQ_MAX_AMOUNT_OF_CHANNELS][MAX_AMOUNT_OF_POINTS][MAX_DATA_ON_POINT];
+}SDAQ_reg_entry;
+
+//Registry of the SDAQs of a CAN-IF.
+typedef struct SDAQ_registry{
+	char *path;
+	GHashTable *by_sn;//SDAQ_reg_entry of each serial number. Owns the entries.
+	GHashTable *changed;//Serial numbers of the entries changed since the open, these override the entries of the file on save.
+	unsigned modified : 1;
+}SDAQ_registry;
+
+/*
+ * Function that load the registry of CAN-IF CANif_name to reg. A missing or invalid registry loaded as empty.
+ * The registry is located at $XDG_CACHE_HOME/SDAQ_worker, or $HOME/.cache/SDAQ_worker.
+ * Return: Zero on success, or negative one if the location of the registry is unknown.
+ */
+int SDAQ_registry_open(SDAQ_registry *reg, const char *CANif_name);
+/*
+ * Function that write reg to its file, if it's modified. Under the lock of the file, the entries that other
+ * processes saved after the open are merged to reg, except these that reg changed.
+ * Return: Zero on success, or negative one on failure.
+ */
+int SDAQ_registry_save(SDAQ_registry *reg);
+//Function that free the allocated memory of reg.
+void SDAQ_registry_close(SDAQ_registry *reg);
+//Function that return the entry of serial_number, or NULL if it's not registered.
+SDAQ_reg_entry *SDAQ_registry_get(SDAQ_registry *reg, unsigned int serial_number);
+/*
+ * Function that update the entry of serial_number, found at address.
+ * The entry is created if it's not registered. A change of dev_type invalidates its calibration dump.
+ * Return: The entry.
+ */
+SDAQ_reg_entry *SDAQ_registry_seen(SDAQ_registry *reg, unsigned int serial_number, unsigned char address, const char *dev_type);
+//Function that store the info, the dates and the points of conf to the entry of its serial number.
+void SDAQ_registry_store(SDAQ_registry *reg, unsigned char address, const struct SDAQ_information_and_calibration_data *conf);
+//Function that mark as invalid the calibration dump of the SDAQs registered at address.
+void SDAQ_registry_invalidate(SDAQ_registry *reg, unsigned char address);
+/*
+ * Function that check if the info and the calibration dates of conf, as received from the SDAQ,
+ * match the dump of entry. The status of the SDAQ is checked against the last status of the entry.
+ * Return: Non zero on match, zero otherwise.
+ */
+int SDAQ_registry_match(const SDAQ_reg_entry *entry, const struct SDAQ_information_and_calibration_data *conf);
+//Function that load the calibration points of entry to the calibration model of conf. Return: 0 on success or 1 on failure.
+int SDAQ_registry_load_points(const SDAQ_reg_entry *entry, struct SDAQ_information_and_calibration_data *conf);
+#endif //SDAQ_REGISTRY_H
@@ -0,0 +1,226 @@
+/*
+File: SDAQ_shm.c Implementation of the writer of the shared memory views of the SDAQs.
+Copyright (C) 12019-12021  Sam harry Tzavaras
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, version 3 of the License, or any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "SDAQ_shm.h"
+
+//Seqlock of the writer. The entry's fields are updated between write_begin() and write_end().
+static inline void seq_write_begin(unsigned int *seq)
+{
+	__atomic_store_n(seq, *seq+1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void seq_write_end(unsigned int *seq)
+{
+	__atomic_store_n(seq, *seq+1, __ATOMIC_RELEASE);
+}
+
+SDAQ_shm_table *SDAQ_shm_table_create(const char *CANif_name)
+{
+	char name[64];
+	int fd;
+	SDAQ_shm_table *table;
+
+	snprintf(name, sizeof(name), SDAQ_SHM_TABLE_NAME, CANif_name);
+	shm_unlink(name);//Drop the table of a previous writer.
+	if((fd = shm_open(name, O_CREAT|O_EXCL|O_RDWR, 0644)) < 0)
+	{
+		perror("Shared memory table");
+		return NULL;
+	}
+	if(ftruncate(fd, sizeof(SDAQ_shm_table)))
+	{
+		perror("Shared memory table");
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+	table = mmap(NULL, sizeof(SDAQ_shm_table), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(table == MAP_FAILED)
+	{
+		perror("Shared memory table");
+		shm_unlink(name);
+		return NULL;
+	}
+	//The segment is zero filled, readers reject it until the header is complete.
+	table->writer_pid = getpid();
+	table->size = sizeof(SDAQ_shm_table);
+	table->version = SDAQ_SHM_VERSION;
+	__atomic_store_n(&table->magic, SDAQ_SHM_MAGIC, __ATOMIC_RELEASE);
+	return table;
+}
+
+void SDAQ_shm_table_destroy(SDAQ_shm_table *table, const char *CANif_name)
+{
+	char name[64];
+
+	if(!table)
+		return;
+	snprintf(name, sizeof(name), SDAQ_SHM_TABLE_NAME, CANif_name);
+	shm_unlink(name);
+	munmap(table, sizeof(SDAQ_shm_table));
+}
+
+void SDAQ_shm_dev_update(SDAQ_shm_table *table, unsigned char address, const sdaq_status *status, unsigned long long rx_time)
+{
+	SDAQ_shm_dev *dev;
+
+	if(!table || address >= SDAQ_SHM_ADDRS)
+		return;
+	dev = &(table->dev[address]);
+	seq_write_begin(&dev->seq);
+	if(dev->serial_number != status->dev_sn)//Other SDAQ at this address, its channels are not valid.
+		for(int i=0; i<SDAQ_MAX_AMOUNT_OF_CHANNELS; i++)
+		{
+			seq_write_begin(&dev->ch[i].seq);
+			dev->ch[i].rx_time = 0;
+			seq_write_end(&dev->ch[i].seq);
+		}
+	dev->serial_number = status->dev_sn;
+	dev->dev_type = status->dev_type;
+	dev->status = status->status;
+	dev->last_seen = rx_time;
+	dev->present = 1;
+	seq_write_end(&dev->seq);
+}
+
+void SDAQ_shm_dev_info(SDAQ_shm_table *table, unsigned char address, const sdaq_info *info)
+{
+	SDAQ_shm_dev *dev;
+
+	if(!table || address >= SDAQ_SHM_ADDRS)
+		return;
+	dev = &(table->dev[address]);
+	seq_write_begin(&dev->seq);
+	dev->num_of_ch = info->num_of_ch;
+	seq_write_end(&dev->seq);
+}
+
+void SDAQ_shm_dev_remove(SDAQ_shm_table *table, unsigned char address)
+{
+	SDAQ_shm_dev *dev;
+
+	if(!table || address >= SDAQ_SHM_ADDRS)
+		return;
+	dev = &(table->dev[address]);
+	seq_write_begin(&dev->seq);
+	dev->present = 0;
+	dev->serial_number = 0;
+	for(int i=0; i<SDAQ_MAX_AMOUNT_OF_CHANNELS; i++)
+	{
+		seq_write_begin(&dev->ch[i].seq);
+		dev->ch[i].rx_time = 0;
+		seq_write_end(&dev->ch[i].seq);
+	}
+	seq_write_end(&dev->seq);
+}
+
+void SDAQ_shm_ch_update(SDAQ_shm_table *table, unsigned char address, unsigned char channel, const sdaq_meas *meas, unsigned long long rx_time)
+{
+	SDAQ_shm_ch *ch;
+
+	if(!table || address >= SDAQ_SHM_ADDRS || !channel || channel > SDAQ_MAX_AMOUNT_OF_CHANNELS)
+		return;
+	ch = &(table->dev[address].ch[channel-1]);
+	seq_write_begin(&ch->seq);
+	ch->meas = meas->meas;
+	ch->unit = meas->unit;
+	ch->status = meas->status;
+	ch->timestamp = meas->timestamp;
+	ch->rx_time = rx_time;
+	seq_write_end(&ch->seq);
+}
+
+SDAQ_shm_ring *SDAQ_shm_ring_create(const char *CANif_name)
+{
+	char name[64];
+	int fd;
+	SDAQ_shm_ring *ring;
+
+	snprintf(name, sizeof(name), SDAQ_SHM_RING_NAME, CANif_name);
+	shm_unlink(name);//Drop the ring of a previous writer.
+	if((fd = shm_open(name, O_CREAT|O_EXCL|O_RDWR, 0644)) < 0)
+	{
+		perror("Shared memory ring");
+		return NULL;
+	}
+	if(ftruncate(fd, sizeof(SDAQ_shm_ring)))
+	{
+		perror("Shared memory ring");
+		close(fd);
+		shm_unlink(name);
+		return NULL;
+	}
+	ring = mmap(NULL, sizeof(SDAQ_shm_ring), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(ring == MAP_FAILED)
+	{
+		perror("Shared memory ring");
+		shm_unlink(name);
+		return NULL;
+	}
+	ring->writer_pid = getpid();
+	ring->size = sizeof(SDAQ_shm_ring);
+	ring->version = SDAQ_SHM_VERSION;
+	__atomic_store_n(&ring->magic, SDAQ_SHM_RING_MAGIC, __ATOMIC_RELEASE);
+	return ring;
+}
+
+void SDAQ_shm_ring_destroy(SDAQ_shm_ring *ring, const char *CANif_name)
+{
+	char name[64];
+
+	if(!ring)
+		return;
+	snprintf(name, sizeof(name), SDAQ_SHM_RING_NAME, CANif_name);
+	shm_unlink(name);
+	munmap(ring, sizeof(SDAQ_shm_ring));
+}
+
+void SDAQ_shm_ring_push(SDAQ_shm_ring *ring, unsigned char address, unsigned char channel, const sdaq_meas *meas, unsigned long long rx_time)
+{
+	unsigned long long n;
+	SDAQ_shm_rec *slot;
+
+	if(!ring)
+		return;
+	n = ring->head;//Single writer, no other store to head.
+	slot = &(ring->slot[n % SDAQ_SHM_RING_SLOTS]);
+	//Readers that reach the slot during the update see seq zero, and count its old record as lost.
+	__atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	slot->rx_time = rx_time;
+	slot->meas = meas->meas;
+	slot->unit = meas->unit;
+	slot->status = meas->status;
+	slot->timestamp = meas->timestamp;
+	slot->address = address;
+	slot->channel = channel;
+	__atomic_store_n(&slot->seq, n+1, __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->head, n+1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,258 @@
+/*
+File: SDAQ_shm.h Declaration of the shared memory views of the SDAQs, for local consumers.
+Copyright (C) 12019-12021  Sam harry Tzavaras
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, version 3 of the License, or any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef SDAQ_SHM_H
+#define SDAQ_SHM_H
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "SDAQ_drv.h"
+
+#define SDAQ_SHM_TABLE_NAME "/SDAQ_table_%s" /*shm_open() name of the latest-value table, %s is the CAN-IF's name*/
+#define SDAQ_SHM_MAGIC 0x51414453 /*"SDAQ" in little endian*/
+#define SDAQ_SHM_VERSION 1
+#define SDAQ_SHM_ADDRS 64 /*Entries of the table, one for each 6-bit SDAQ address*/
+#define SDAQ_SHM_RING_NAME "/SDAQ_ring_%s" /*shm_open() name of the measurements ring, %s is the CAN-IF's name*/
+#define SDAQ_SHM_RING_MAGIC 0x52514453 /*"SDQR" in little endian*/
+#define SDAQ_SHM_RING_SLOTS 8192 /*Records of the ring, power of two*/
+
+/*
+ * Latest-value table. Written only by the daemon of the CAN-IF, read by any amount of readers.
+ * Each device and each channel is protected by its own seqlock (seq): The writer makes seq odd,
+ * updates the entry and makes seq even. A reader copies the entry and retries if seq was odd or changed.
+ * Times are in nsec since Epoch, fields are in host's byte order.
+ */
+typedef struct SDAQ_shm_channel{
+	unsigned int seq;
+	float meas;
+	unsigned char unit;
+	unsigned char status;
+	unsigned short timestamp;//Device timestamp, msec
+	unsigned long long rx_time;//Host reception time
+}SDAQ_shm_ch;
+
+typedef struct SDAQ_shm_device{
+	unsigned int seq;
+	unsigned int serial_number;
+	unsigned char present;//Non zero while an SDAQ is at this address
+	unsigned char dev_type;
+	unsigned char status;
+	unsigned char num_of_ch;
+	unsigned long long last_seen;//Host reception time of the last Device_status
+	SDAQ_shm_ch ch[SDAQ_MAX_AMOUNT_OF_CHANNELS];//Index: channel-1
+}__attribute__((aligned(64))) SDAQ_shm_dev;
+
+typedef struct SDAQ_shm_table{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int writer_pid;
+	unsigned int size;//sizeof(SDAQ_shm_table)
+	SDAQ_shm_dev dev[SDAQ_SHM_ADDRS];//Index: SDAQ address
+}SDAQ_shm_table;
+
+/*
+ * Ring of the decoded measurements. Written only by the daemon of the CAN-IF, read by any amount of readers.
+ * head is the amount of records ever written, record n is at slot n % SDAQ_SHM_RING_SLOTS.
+ * The writer never waits for the readers. Each reader keeps its own cursor (the next n to read),
+ * and detects from the slot's seq that the writer has overwritten records that it didn't read (overrun).
+ * seq of a slot: Zero while the writer updates it, otherwise n+1 of the record in it.
+ */
+typedef struct SDAQ_shm_record{
+	unsigned long long seq;
+	unsigned long long rx_time;//Host reception time, nsec since Epoch
+	float meas;
+	unsigned char unit;
+	unsigned char status;
+	unsigned short timestamp;//Device timestamp, msec
+	unsigned char address;
+	unsigned char channel;//1..SDAQ_MAX_AMOUNT_OF_CHANNELS
+}SDAQ_shm_rec;
+
+typedef struct SDAQ_shm_ring{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int writer_pid;
+	unsigned int size;//sizeof(SDAQ_shm_ring)
+	unsigned long long head __attribute__((aligned(64)));
+	SDAQ_shm_rec slot[SDAQ_SHM_RING_SLOTS] __attribute__((aligned(64)));
+}SDAQ_shm_ring;
+
+//Cursor of a reader of the ring.
+typedef struct SDAQ_shm_ring_reader{
+	const SDAQ_shm_ring *ring;
+	unsigned long long cursor;//n of the next record to read
+	unsigned long long lost;//Amount of records lost due to overruns
+}SDAQ_shm_reader;
+
+	/*--- Writer, used by the daemon ---*/
+//Function that create the table of CAN-IF CANif_name. Return: The mapped table, or NULL on failure.
+SDAQ_shm_table *SDAQ_shm_table_create(const char *CANif_name);
+//Function that unmap and remove the table of CAN-IF CANif_name.
+void SDAQ_shm_table_destroy(SDAQ_shm_table *table, const char *CANif_name);
+//Function that update the device entry at address.
+void SDAQ_shm_dev_update(SDAQ_shm_table *table, unsigned char address, const sdaq_status *status, unsigned long long rx_time);
+//Function that update the amount of channels of the device at address.
+void SDAQ_shm_dev_info(SDAQ_shm_table *table, unsigned char address, const sdaq_info *info);
+//Function that mark the device at address as absent, and invalidate its channels.
+void SDAQ_shm_dev_remove(SDAQ_shm_table *table, unsigned char address);
+//Function that update the entry of channel (1..SDAQ_MAX_AMOUNT_OF_CHANNELS) of the device at address.
+void SDAQ_shm_ch_update(SDAQ_shm_table *table, unsigned char address, unsigned char channel, const sdaq_meas *meas, unsigned long long rx_time);
+//Function that create the measurements ring of CAN-IF CANif_name. Return: The mapped ring, or NULL on failure.
+SDAQ_shm_ring *SDAQ_shm_ring_create(const char *CANif_name);
+//Function that unmap and remove the ring of CAN-IF CANif_name.
+void SDAQ_shm_ring_destroy(SDAQ_shm_ring *ring, const char *CANif_name);
+//Function that append to ring the measurement of channel of the device at address.
+void SDAQ_shm_ring_push(SDAQ_shm_ring *ring, unsigned char address, unsigned char channel, const sdaq_meas *meas, unsigned long long rx_time);
+
+	/*--- Reader, header only. Readers can use it without linking with SDAQ_worker's objects ---*/
+/*
+ * Function that map read-only the table of CAN-IF CANif_name.
+ * Return: The table (unmap it with munmap(table, sizeof(SDAQ_shm_table))), or NULL on failure or version mismatch.
+ */
+static inline const SDAQ_shm_table *SDAQ_shm_table_open(const char *CANif_name)
+{
+	char name[64];
+	int fd;
+	SDAQ_shm_table *table;
+
+	snprintf(name, sizeof(name), SDAQ_SHM_TABLE_NAME, CANif_name);
+	if((fd = shm_open(name, O_RDONLY, 0)) < 0)
+		return NULL;
+	table = mmap(NULL, sizeof(SDAQ_shm_table), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(table == MAP_FAILED)
+		return NULL;
+	if(table->magic != SDAQ_SHM_MAGIC || table->version != SDAQ_SHM_VERSION || table->size != sizeof(SDAQ_shm_table))
+	{
+		munmap(table, sizeof(SDAQ_shm_table));
+		return NULL;
+	}
+	return table;
+}
+
+//Function that copy the device entry at address to out. Return: Non zero if an SDAQ is present at address.
+static inline int SDAQ_shm_dev_read(const SDAQ_shm_table *table, unsigned char address, SDAQ_shm_dev *out)
+{
+	const SDAQ_shm_dev *dev = &(table->dev[address % SDAQ_SHM_ADDRS]);
+	unsigned int seq;
+
+	do{
+		while((seq = __atomic_load_n(&dev->seq, __ATOMIC_ACQUIRE)) & 1)
+			;
+		out->serial_number = dev->serial_number;
+		out->present = dev->present;
+		out->dev_type = dev->dev_type;
+		out->status = dev->status;
+		out->num_of_ch = dev->num_of_ch;
+		out->last_seen = dev->last_seen;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	}while(__atomic_load_n(&dev->seq, __ATOMIC_RELAXED) != seq);
+	out->seq = seq;
+	return out->present;
+}
+
+//Function that copy the entry of channel (1..SDAQ_MAX_AMOUNT_OF_CHANNELS) of the device at address to out. Return: Non zero if the entry is valid.
+static inline int SDAQ_shm_ch_read(const SDAQ_shm_table *table, unsigned char address, unsigned char channel, SDAQ_shm_ch *out)
+{
+	const SDAQ_shm_ch *ch;
+	unsigned int seq;
+
+	if(!channel || channel > SDAQ_MAX_AMOUNT_OF_CHANNELS)
+		return 0;
+	ch = &(table->dev[address % SDAQ_SHM_ADDRS].ch[channel-1]);
+	do{
+		while((seq = __atomic_load_n(&ch->seq, __ATOMIC_ACQUIRE)) & 1)
+			;
+		out->meas = ch->meas;
+		out->unit = ch->unit;
+		out->status = ch->status;
+		out->timestamp = ch->timestamp;
+		out->rx_time = ch->rx_time;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	}while(__atomic_load_n(&ch->seq, __ATOMIC_RELAXED) != seq);
+	out->seq = seq;
+	return out->rx_time != 0;
+}
+
+/*
+ * Function that map read-only the ring of CAN-IF CANif_name, and attach reader to its newest record.
+ * Return: Zero on success (unmap with munmap((void *)reader->ring, sizeof(SDAQ_shm_ring))), or negative one on failure.
+ */
+static inline int SDAQ_shm_ring_open(const char *CANif_name, SDAQ_shm_reader *reader)
+{
+	char name[64];
+	int fd;
+	SDAQ_shm_ring *ring;
+
+	snprintf(name, sizeof(name), SDAQ_SHM_RING_NAME, CANif_name);
+	if((fd = shm_open(name, O_RDONLY, 0)) < 0)
+		return -1;
+	ring = mmap(NULL, sizeof(SDAQ_shm_ring), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(ring == MAP_FAILED)
+		return -1;
+	if(ring->magic != SDAQ_SHM_RING_MAGIC || ring->version != SDAQ_SHM_VERSION || ring->size != sizeof(SDAQ_shm_ring))
+	{
+		munmap(ring, sizeof(SDAQ_shm_ring));
+		return -1;
+	}
+	reader->ring = ring;
+	reader->cursor = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	reader->lost = 0;
+	return 0;
+}
+
+/*
+ * Function that copy the next record of reader to out, and advance its cursor.
+ * On overrun, the lost records are skipped and added to reader->lost.
+ * Return: One if a record copied to out, or zero if there is no new record.
+ */
+static inline int SDAQ_shm_ring_read(SDAQ_shm_reader *reader, SDAQ_shm_rec *out)
+{
+	const SDAQ_shm_rec *slot;
+	unsigned long long head, seq;
+
+	while(1)
+	{
+		head = __atomic_load_n(&reader->ring->head, __ATOMIC_ACQUIRE);
+		if(reader->cursor >= head)
+			return 0;
+		if(head - reader->cursor > SDAQ_SHM_RING_SLOTS)//Writer has lapped the reader.
+		{
+			reader->lost += head - reader->cursor - SDAQ_SHM_RING_SLOTS;
+			reader->cursor = head - SDAQ_SHM_RING_SLOTS;
+		}
+		slot = &(reader->ring->slot[reader->cursor % SDAQ_SHM_RING_SLOTS]);
+		seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+		if(seq == reader->cursor + 1)
+		{
+			*out = *slot;
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if(__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq)
+			{
+				reader->cursor++;
+				return 1;
+			}
+		}
+		//Slot is overwritten by a newer record, retry from the oldest record that is still on the ring.
+		reader->lost++;
+		reader->cursor++;
+	}
+}
+#endif //SDAQ_SHM_H
@@ -51,22 +51,25 @@ int main(int argc, char *argv[])
 						 .timestamp_format=NULL,
 						 .info_file=NULL,
 						 .ext_com=NULL,
+						 .logging_dir=NULL,
 						 .verify=0,
 						 .silent=0,
 						 .formatted_output=0,
 						 .resize=0,
-						 .timeout = 2 //second
+						 .no_registry=0,
+						 .no_daemon=0,
+						 .delta=0,
+						 .timeout = 2, //second
+						 .expected_devs = 0
 						};
+	char *mode;
 	//Variables for Socket CAN
-	struct timeval tv = {0};
-	struct ifreq ifr = {0};
-	struct sockaddr_can addr = {0};
-	struct can_filter RX_filter = {0};
-	sdaq_can_id *can_filter_enc;
+	struct can_filter RX_filters[SDAQ_MAX_FILTERS];
+	unsigned int amount_of_filters = 0;
 	int socket_num;
 	//Variables for SDAQ_dev
 	unsigned char dev_addr = 0;
-	unsigned int serial_number;
+	unsigned int serial_number = 0;
 
 	if(argc == 1)
 	{
@@ -75,7 +78,7 @@ int main(int argc, char *argv[])
 	}
 
 	opterr = 1;
-	while ((c = getopt (argc, argv, "hVvrlspt:S:T:f:e:")) != -1)
+	while ((c = getopt (argc, argv, "hVvrlspRDdt:n:S:T:f:e:")) != -1)
 	{
 		switch (c)
 		{
@@ -103,6 +106,15 @@ int main(int argc, char *argv[])
 					exit(EXIT_FAILURE);
 				}
 				break;
+			case 'R'://bypass the registry
+				usr_opt.no_registry = 1;
+				break;
+			case 'D'://bypass the daemon
+				usr_opt.no_daemon = 1;
+				break;
+			case 'd'://delta upload of the calibration
+				usr_opt.delta = 1;
+				break;
 			case 'p'://pretty (formatted) XML output
 				usr_opt.formatted_output=1;
 				break;
@@ -121,6 +133,14 @@ int main(int argc, char *argv[])
 					exit(EXIT_FAILURE);
 				}
 				break;
+			case 'n'://expected amount of SDAQs
+				if(atoi(optarg) <= 0)
+				{
+					fprintf(stderr,"Expected SDAQs argument is out of range.\n");
+					exit(EXIT_FAILURE);
+				}
+				usr_opt.expected_devs = atoi(optarg);
+				break;
 			case 'T':
 				// to be sanitized
 				//usr_opt.timestamp_format = optarg;
@@ -162,54 +182,12 @@ int main(int argc, char *argv[])
 		fprintf(stderr, "CAN-IF name too big (>=%d)\n", IFNAMSIZ);
 		exit(EXIT_FAILURE);
 	}
-	//CAN Socket Opening
-	if((socket_num = socket(PF_CAN, SOCK_RAW, CAN_RAW)) < 0)
-	{
-		perror("Error while opening socket");
-		exit(EXIT_FAILURE);
-	}
-	//Link interface name to socket
-	strcpy(ifr.ifr_name, usr_opt.CANif_name); // get value from CAN-IF arguments
-	if(ioctl(socket_num, SIOCGIFINDEX, &ifr))
-	{
-		perror("CAN-IF");
-		exit(EXIT_FAILURE);
-	}
-	/*Filter for CAN messages	-- SocketCAN Filters act as: <received_can_id> & mask == can_id & mask*/
-	//load filter's can_id member
-	can_filter_enc = (sdaq_can_id *)&RX_filter.can_id;//Set encoder to filter.can_id
-	memset(can_filter_enc, 0, sizeof(sdaq_can_id));
-	can_filter_enc->flags = 4;//set the EFF
-	can_filter_enc->protocol_id = PROTOCOL_ID; // Received Messages with protocol_id == PROTOCOL_ID
-	can_filter_enc->payload_type = 0x80; //  Received Messages with payload_type & 0x80 == TRUE, aka Master <- SDAQ.
-	//load filter's can_mask member
-	can_filter_enc = (sdaq_can_id *)&RX_filter.can_mask; //Set encoder to filter.can_mask
-	memset(can_filter_enc, 0, sizeof(sdaq_can_id));
-	can_filter_enc->flags = 4;//Received only messages with extended ID (29bit)
-	can_filter_enc->protocol_id = -1; // Protocol_id field marked for examination
-	can_filter_enc->payload_type = 0x80; // + The most significant bit of Payload_type field marked for examination.
-	setsockopt(socket_num, SOL_CAN_RAW, CAN_RAW_FILTER, &RX_filter, sizeof(RX_filter));
-
-	// Add timeout option to the CAN Socket
-	tv.tv_sec = 20;//interval time that a SDAQ send a Status/ID frame.
-	tv.tv_usec = 0;
-	setsockopt(socket_num, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
-
-	//Bind CAN Socket to address
-	addr.can_family  = AF_CAN;
-	addr.can_ifindex = ifr.ifr_ifindex;
-	if(bind(socket_num, (struct sockaddr *)&addr, sizeof(addr)) < 0)
-	{
-		perror("Error in socket bind");
-		exit(EXIT_FAILURE);
-	}
-
-	/*Scan Mode argument*/
-	//Modes with device address requirement
-	if(!strcmp(argv[optind+1],"discover"))
-		retval = Discover(socket_num, &usr_opt);
-	else if(!strcmp(argv[optind+1],"autoconfig"))
-		retval = Autoconfig(socket_num, &usr_opt);
+	/*Scan Mode argument, and build the CAN socket filters for it*/
+	mode = argv[optind+1];
+	if(!strcmp(mode,"discover") || !strcmp(mode,"autoconfig"))//Modes without device address requirement
+		SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, Broadcast, Device_status);
+	else if(!strcmp(mode,"daemon"))//Daemon receive all the messages from the SDAQs
+		SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, Broadcast, 0);
 	else //modes with device address requirement
 	{
 		//Sanity check of the device address arguments
@@ -218,7 +196,25 @@ int main(int argc, char *argv[])
 			printf("Address argument is missing\n");
 			exit(EXIT_FAILURE);
 		}
-		if(strcmp(argv[optind+2],"parking")) //check address argument for not be string "parking"
+		if(!strcmp(mode,"logging") && !strcmp(argv[optind+2],"stop"))//Stop the logging of the daemon
+		{
+			if((retval = Daemon_request(mode, Broadcast, 0, &usr_opt)) < 0)
+			{
+				printf("No daemon is serving %s\n", usr_opt.CANif_name);
+				exit(EXIT_FAILURE);
+			}
+			return retval;
+		}
+		if(!strcmp(argv[optind+2],"all"))
+		{
+			dev_addr = Broadcast;
+			if(strcmp(mode,"logging") && strcmp(mode,"getinfo") && strcmp(mode,"setinfo"))// argument all allowed only for "logging", "getinfo" and "setinfo" modes
+			{
+				printf("Device address: Out of range or invalid\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		else if(strcmp(argv[optind+2],"parking")) //check address argument for not be string "parking"
 		{
 			dev_addr = atoi(argv[optind+2]); // convert argument string to number
 			if(dev_addr<1||dev_addr>=Parking_address)
@@ -230,14 +226,14 @@ int main(int argc, char *argv[])
 		else
 		{
 			dev_addr = Parking_address;
-			if(strcmp(argv[optind+1],"setaddress"))// argument Parking allowed only for "setaddress" mode
+			if(strcmp(mode,"setaddress"))// argument Parking allowed only for "setaddress" mode
 			{
 				printf("Device address: Out of range or invalid\n");
 				exit(EXIT_FAILURE);
 			}
 		}
 		//Scan for the rest of the modes
-		if(!strcmp(argv[optind+1],"setaddress"))
+		if(!strcmp(mode,"setaddress"))
 		{
 			if(argv[optind+3]==NULL)
 			{
@@ -250,19 +246,57 @@ int main(int argc, char *argv[])
 				printf("Serial number is invalid\n");
 				exit(EXIT_FAILURE);
 			}
-			retval = Change_address(socket_num,serial_number, dev_addr, &usr_opt);
+			SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, dev_addr, Device_status);
+		}
+		else if(!strcmp(mode,"getinfo") || !strcmp(mode,"setinfo"))
+		{
+			SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, dev_addr, Device_status);
+			SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, dev_addr, Device_info);
+			SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, dev_addr, Calibration_Date);
+			SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, dev_addr, Calibration_Point_Data);
+		}
+		else if(!strcmp(mode,"measure"))
+			SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, dev_addr, 0);
+		else if(!strcmp(mode,"logging"))
+		{
+			if(argv[optind+3]==NULL)
+			{
+				printf("Logging directory is missing\n");
+				exit(EXIT_FAILURE);
+			}
+			usr_opt.logging_dir = argv[optind+3];
+			SDAQ_filter_build(&RX_filters[amount_of_filters++], SDAQ_to_Master, dev_addr, Measurement_value);
 		}
-		else if(!strcmp(argv[optind+1],"getinfo"))
-			retval = getinfo(socket_num, dev_addr, &usr_opt);
-		else if(!strcmp(argv[optind+1],"setinfo"))
-			retval = setinfo(socket_num, dev_addr, &usr_opt);
-		else if(!strcmp(argv[optind+1],"measure"))
-			retval = Measure(socket_num, dev_addr, &usr_opt);
-		else if(!strcmp(argv[optind+1],"logging"))
-			retval = Logging(socket_num, dev_addr, &usr_opt);
 		else
+		{
 			printf("Unknown mode argument\n");
+			exit(EXIT_FAILURE);
+		}
 	}
+	//Modes that are served by the daemon of the CAN-IF, if there is one.
+	if(!usr_opt.no_daemon && (retval = Daemon_request(mode, dev_addr, serial_number, &usr_opt)) >= 0)
+		return retval;
+	//CAN Socket Opening, with timeout the interval time that a SDAQ send a Status/ID frame.
+	if((socket_num = SDAQ_socket_open(usr_opt.CANif_name, RX_filters, amount_of_filters, 20)) < 0)
+		exit(EXIT_FAILURE);
+
+	/*Execute the Mode*/
+	if(!strcmp(mode,"discover"))
+		retval = Discover(socket_num, &usr_opt);
+	else if(!strcmp(mode,"autoconfig"))
+		retval = Autoconfig(socket_num, &usr_opt);
+	else if(!strcmp(mode,"setaddress"))
+		retval = Change_address(socket_num,serial_number, dev_addr, &usr_opt);
+	else if(!strcmp(mode,"getinfo"))
+		retval = getinfo(socket_num, dev_addr, &usr_opt);
+	else if(!strcmp(mode,"setinfo"))
+		retval = setinfo(socket_num, dev_addr, &usr_opt);
+	else if(!strcmp(mode,"measure"))
+		retval = Measure(socket_num, dev_addr, &usr_opt);
+	else if(!strcmp(mode,"logging"))
+		retval = Logging(socket_num, dev_addr, &usr_opt);
+	else if(!strcmp(mode,"daemon"))
+		retval = Daemon(socket_num, &usr_opt);
 	close(socket_num);
 	return retval;
 }
@@ -271,10 +305,12 @@ int Change_address(int socket_num, unsigned int serial_number, unsigned char new
 {
 	unsigned char amount_of_tests=usr_flag->timeout;
 	//CAN Socket and SDAQ related variables
+	SDAQ_rx_batch rx;
 	struct can_frame frame_rx;
 	int RX_bytes;
 	sdaq_can_id *id_dec = (sdaq_can_id *)&(frame_rx.can_id);
 	sdaq_status *status_dec = (sdaq_status *)(frame_rx.data);
+	SDAQ_rx_init(&rx, socket_num);
 	SetDeviceAddress(socket_num, serial_number, new_address);
 	if(usr_flag->verify)
 	{
@@ -289,7 +325,7 @@ int Change_address(int socket_num, unsigned int serial_number, unsigned char new
 			sleep(1);
 			putchar('.');
 			fflush(stdout);
-			RX_bytes=read(socket_num, &frame_rx, sizeof(frame_rx));
+			RX_bytes=SDAQ_rx(&rx, &frame_rx, NULL);
 			if(RX_bytes==sizeof(frame_rx))
 			{
 				if(id_dec->device_addr==new_address && status_dec->dev_sn == serial_number)
@@ -337,13 +373,24 @@ void print_usage(char *prog_name)
 		"                (Usage: SDAQ_worker CAN-IF setaddress 'new_address' 'Serial_number_of_SDAQ')\n"
 		"       getinfo: Get all the available information of a SDAQ device.\n"
 		"                (Usage: SDAQ_worker CAN-IF getinfo 'SDAQ_address')\n"
+		"                With address 'all', get the info of every SDAQ on the bus, with one fleet XML for all.\n"
 		"       setinfo: Set the Calibration data and points information on a SDAQ device.\n"
 		"                (Usage: SDAQ_worker CAN-IF setinfo 'SDAQ_address')\n"
+		"                With address 'all', apply the manifest (-f, a fleet XML as written by getinfo all)\n"
+		"                to every SDAQ on the bus, matched by serial number.\n"
 		"       measure: Get the measurements, status and info of a SDAQ device.\n"
 		"                (Usage: SDAQ_worker CAN-IF measure 'SDAQ_address')\n"
 		"       logging: Get and log the measurement of a SDAQ device to a file.\n"
-		"                (Usage: SDAQ_worker CAN-IF logging 'SDAQ_address' 'Path/to/the/logging_directory')\n\n"
-		"ADDRESS: A valid SDAQ address. Resolution 1..62 (also 'Parking' for Mode 'setaddress')\n\n"
+		"                (Usage: SDAQ_worker CAN-IF logging 'SDAQ_address' 'Path/to/the/logging_directory')\n"
+		"                With a daemon, the logging runs at the daemon until: SDAQ_worker CAN-IF logging stop\n"
+		"        daemon: Own the CAN-IF and serve the modes discover, getinfo, setaddress, measure (snapshot)\n"
+		"                and logging to the other invocations of SDAQ_worker, over a local control socket.\n"
+		"                The latest values of the SDAQs are published at the shared memory /SDAQ_table_CAN-IF\n"
+		"                and every measurement is appended to the shared memory ring /SDAQ_ring_CAN-IF\n"
+		"                (see src/SDAQ_shm.h for the readers).\n"
+		"                (Usage: SDAQ_worker CAN-IF daemon)\n\n"
+		"ADDRESS: A valid SDAQ address. Resolution 1..62 (also 'Parking' for Mode 'setaddress',\n"
+		"         and 'all' for Modes 'logging', 'getinfo' and 'setinfo' to use every SDAQ on the bus)\n\n"
 		"Options:\n"
 		"           -h : Print help.\n"
 		"           -V : Version.\n"
@@ -354,7 +401,15 @@ void print_usage(char *prog_name)
 		"           -f : Write/Read SDAQ info to/from XML file.\n"
 		"           -p : Formatted XML output. Used with mode 'getinfo'.\n"
 		"           -e : External command. Used with mode 'setinfo'.\n"
+		"           -R : Bypass the registry of the known SDAQs. Used with modes 'getinfo',\n"
+		"                'setinfo', 'discover' and 'autoconfig'.\n"
+		"           -D : Access the CAN-IF directly, even if a daemon serves it.\n"
+		"           -d : Delta upload. Used with mode 'setinfo' and -f, write to the SDAQ only the dates\n"
+		"                and the points that differ from the XML (and verify only those, with -v).\n"
 		"  -t <Timeout>: Discover Timeout (sec). (0 < Timeout < 20) default: 2 Sec.\n"
+		"                The scan ends earlier when no new SDAQ answers for a while.\n"
+		"  -n <Amount> : Expected amount of SDAQs. Used with modes 'discover' and 'autoconfig'\n"
+		"                to end the scan when all of them are found.\n"
 		"  -S <Mode>   : Timestamp mode. (A)bsolute/(R)elative/(D)ate.\n"
 		"  -T <format> : Timestamp format, works with -S Date.\n"
 		"\n"
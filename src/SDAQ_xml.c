@@ -28,6 +28,8 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <libxml/xmlmemory.h>
 #include <libxml/parser.h>
+#include <libxml/xmlwriter.h>
+#include <libxml/xmlreader.h>
 
 #include "info.h"//including -> "SDAQ_drv.h", "Modes.h"
 #include "SDAQ_xml.h"
@@ -41,139 +43,258 @@ enum contens_type{
 	t_string
 };
 
-//Custom function that convert an type (contens_type) to a node with name name_mode
-xmlNodePtr xml_SDAQ_data(xmlNodePtr root_node , unsigned char *node_name, void *contents_ptr, unsigned char type);
+//Writer of a fleet document
+struct XML_fleet_writer{
+	FILE *fp;
+	xmlTextWriterPtr writer;//Streaming writer, each SDAQ is flushed to fp as soon as it's added
+	unsigned int amount;//Amount of added SDAQs
+	unsigned char format_flag;
+};
+
+//Custom function that write an type (contens_type) as a node with name node_name. Return: 0 on success, -1 on failure.
+int xml_SDAQ_data(xmlTextWriterPtr writer, const char *node_name, void *contents_ptr, unsigned char type);
+//Function that write the SDAQ_info and the Calibration_Data of info_ptr as children of the current node. Return: 0 on success, -1 on failure.
+int xml_SDAQ_info_cal_data(xmlTextWriterPtr writer, SDAQ_info_cal_data *info_ptr);
 
+/*
+ * The XMLs are written with xmlTextWriter, node by node without a DOM. The output is the same with the one
+ * of xmlSaveFormatFileEnc() ("  " indent at format_flag), and the memory usage is independent of the amount of SDAQs.
+ */
 int XML_info_file_write(char *file_path, void *arg, unsigned char exp_format_flag)
+{
+	xmlTextWriterPtr writer;
+	int retval = 0;
+
+	if(!(writer = xmlNewTextWriterFilename(file_path, 0)))
+	{
+		fprintf(stderr, "Failed to open %s\n", file_path);
+		return 1;
+	}
+	xmlTextWriterSetIndent(writer, exp_format_flag);
+	xmlTextWriterSetIndentString(writer, BAD_CAST "  ");
+	if(xmlTextWriterStartDocument(writer, NULL, "UTF-8", NULL) < 0 ||
+	   xmlTextWriterStartElement(writer, BAD_CAST "SDAQ") < 0 ||
+	   xml_SDAQ_info_cal_data(writer, arg) < 0 ||
+	   xmlTextWriterEndDocument(writer) < 0)
+		retval = 1;
+	xmlFreeTextWriter(writer);
+	return retval;
+}
+
+XML_fleet_writer *XML_fleet_open(const char *file_path, const char *CANif_name, unsigned char format_flag)
+{
+	XML_fleet_writer *writer;
+	char date_str[30];
+	time_t now = time(NULL);
+
+	if(!(writer = calloc(1, sizeof(XML_fleet_writer))))
+	{
+		fprintf(stderr,"Memory Error!!!\n");
+		exit(EXIT_FAILURE);
+	}
+	if(!strcmp(file_path, "-"))
+		writer->fp = stdout;
+	else if(!(writer->fp = fopen(file_path, "w")))
+	{
+		perror("Fleet file");
+		free(writer);
+		return NULL;
+	}
+	if(!(writer->writer = xmlNewTextWriter(xmlOutputBufferCreateFile(writer->fp, NULL))))
+	{
+		fprintf(stderr,"Memory Error!!!\n");
+		exit(EXIT_FAILURE);
+	}
+	writer->format_flag = format_flag;
+	xmlTextWriterSetIndent(writer->writer, format_flag);
+	xmlTextWriterSetIndentString(writer->writer, BAD_CAST "  ");
+	strftime(date_str, sizeof(date_str), "%Y/%m/%d %H:%M:%S", localtime(&now));
+	xmlTextWriterStartDocument(writer->writer, NULL, "UTF-8", NULL);
+	xmlTextWriterStartElement(writer->writer, BAD_CAST "SDAQ_fleet");
+	xmlTextWriterWriteAttribute(writer->writer, BAD_CAST "CAN-IF", BAD_CAST CANif_name);
+	xmlTextWriterWriteAttribute(writer->writer, BAD_CAST "Date", BAD_CAST date_str);
+	xmlTextWriterFlush(writer->writer);
+	return writer;
+}
+
+void XML_fleet_add(XML_fleet_writer *writer, unsigned char address, void *arg, const char *error, double elapsed)
 {
 	SDAQ_info_cal_data *info_ptr = arg;
-	xmlDocPtr xml_doc = NULL;
-    xmlNodePtr root_node = NULL, w_node = NULL,  w_node1 = NULL, w_node2 = NULL;
-	unsigned char buff[20], *point_name, cal_unit;
-    //Creates a new document, a node and set it as a root node
-    xml_doc = xmlNewDoc(BAD_CAST "1.0");
-    root_node = xmlNewNode(NULL, BAD_CAST "SDAQ");
-	xmlDocSetRootElement(xml_doc, root_node);
+
+	xmlTextWriterStartElement(writer->writer, BAD_CAST "SDAQ");
+	xmlTextWriterWriteFormatAttribute(writer->writer, BAD_CAST "Address", "%u", address);
+	xmlTextWriterWriteFormatAttribute(writer->writer, BAD_CAST "Time_msec", "%.1f", elapsed);
+	if(error)
+	{
+		xmlTextWriterWriteAttribute(writer->writer, BAD_CAST "Error", BAD_CAST error);
+		if(info_ptr && info_ptr->SDAQ_info.serial_number)
+			xmlTextWriterWriteFormatAttribute(writer->writer, BAD_CAST "SerialNumber", "%u", info_ptr->SDAQ_info.serial_number);
+	}
+	else
+		xml_SDAQ_info_cal_data(writer->writer, info_ptr);
+	xmlTextWriterEndElement(writer->writer);
+	//The SDAQ is written out, nothing is kept for the next one.
+	xmlTextWriterFlush(writer->writer);
+	fflush(writer->fp);
+	writer->amount++;
+}
+
+int XML_fleet_close(XML_fleet_writer *writer)
+{
+	int retval = 0;
+
+	if(!writer->amount && writer->format_flag)//Same as a DOM root without children.
+		xmlTextWriterWriteRaw(writer->writer, BAD_CAST "\n");
+	if(xmlTextWriterFullEndElement(writer->writer) < 0 || xmlTextWriterEndDocument(writer->writer) < 0)
+		retval = 1;
+	xmlFreeTextWriter(writer->writer);
+	if(ferror(writer->fp))
+		retval = 1;
+	if(writer->fp != stdout && fclose(writer->fp))
+		retval = 1;
+	free(writer);
+	return retval;
+}
+
+int xml_SDAQ_info_cal_data(xmlTextWriterPtr writer, SDAQ_info_cal_data *info_ptr)
+{
+	char buff[20], *point_name;
+	unsigned char cal_unit;
+	int ret = 0;
+	SDAQ_cal_model *cal = SDAQ_cal_model_get(info_ptr);
 	//Add SDAQ info to xml
-	w_node = xmlNewChild(root_node, NULL, BAD_CAST "SDAQ_info", NULL);
-	xml_SDAQ_data(w_node, BAD_CAST "SerialNumber", &(info_ptr->SDAQ_info.serial_number), t_integer_uint);
- 	xml_SDAQ_data(w_node, BAD_CAST "Type",(char *) info_ptr->SDAQ_info.dev_type, t_string);
- 	xml_SDAQ_data(w_node, BAD_CAST "Firmware_Rev", &(info_ptr->SDAQ_info.firm_rev), t_integer_ubyte);
-    xml_SDAQ_data(w_node, BAD_CAST "Hardware_Rev", &(info_ptr->SDAQ_info.hw_rev), t_integer_ubyte);
-    xml_SDAQ_data(w_node, BAD_CAST "Available_Channels", &(info_ptr->SDAQ_info.num_of_ch), t_integer_ubyte);
-	xml_SDAQ_data(w_node, BAD_CAST "Samplerate", &(info_ptr->SDAQ_info.sample_rate), t_integer_ubyte);
-	xml_SDAQ_data(w_node, BAD_CAST "Max_num_of_cal_points", &(info_ptr->SDAQ_info.max_cal_point), t_integer_ubyte);
-	//Add calibration data. Calibration data node is the new root
-	root_node = xmlNewChild(root_node, NULL, BAD_CAST "Calibration_Data", NULL);
-	for(int i=0;i<info_ptr->SDAQ_info.num_of_ch;i++)
+	ret |= xmlTextWriterStartElement(writer, BAD_CAST "SDAQ_info");
+	ret |= xml_SDAQ_data(writer, "SerialNumber", &(info_ptr->SDAQ_info.serial_number), t_integer_uint);
+	ret |= xml_SDAQ_data(writer, "Type", (char *) info_ptr->SDAQ_info.dev_type, t_string);
+	ret |= xml_SDAQ_data(writer, "Firmware_Rev", &(info_ptr->SDAQ_info.firm_rev), t_integer_ubyte);
+	ret |= xml_SDAQ_data(writer, "Hardware_Rev", &(info_ptr->SDAQ_info.hw_rev), t_integer_ubyte);
+	ret |= xml_SDAQ_data(writer, "Available_Channels", &(info_ptr->SDAQ_info.num_of_ch), t_integer_ubyte);
+	ret |= xml_SDAQ_data(writer, "Samplerate", &(info_ptr->SDAQ_info.sample_rate), t_integer_ubyte);
+	ret |= xml_SDAQ_data(writer, "Max_num_of_cal_points", &(info_ptr->SDAQ_info.max_cal_point), t_integer_ubyte);
+	ret |= xmlTextWriterEndElement(writer);
+	//Add calibration data
+	ret |= xmlTextWriterStartElement(writer, BAD_CAST "Calibration_Data");
+	for(int i=0;i<info_ptr->SDAQ_info.num_of_ch && i<SDAQ_MAX_AMOUNT_OF_CHANNELS;i++)
 	{
 		//Add xml_node for Channel
-		sprintf((char*)buff, "CH%d", i+1);
-		w_node = xmlNewChild(root_node, NULL, buff, NULL);
+		sprintf(buff, "CH%d", i+1);
+		ret |= xmlTextWriterStartElement(writer, BAD_CAST buff);
 		//Add channel's Calibration date and amount of used points
-		xml_SDAQ_data(w_node, BAD_CAST "Calibration_date",
-			g_slist_nth_data((GSList *)info_ptr->Calibration_date_list,i), t_cal_date);
-		xml_SDAQ_data(w_node, BAD_CAST "Calibration_Period",
-			&((date_list_data_of_node *)g_slist_nth_data((GSList *)info_ptr->Calibration_date_list,i))->period, t_integer_ubyte);
-		xml_SDAQ_data(w_node, BAD_CAST "Used_Points",
-			&((date_list_data_of_node *)g_slist_nth_data((GSList *)info_ptr->Calibration_date_list,i))->amount_of_points, t_integer_ubyte);
-		cal_unit = ((date_list_data_of_node *)g_slist_nth_data((GSList *)info_ptr->Calibration_date_list,i))->cal_unit;
-		//sprintf((char*)buff, "%s%s", unit_str[cal_unit], cal_unit<Unit_code_base_region_size?"(Base)":"");
-		sprintf((char*)buff, "%s", unit_str[cal_unit]);
-		xml_SDAQ_data(w_node, BAD_CAST "Unit", buff, t_string);
+		ret |= xml_SDAQ_data(writer, "Calibration_date", &(cal->date[i]), t_cal_date);
+		ret |= xml_SDAQ_data(writer, "Calibration_Period", &(cal->date[i].period), t_integer_ubyte);
+		ret |= xml_SDAQ_data(writer, "Used_Points", &(cal->date[i].amount_of_points), t_integer_ubyte);
+		cal_unit = cal->date[i].cal_unit;
+		//sprintf(buff, "%s%s", unit_str[cal_unit], cal_unit<Unit_code_base_region_size?"(Base)":"");
+		sprintf(buff, "%s", unit_str[cal_unit]);
+		ret |= xml_SDAQ_data(writer, "Unit", buff, t_string);
 		//Add points for channel
-		w_node1 = xmlNewChild(w_node, NULL, BAD_CAST "Points", NULL);
-		for(int j=0; j < info_ptr->SDAQ_info.max_cal_point; j++)
+		ret |= xmlTextWriterStartElement(writer, BAD_CAST "Points");
+		for(int j=0; j < info_ptr->SDAQ_info.max_cal_point && j < MAX_AMOUNT_OF_POINTS; j++)
 		{
-			sprintf((char*)buff, "Point_%d",j);
-			w_node2 = xmlNewChild(w_node1, NULL, buff, NULL);
+			sprintf(buff, "Point_%d",j);
+			ret |= xmlTextWriterStartElement(writer, BAD_CAST buff);
 			for(int k=0; k<6; k++)
 			{
 				switch(k+1)
 				{
-					case meas: point_name = (unsigned char*)"Measure"; break;
-					case ref: point_name =  (unsigned char*)"Reference"; break;
-					case offset: point_name = (unsigned char*)"Offset"; break;
-					case gain: point_name = (unsigned char*)"Gain"; break;
-					case C2: point_name = (unsigned char*)"C2"; break;
-					case C3: point_name = (unsigned char*)"C3"; break;
+					case meas: point_name = "Measure"; break;
+					case ref: point_name = "Reference"; break;
+					case offset: point_name = "Offset"; break;
+					case gain: point_name = "Gain"; break;
+					case C2: point_name = "C2"; break;
+					case C3: point_name = "C3"; break;
 				}
-				xml_SDAQ_data(w_node2, point_name,
-				&(((sdaq_calibration_points_data *)g_slist_nth_data(((GSList *)info_ptr->Cal_points_data_lists[i]), j*6+k))->data_of_point), t_float);
+				ret |= xml_SDAQ_data(writer, point_name, &(cal->point[i][j][k]), t_float);
 			}
+			ret |= xmlTextWriterEndElement(writer);
 		}
+		ret |= xmlTextWriterEndElement(writer);//Points
+		ret |= xmlTextWriterEndElement(writer);//CHn
 	}
-    //Write the xml_doc to stdout or to file
-    xmlSaveFormatFileEnc(file_path, xml_doc, "UTF-8", exp_format_flag);
-	//Free allocated memory
-	xmlFreeDoc(xml_doc);
-	xmlCleanupParser();
-    //This is to debug memory for regression tests
-    xmlMemoryDump();
-	return 0;
+	ret |= xmlTextWriterEndElement(writer);//Calibration_Data
+	return ret < 0 ? -1 : 0;
 }
 
-xmlNodePtr xml_SDAQ_data(xmlNodePtr root_node , unsigned char *node_name, void *contents_ptr, unsigned char type)
+int xml_SDAQ_data(xmlTextWriterPtr writer, const char *node_name, void *contents_ptr, unsigned char type)
 {
-	unsigned char buff[60],*buff_ptr=buff;
+	char buff[60],*buff_ptr=buff;
 	date_list_data_of_node * node_dec = contents_ptr;
 	struct tm ptm={0};
-	xmlNodePtr node;
 	switch(type)
 	{
 		case t_float:
-			sprintf((char*)buff,"%g",*((float *)contents_ptr));
+			sprintf(buff,"%g",*((float *)contents_ptr));
 			break;
 		case t_integer_ubyte:
-			sprintf((char*)buff,"%u",*((unsigned char*)contents_ptr));
+			sprintf(buff,"%u",*((unsigned char*)contents_ptr));
 			break;
 		case t_integer_ushort:
-			sprintf((char*)buff,"%u",*((unsigned short*)contents_ptr));
+			sprintf(buff,"%u",*((unsigned short*)contents_ptr));
 			break;
 		case t_integer_uint:
-			sprintf((char*)buff,"%u",*((unsigned int*)contents_ptr));
+			sprintf(buff,"%u",*((unsigned int*)contents_ptr));
 			break;
 		case t_cal_date:
 			ptm.tm_year = node_dec->year + 100; //100 = 2000-1900
 			ptm.tm_mon = node_dec->month - 1;
 			ptm.tm_mday =  node_dec->day;
-			strftime((char*)buff_ptr,sizeof(buff),"%Y/%m/%d",&ptm);
+			strftime(buff_ptr,sizeof(buff),"%Y/%m/%d",&ptm);
 			break;
 		case t_string:
-			buff_ptr = (unsigned char*)contents_ptr;
+			buff_ptr = (char*)contents_ptr;
 			break;
 		default :
-			return NULL;
+			return -1;
 	}
-	node = xmlNewChild(root_node, NULL, node_name, buff_ptr);
-	return node;
+	//An empty or NULL (unknown type) content is written as an empty element, like a DOM node without text.
+	if(!buff_ptr || !*buff_ptr)
+		return xmlTextWriterStartElement(writer, BAD_CAST node_name) < 0 || xmlTextWriterEndElement(writer) < 0 ? -1 : 0;
+	return xmlTextWriterWriteElement(writer, BAD_CAST node_name, BAD_CAST buff_ptr) < 0 ? -1 : 0;
 }
 
 		//-- Local XML read/get Functions--//
-//Get an node by it's name. Search in the space of root_node. Return node on found, NULL otherwise.
-xmlNode * get_XML_node_by_name(xmlNode *root_node, const char *Node_name);
-//Populate the SDAQ_info section of the new_config with data from XML. Return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
-int populate_SDAQ_info(xmlNode *SDAQ_info, SDAQ_info_cal_data *SDAQs_new_config);
-//Populate Calibration_date_list and Cal_points_data_lists sections of new_config. Return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
-int populate_Calibration_Data(xmlNode *Calibration_Data, SDAQ_info_cal_data *SDAQs_new_config);
-
-int find_appearances_of_a_XML_node(xmlNode *root_node, const char *Node_name)
+/*
+ * The XMLs are read in one pass with an xmlTextReader, without a DOM. Each node is validated and
+ * loaded to the calibration model as it's read, and the errors are reported with the line of their node.
+ */
+//State of the load of a node SDAQ.
+typedef struct xml_SDAQ_loader{
+	xmlTextReaderPtr reader;
+	SDAQ_info_cal_data *conf;//SDAQ under load
+	long info_line;//Line of the node SDAQ_info
+	long ch_line[SDAQ_MAX_AMOUNT_OF_CHANNELS];//Line of the node of each loaded channel
+	unsigned char ch_pos[SDAQ_MAX_AMOUNT_OF_CHANNELS];//Position of the node of each loaded channel in Calibration_Data, from 1
+}xml_SDAQ_loader;
+
+//Open a reader for the XML at file_path, or for the XML from STDIN if file_path is "-". Return the reader, or NULL on failure.
+xmlTextReaderPtr xml_reader_open(char *file_path);
+//Read the rest of the XML, and free the reader. Return EXIT_SUCCESS if the XML is well formed, EXIT_FAILURE otherwise.
+int xml_reader_close(xmlTextReaderPtr reader, char *file_path);
+//Move the reader to the next child element of the element at depth. Return: 1 at a child, 0 at the end of the element, -1 on parse error.
+int xml_next_child(xmlTextReaderPtr reader, int depth);
+//Get the content of the element at the reader (freed with xmlFree). Return: The content, or NULL if the element does not have content.
+xmlChar *xml_content(xmlTextReaderPtr reader);
+//Convert the node SDAQ at the reader to new_config. Return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+int xml_SDAQ_node_read(xmlTextReaderPtr reader, SDAQ_info_cal_data *SDAQs_new_config);
+//Populate the SDAQ_info section of the new_config with the node SDAQ_info at the reader. Return EXIT_SUCCESS on success, EXIT_FAILURE otherwise.
+int populate_SDAQ_info(xml_SDAQ_loader *loader);
+//Populate the calibration model (dates and points) of new_config with the node Calibration_Data at the reader. Return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+int populate_Calibration_Data(xml_SDAQ_loader *loader);
+//Populate the calibration date and the points of channel with the node CHn at the reader. Return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+int populate_channel(xml_SDAQ_loader *loader, unsigned char channel);
+//Populate the points of channel with the node Points at the reader, amount_of_points is the amount of the loaded points. Return EXIT_SUCCESS on success, otherwise EXIT_FAILURE.
+int populate_Points(xml_SDAQ_loader *loader, unsigned char channel, unsigned char *amount_of_points);
+
+//Line of the current node of the reader
+static inline long xml_line(xmlTextReaderPtr reader)
 {
-	int cnt=0;
-	xmlNode *cur_node;
+	return xmlGetLineNo(xmlTextReaderCurrentNode(reader));
+}
 
-	if (root_node->type == XML_ELEMENT_NODE)
-	{
-		for (cur_node = root_node->children; cur_node; cur_node = cur_node->next)
-		{
-			if (cur_node->type == XML_ELEMENT_NODE)
-			{
-				if(!strcmp((char *)(cur_node->name), Node_name))
-					cnt++;
-			}
-		}
-	}
-	return cnt;
+//Check for a parse error, it's reported by libxml2 and with "Failed to parse" at xml_reader_close().
+static inline int xml_parse_error(xmlTextReaderPtr reader)
+{
+	return xmlTextReaderReadState(reader) == XML_TEXTREADER_MODE_ERROR;
 }
 
 /*
@@ -182,99 +303,138 @@ int find_appearances_of_a_XML_node(xmlNode *root_node, const char *Node_name)
  */
 int XML_info_file_read_and_validate(char *file_path, void *new_conf)
 {
-	SDAQ_info_cal_data *SDAQs_new_config = new_conf;
-	int SDAQ_info_cnt, Calibration_Data_cnt, retval = EXIT_FAILURE;
-	int wc;
-	GString *gstring_from_stdin;
-	char *filename = file_path;
-	xmlDocPtr doc = NULL;
-	xmlNode *SDAQ_root = NULL, *SDAQ_info = NULL, *Calibration_Data = NULL;
+	int retval = EXIT_FAILURE;
+	xmlTextReaderPtr reader;
 
 	if(!file_path||!new_conf)
 		return EXIT_FAILURE;
-    //--- Parse the file or the data from STDIN ---//
-    if(file_path[0]=='-')//Check if the data comes from STDIN
+	if(!(reader = xml_reader_open(file_path)))
+		return EXIT_FAILURE;
+	if(xml_next_child(reader, -1) > 0)
 	{
-		filename = "STDIN";
-		if(!(gstring_from_stdin = g_string_new(NULL)))
-		{
-			fprintf(stderr, "Memory Error!!!\n");
-			exit(EXIT_FAILURE);
-		}
-		while((wc = getchar()) != EOF)
-			gstring_from_stdin = g_string_append_c(gstring_from_stdin, wc);
-		doc = xmlReadMemory(gstring_from_stdin->str, gstring_from_stdin->len, "", NULL, XML_PARSE_NOBLANKS);
-		g_string_free(gstring_from_stdin, TRUE);
+		if(!strcmp((const char *)xmlTextReaderConstName(reader), "SDAQ"))
+			retval = xml_SDAQ_node_read(reader, new_conf);
+		else
+			fprintf(stderr, "XML's root element name != \"SDAQ\"\n");
 	}
-	else
-		doc = xmlReadFile(filename, NULL, XML_PARSE_NOBLANKS);
-	if(doc)
-    {
-		/*Get the root element node */
-		SDAQ_root = xmlDocGetRootElement(doc);
-		if(!strcmp((const char*)(SDAQ_root->name), "SDAQ"))
+	if(xml_reader_close(reader, file_path))
+		retval = EXIT_FAILURE;
+	return retval;
+}
+
+int XML_fleet_file_read(char *file_path, void **new_confs)
+{
+	GArray *confs = NULL;
+	SDAQ_info_cal_data conf;
+	xmlTextReaderPtr reader;
+	xmlChar *error;
+	int ret = -1;
+	long line;
+
+	if(!file_path||!new_confs)
+		return -1;
+	*new_confs = NULL;
+	if(!(reader = xml_reader_open(file_path)))
+		return -1;
+	if(xml_next_child(reader, -1) > 0)
+	{
+		if(!strcmp((const char *)xmlTextReaderConstName(reader), "SDAQ_fleet"))
 		{
-			SDAQ_info_cnt=find_appearances_of_a_XML_node(SDAQ_root, "SDAQ_info");
-			Calibration_Data_cnt=find_appearances_of_a_XML_node(SDAQ_root, "Calibration_Data");
-			if(SDAQ_info_cnt==1 && Calibration_Data_cnt==1)
+			//Zero terminated, same as the array of the confs.
+			confs = g_array_new(TRUE, TRUE, sizeof(SDAQ_info_cal_data));
+			for(ret = !xmlTextReaderIsEmptyElement(reader); ret && (ret = xml_next_child(reader, 0)) > 0;)
 			{
-				SDAQ_info=get_XML_node_by_name(SDAQ_root, "SDAQ_info");
-				Calibration_Data=get_XML_node_by_name(SDAQ_root, "Calibration_Data");
-				if(SDAQ_info && Calibration_Data)
+				if(strcmp((const char *)xmlTextReaderConstName(reader), "SDAQ"))
+					continue;
+				if((error = xmlTextReaderGetAttribute(reader, BAD_CAST "Error")))//SDAQs that failed at getinfo have only their address.
 				{
-					if(!(retval = populate_SDAQ_info(SDAQ_info, SDAQs_new_config)))
-						retval = populate_Calibration_Data(Calibration_Data, SDAQs_new_config);
+					xmlFree(error);
+					continue;
 				}
-				else
+				memset(&conf, 0, sizeof(conf));
+				line = xml_line(reader);
+				if(xml_SDAQ_node_read(reader, &conf))
 				{
-					if(!SDAQ_info)
-						fprintf(stderr, "XML node \"SDAQ_info\" Not found!!!\n");
-					if(!Calibration_Data)
-						fprintf(stderr, "XML node \"Calibration_Data\" Not found!!!\n");
+					fprintf(stderr, "Invalid SDAQ node at line %ld!!!\n", line);
+					free_SDAQ_info_cal_data(&conf);
+					ret = -1;
+					break;
 				}
-			}
-			else
-			{
-				if(SDAQ_info_cnt>1)
-					fprintf(stderr, "XML node \"SDAQ_info\" found %d times!!!\n", SDAQ_info_cnt);
-				if(Calibration_Data_cnt>1)
-					fprintf(stderr, "XML node \"Calibration_Data\" found %d times!!!\n", Calibration_Data_cnt);
+				g_array_append_val(confs, conf);
 			}
 		}
 		else
-			fprintf(stderr, "XML's root element name != \"SDAQ\"\n");
+			fprintf(stderr, "XML's root element name != \"SDAQ_fleet\"\n");
 	}
+	if(xml_reader_close(reader, file_path))
+		ret = -1;
+	if(!confs)
+		return -1;
+	if(ret)
+	{
+		for(unsigned int i=0; i<confs->len; i++)
+			free_SDAQ_info_cal_data(&g_array_index(confs, SDAQ_info_cal_data, i));
+		g_array_free(confs, TRUE);
+		return -1;
+	}
+	ret = confs->len;
+	*new_confs = g_array_free(confs, FALSE);
+	return ret;
+}
+
+xmlTextReaderPtr xml_reader_open(char *file_path)
+{
+	xmlTextReaderPtr reader;
+
+	if(file_path[0]=='-')//Check if the data comes from STDIN
+		reader = xmlReaderForFd(STDIN_FILENO, NULL, NULL, XML_PARSE_NOBLANKS);
 	else
-		fprintf(stderr, "Failed to parse %s\n", filename);
-	//Free allocated memory
-	xmlFreeDoc(doc);
-	xmlCleanupParser();
-    xmlMemoryDump();
-	return retval;
+		reader = xmlReaderForFile(file_path, NULL, XML_PARSE_NOBLANKS);
+	if(!reader)
+		fprintf(stderr, "Failed to parse %s\n", file_path[0]=='-' ? "STDIN" : file_path);
+	return reader;
 }
 
-xmlNode * get_XML_node_by_name(xmlNode *root_node, const char *Node_name)
+int xml_reader_close(xmlTextReaderPtr reader, char *file_path)
 {
-	xmlNode *cur_node;
-	if (root_node->type == XML_ELEMENT_NODE)
+	int ret;
+
+	if(!xml_parse_error(reader))
+		while((ret = xmlTextReaderRead(reader)) == 1);
+	ret = xml_parse_error(reader);
+	if(ret)
+		fprintf(stderr, "Failed to parse %s\n", file_path[0]=='-' ? "STDIN" : file_path);
+	xmlFreeTextReader(reader);
+	return ret ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int xml_next_child(xmlTextReaderPtr reader, int depth)
+{
+	int ret;
+
+	while((ret = xmlTextReaderRead(reader)) == 1)
 	{
-		for (cur_node = root_node->children; cur_node; cur_node = cur_node->next)
+		switch(xmlTextReaderNodeType(reader))
 		{
-			if (cur_node->type == XML_ELEMENT_NODE)
-			{
-				if(!strcmp((char *)(cur_node->name), Node_name))
-					return cur_node;
-			}
+			case XML_READER_TYPE_ELEMENT:
+				if(xmlTextReaderDepth(reader) == depth+1)
+					return 1;
+				break;
+			case XML_READER_TYPE_END_ELEMENT:
+				if(xmlTextReaderDepth(reader) == depth)
+					return 0;
+				break;
 		}
 	}
-	return NULL;
+	return ret;
 }
 
-xmlChar * _xmlNodeGetContent(xmlChar *content, const xmlNode *cur)
+xmlChar *xml_content(xmlTextReaderPtr reader)
 {
-	if(content)
-		xmlFree(content);
-	content = xmlNodeGetContent(cur);
+	xmlChar *content;
+
+	if(xmlTextReaderIsEmptyElement(reader) || !(content = xmlTextReaderReadString(reader)))
+		return NULL;
 	if(!(*content))
 	{
 		xmlFree(content);
@@ -283,349 +443,318 @@ xmlChar * _xmlNodeGetContent(xmlChar *content, const xmlNode *cur)
 	return content;
 }
 
-int populate_SDAQ_info(xmlNode *SDAQ_info, SDAQ_info_cal_data *SDAQs_new_config)
+int xml_SDAQ_node_read(xmlTextReaderPtr reader, SDAQ_info_cal_data *SDAQs_new_config)
 {
-	unsigned char i;
-	xmlNode *SerialNumber = get_XML_node_by_name(SDAQ_info, "SerialNumber"),
-			*Type = get_XML_node_by_name(SDAQ_info, "Type"),
-			*Firmware_Rev = get_XML_node_by_name(SDAQ_info, "Firmware_Rev"),
-			*Hardware_Rev = get_XML_node_by_name(SDAQ_info, "Hardware_Rev"),
-			*Available_Channels = get_XML_node_by_name(SDAQ_info, "Available_Channels"),
-			*Samplerate = get_XML_node_by_name(SDAQ_info, "Samplerate"),
-			*Max_num_of_cal_points = get_XML_node_by_name(SDAQ_info, "Max_num_of_cal_points");
-	xmlChar *content = NULL;
-	if(SerialNumber&&Type&&Firmware_Rev&&Hardware_Rev&&Available_Channels&&Samplerate&&Max_num_of_cal_points)
-	{
-		if(*(content = _xmlNodeGetContent(content, SerialNumber)))
-			SDAQs_new_config->SDAQ_info.serial_number = atoi((const char *)(content));
-		else
-		{
-			fprintf(stderr, "XML node SDAQ_info->SerialNumber does not have content!!!\n");
-			return EXIT_FAILURE;
-		}
-		if((content = _xmlNodeGetContent(content, Type)))
+	xml_SDAQ_loader loader = {.reader = reader, .conf = SDAQs_new_config};
+	struct SDAQ_info *info = &(SDAQs_new_config->SDAQ_info);
+	SDAQ_cal_model *cal;
+	int SDAQ_info_cnt = 0, Calibration_Data_cnt = 0, depth = xmlTextReaderDepth(reader), ret = 0;
+	long line = xml_line(reader);
+	const char *name;
+
+	if(!xmlTextReaderIsEmptyElement(reader))
+		while((ret = xml_next_child(reader, depth)) > 0)
 		{
-			for(i=0;i<Unit_code_base_region_size;i++)
+			name = (const char *)xmlTextReaderConstName(reader);
+			if(!strcmp(name, "SDAQ_info"))
 			{
-				if(!dev_type_str[i]||!strcmp((const char *)content, dev_type_str[i]))
-					break;
+				if(!SDAQ_info_cnt++ && populate_SDAQ_info(&loader))
+					return EXIT_FAILURE;
 			}
-			if(!dev_type_str[i])
+			else if(!strcmp(name, "Calibration_Data"))
 			{
-				fprintf(stderr, "Unknown type of SDAQ (%s)!!!\n",content);
-				xmlFree(content);
-				return EXIT_FAILURE;
+				if(!Calibration_Data_cnt++ && populate_Calibration_Data(&loader))
+					return EXIT_FAILURE;
 			}
-			SDAQs_new_config->SDAQ_info.dev_type = dev_type_str[i];
-		}
-		else
-		{
-			fprintf(stderr, "XML node SDAQ_info->Type does not have content!!!\n");
-			return EXIT_FAILURE;
-		}
-		if((content = _xmlNodeGetContent(content, Firmware_Rev)))
-			SDAQs_new_config->SDAQ_info.firm_rev = atoi((const char *)(content));
-		else
-		{
-			fprintf(stderr, "XML node SDAQ_info->Firmware_Rev does not have content!!!\n");
-			return EXIT_FAILURE;
-		}
-		if((content = _xmlNodeGetContent(content, Hardware_Rev)))
-			SDAQs_new_config->SDAQ_info.hw_rev = atoi((const char *)(content));
-		else
-		{
-			fprintf(stderr, "XML node SDAQ_info->Hardware_Rev does not have content!!!\n");
-			return EXIT_FAILURE;
 		}
-		if((content = _xmlNodeGetContent(content, Available_Channels)))
-			SDAQs_new_config->SDAQ_info.num_of_ch = atoi((const char *)(content));
-		else
+	if(ret < 0)
+		return EXIT_FAILURE;
+	if(SDAQ_info_cnt!=1 || Calibration_Data_cnt!=1)
+	{
+		if(!SDAQ_info_cnt)
+			fprintf(stderr, "Line %ld: XML node \"SDAQ_info\" Not found!!!\n", line);
+		if(!Calibration_Data_cnt)
+			fprintf(stderr, "Line %ld: XML node \"Calibration_Data\" Not found!!!\n", line);
+		if(SDAQ_info_cnt>1)
+			fprintf(stderr, "Line %ld: XML node \"SDAQ_info\" found %d times!!!\n", line, SDAQ_info_cnt);
+		if(Calibration_Data_cnt>1)
+			fprintf(stderr, "Line %ld: XML node \"Calibration_Data\" found %d times!!!\n", line, Calibration_Data_cnt);
+		return EXIT_FAILURE;
+	}
+	//Checks of the Calibration_Data with the SDAQ_info, that could be after it.
+	if(!info->num_of_ch)
+	{
+		fprintf(stderr, "Line %ld: SDAQ_info.num_of_ch is ZERO!!!\n", loader.info_line);
+		return EXIT_FAILURE;
+	}
+	if(info->num_of_ch>SDAQ_MAX_AMOUNT_OF_CHANNELS || info->max_cal_point>MAX_AMOUNT_OF_POINTS)
+	{
+		fprintf(stderr, "Line %ld: SDAQ_info.num_of_ch or SDAQ_info.max_cal_point is Out of range!!!\n", loader.info_line);
+		return EXIT_FAILURE;
+	}
+	cal = SDAQ_cal_model_get(SDAQs_new_config);
+	for(int i=0; i<SDAQ_MAX_AMOUNT_OF_CHANNELS; i++)
+	{
+		if(!(cal->date_valid & 1U<<i))
+			continue;
+		if(loader.ch_pos[i] > info->num_of_ch)//Only the first num_of_ch nodes of Calibration_Data are used.
 		{
-			fprintf(stderr, "XML node SDAQ_info->Available_Channels does not have content!!!\n");
-			return EXIT_FAILURE;
+			cal->date_valid &= ~(1U<<i);
+			memset(cal->point_valid[i], 0, sizeof(cal->point_valid[i]));
+			continue;
 		}
-		if((content = _xmlNodeGetContent(content, Samplerate)))
-			SDAQs_new_config->SDAQ_info.sample_rate = atoi((const char *)(content));
-		else
+		if(i >= info->num_of_ch)
 		{
-			fprintf(stderr, "XML node SDAQ_info->Samplerate does not have content!!!\n");
+			fprintf(stderr, "Line %ld: Name of Calibration_Data->CH%d is Out of range (0<CHn<=%d)!!!\n", loader.ch_line[i], i+1, info->num_of_ch);
 			return EXIT_FAILURE;
 		}
-		if((content = _xmlNodeGetContent(content, Max_num_of_cal_points)))
-			SDAQs_new_config->SDAQ_info.max_cal_point = atoi((const char *)(content));
-		else
+		if(cal->date[i].amount_of_points>info->max_cal_point)
 		{
-			fprintf(stderr, "XML node SDAQ_info->Max_num_of_cal_points does not have content!!!\n");
+			fprintf(stderr, "Line %ld: XML node SDAQ_info.CH%d->Used_Points > SDAQs_new_config->SDAQ_info.max_cal_point!!!\n", loader.ch_line[i], i+1);
 			return EXIT_FAILURE;
 		}
-		xmlFree(content);
-	}
-	else
-	{
-		if(!SerialNumber)
-			fprintf(stderr, "XML node SDAQ_info->SerialNumber Not found!!!\n");
-		if(!Type)
-			fprintf(stderr, "XML node SDAQ_info->Type Not found!!!\n");
-		if(!Firmware_Rev)
-			fprintf(stderr, "XML node SDAQ_info->Firmware_Rev Not found!!!\n");
-		if(!Hardware_Rev)
-			fprintf(stderr, "XML node SDAQ_info->Hardware_Rev Not found!!!\n");
-		if(!Available_Channels)
-			fprintf(stderr, "XML node SDAQ_info->Available_Channels Not found!!!\n");
-		if(!Samplerate)
-			fprintf(stderr, "XML node SDAQ_info->Samplerate Not found!!!\n");
-		if(!Max_num_of_cal_points)
-			fprintf(stderr, "XML node SDAQ_info->Max_num_of_cal_points Not found!!!\n");
-		return EXIT_FAILURE;
 	}
 	return EXIT_SUCCESS;
 }
 
-GSList * Cal_points_data_list_conv_and_append(GSList *Cal_points_for_channel_list, float val_of_point, unsigned char point_type, unsigned char point_num)
+int populate_SDAQ_info(xml_SDAQ_loader *loader)
 {
-	sdaq_calibration_points_data *new_point_node; //sdaq_calibration_points_data data for search and work pointer for GSList;
+	static const char *fields[] = {"SerialNumber", "Type", "Firmware_Rev", "Hardware_Rev", "Available_Channels", "Samplerate", "Max_num_of_cal_points"};
+	const int amount_of_fields = sizeof(fields)/sizeof(*fields);
+	struct SDAQ_info *info = &(loader->conf->SDAQ_info);
+	xmlTextReaderPtr reader = loader->reader;
+	int depth = xmlTextReaderDepth(reader), found = 0, ret = 0, i, j;
+	xmlChar *content;
 
-	if(!(new_point_node = new_SDAQ_cal_point_node()))
-	{
-		fprintf(stderr, "Memory Error!!!\n");
-		exit(EXIT_FAILURE);
-	}
-	new_point_node->data_of_point = val_of_point;
-	new_point_node->type = point_type;
-	new_point_node->points_num = point_num;
-	Cal_points_for_channel_list = g_slist_append(Cal_points_for_channel_list, new_point_node);
-	return Cal_points_for_channel_list;
+	loader->info_line = xml_line(reader);
+	if(!xmlTextReaderIsEmptyElement(reader))
+		while((ret = xml_next_child(reader, depth)) > 0)
+		{
+			for(i=0; i<amount_of_fields && strcmp((const char *)xmlTextReaderConstName(reader), fields[i]); i++);
+			if(i==amount_of_fields || found & 1<<i)//Only the first node of each field is used.
+				continue;
+			found |= 1<<i;
+			if(!(content = xml_content(reader)))
+			{
+				if(!xml_parse_error(reader))
+					fprintf(stderr, "Line %ld: XML node SDAQ_info->%s does not have content!!!\n", xml_line(reader), fields[i]);
+				return EXIT_FAILURE;
+			}
+			switch(i)
+			{
+				case 0: info->serial_number = atoi((const char *)content); break;
+				case 1:
+					for(j=0;j<Unit_code_base_region_size;j++)
+					{
+						if(!dev_type_str[j]||!strcmp((const char *)content, dev_type_str[j]))
+							break;
+					}
+					if(!dev_type_str[j])
+					{
+						fprintf(stderr, "Line %ld: Unknown type of SDAQ (%s)!!!\n", xml_line(reader), content);
+						xmlFree(content);
+						return EXIT_FAILURE;
+					}
+					info->dev_type = dev_type_str[j];
+					break;
+				case 2: info->firm_rev = atoi((const char *)content); break;
+				case 3: info->hw_rev = atoi((const char *)content); break;
+				case 4: info->num_of_ch = atoi((const char *)content); break;
+				case 5: info->sample_rate = atoi((const char *)content); break;
+				case 6: info->max_cal_point = atoi((const char *)content); break;
+			}
+			xmlFree(content);
+		}
+	if(ret < 0)
+		return EXIT_FAILURE;
+	for(i=0; i<amount_of_fields; i++)
+		if(!(found & 1<<i))
+			fprintf(stderr, "Line %ld: XML node SDAQ_info->%s Not found!!!\n", loader->info_line, fields[i]);
+	return found == (1<<amount_of_fields)-1 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-int populate_Calibration_Data(xmlNode *Calibration_Data, SDAQ_info_cal_data *SDAQs_new_config)
+int populate_Calibration_Data(xml_SDAQ_loader *loader)
 {
-	char point_name_buff[10];
-	unsigned char channel, amount_of_new_cal_ch;
-	int i, j;
-	date_list_data_of_node l_new_date_note, *new_date_node; //date_list_data_of_node local_variable and work pointer for GSList;
-	xmlChar *content = NULL;
-	xmlNode *XML_channel_root = NULL,
-			*XML_cal_date = NULL,
-			*XML_period = NULL,
-			*XML_used_Points = NULL,
-			*XML_CH_Unit = NULL,
-			*XML_points_data = NULL, *XML_point_data = NULL;
-	//XML Nodes for Point data.
-	xmlNode *XML_Meas = NULL,
-			*XML_Ref = NULL,
-			*XML_Offset = NULL,
-			*XML_Gain = NULL,
-			*XML_C2 = NULL,
-			*XML_C3 = NULL;
-
-	if(!Calibration_Data || !SDAQs_new_config)
-		return EXIT_FAILURE;
-	if(!SDAQs_new_config->SDAQ_info.num_of_ch)
-	{
-		fprintf(stderr, "SDAQ_info.num_of_ch is ZERO!!!\n");
-		return EXIT_FAILURE;
-	}
-	if(!(SDAQs_new_config->Cal_points_data_lists = calloc(SDAQs_new_config->SDAQ_info.num_of_ch, sizeof(struct GSList *))))
-	{
-		fprintf(stderr, "Memory Error!!!\n");
-		exit(EXIT_FAILURE);
-	}
-	amount_of_new_cal_ch = xmlChildElementCount(Calibration_Data);
-	if(amount_of_new_cal_ch>SDAQs_new_config->SDAQ_info.num_of_ch)
-		amount_of_new_cal_ch = SDAQs_new_config->SDAQ_info.num_of_ch;
-	for(i=0, XML_channel_root=Calibration_Data->children; i<amount_of_new_cal_ch; XML_channel_root=XML_channel_root->next,i++)
-	{
-		sscanf((char *)(XML_channel_root->name),"CH%hhu",&channel);
-		if(!channel || channel>SDAQs_new_config->SDAQ_info.num_of_ch)
-		{
-			if(!channel)
-				fprintf(stderr, "Name of Calibration_Data->%s is invalid!!!\n",XML_channel_root->name);
-			if(channel>SDAQs_new_config->SDAQ_info.num_of_ch)
-				fprintf(stderr, "Name of Calibration_Data->%s is Out of range (0<CHn<=%d)!!!\n", XML_channel_root->name, SDAQs_new_config->SDAQ_info.num_of_ch);
-			return EXIT_FAILURE;
-		}
-		if(g_slist_find_custom((GSList *)(SDAQs_new_config->Calibration_date_list), &channel, SDAQ_date_node_with_channel_b_find))//Check if channel is already registered.
-			continue;
-		XML_cal_date = get_XML_node_by_name(XML_channel_root, "Calibration_date");
-		XML_period = get_XML_node_by_name(XML_channel_root, "Calibration_Period");
-		XML_used_Points = get_XML_node_by_name(XML_channel_root, "Used_Points");
-		XML_CH_Unit = get_XML_node_by_name(XML_channel_root, "Unit");
-		XML_points_data = get_XML_node_by_name(XML_channel_root, "Points");
-		if(XML_cal_date && XML_period && XML_used_Points && XML_CH_Unit && XML_points_data)
+	xmlTextReaderPtr reader = loader->reader;
+	SDAQ_cal_model *cal = SDAQ_cal_model_get(loader->conf);
+	int depth = xmlTextReaderDepth(reader), ret = 0;
+	unsigned char channel, pos = 0;
+	const char *name;
+
+	if(!xmlTextReaderIsEmptyElement(reader))
+		while((ret = xml_next_child(reader, depth)) > 0)
 		{
-			l_new_date_note.ch_num = channel;
-			if((content = _xmlNodeGetContent(content, XML_cal_date)))
+			pos++;
+			//Only the first num_of_ch nodes are used. With SDAQ_info after the Calibration_Data, the channels are dropped at the end of the SDAQ.
+			if(loader->info_line && pos > loader->conf->SDAQ_info.num_of_ch)
+				continue;
+			name = (const char *)xmlTextReaderConstName(reader);
+			channel = 0;
+			sscanf(name, "CH%hhu", &channel);
+			if(!channel || channel>SDAQ_MAX_AMOUNT_OF_CHANNELS)
 			{
-				short year,month,day;
-				sscanf((char*)content,"%hd/%hd/%hd",&year,&month,&day);
-				if((year>=2000&&year<=2255)&&(month>=1&&month<=12)&&(day>=1&&day<=31))
-				{
-					l_new_date_note.year = year-2000;
-					l_new_date_note.month = month;
-					l_new_date_note.day = day;
-				}
+				if(!channel)
+					fprintf(stderr, "Line %ld: Name of Calibration_Data->%s is invalid!!!\n", xml_line(reader), name);
 				else
-				{
-					fprintf(stderr, "Content of XML node SDAQ_info.CH%d->Calibration_date(%d/%d/%d) is wrong!!!\n",channel,year,month,day);
-					xmlFree(content);
-					return EXIT_FAILURE;
-				}
-			}
-			else
-			{
-				fprintf(stderr, "XML node SDAQ_info.CH%d->Calibration_date does not have content!!!\n", channel);
+					fprintf(stderr, "Line %ld: Name of Calibration_Data->%s is Out of range (0<CHn<=%d)!!!\n", xml_line(reader), name, SDAQ_MAX_AMOUNT_OF_CHANNELS);
 				return EXIT_FAILURE;
 			}
-			if((content = _xmlNodeGetContent(content, XML_period)))
-				l_new_date_note.period = atoi((char*)content);
-			else
-			{
-				fprintf(stderr, "XML node SDAQ_info.CH%d->Calibration_Period does not have content!!!\n", channel);
+			if(cal->date_valid & 1U<<(channel-1))//Check if channel is already registered.
+				continue;
+			if(populate_channel(loader, channel))
 				return EXIT_FAILURE;
-			}
-			if((content = _xmlNodeGetContent(content, XML_used_Points)))
+			loader->ch_pos[channel-1] = pos;
+		}
+	return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int populate_channel(xml_SDAQ_loader *loader, unsigned char channel)
+{
+	static const char *fields[] = {"Calibration_date", "Calibration_Period", "Used_Points", "Unit", "Points"};
+	const int amount_of_fields = sizeof(fields)/sizeof(*fields);
+	xmlTextReaderPtr reader = loader->reader;
+	SDAQ_cal_model *cal = loader->conf->cal;
+	date_list_data_of_node l_new_date_note = {.ch_num = channel}; //date_list_data_of_node local_variable;
+	unsigned char amount_of_points = 0;
+	int depth = xmlTextReaderDepth(reader), found = 0, ret = 0, i, j;
+	long line = xml_line(reader);
+	xmlChar *content;
+
+	if(!xmlTextReaderIsEmptyElement(reader))
+		while((ret = xml_next_child(reader, depth)) > 0)
+		{
+			for(i=0; i<amount_of_fields && strcmp((const char *)xmlTextReaderConstName(reader), fields[i]); i++);
+			if(i==amount_of_fields || found & 1<<i)//Only the first node of each field is used.
+				continue;
+			found |= 1<<i;
+			if(i == 4)
 			{
-				l_new_date_note.amount_of_points = atoi((char*)content);
-				if(l_new_date_note.amount_of_points>SDAQs_new_config->SDAQ_info.max_cal_point)
-				{
-					fprintf(stderr, "XML node SDAQ_info.CH%d->Used_Points > SDAQs_new_config->SDAQ_info.max_cal_point!!!\n", channel);
-					xmlFree(content);
+				if(populate_Points(loader, channel, &amount_of_points))
 					return EXIT_FAILURE;
-				}
+				continue;
 			}
-			else
+			if(!(content = xml_content(reader)))
 			{
-				fprintf(stderr, "XML node SDAQ_info.CH%d->Used_Points does not have content!!!\n", channel);
+				if(!xml_parse_error(reader))
+					fprintf(stderr, "Line %ld: XML node SDAQ_info.CH%d->%s does not have content!!!\n", xml_line(reader), channel, fields[i]);
 				return EXIT_FAILURE;
 			}
-			if((content = _xmlNodeGetContent(content, XML_CH_Unit)))
+			switch(i)
 			{
-				for(j=Unit_code_base_region_size;j<256;j++)
+				case 0:
 				{
-					if(!unit_str[j]||!strcmp((char*)content, unit_str[j]))
-						break;
+					short year=0,month=0,day=0;
+					sscanf((char*)content,"%hd/%hd/%hd",&year,&month,&day);
+					if((year>=2000&&year<=2255)&&(month>=1&&month<=12)&&(day>=1&&day<=31))
+					{
+						l_new_date_note.year = year-2000;
+						l_new_date_note.month = month;
+						l_new_date_note.day = day;
+					}
+					else
+					{
+						fprintf(stderr, "Line %ld: Content of XML node SDAQ_info.CH%d->Calibration_date(%d/%d/%d) is wrong!!!\n", xml_line(reader), channel, year, month, day);
+						xmlFree(content);
+						return EXIT_FAILURE;
+					}
+					break;
 				}
-				if(unit_str[j])
+				case 1: l_new_date_note.period = atoi((char*)content); break;
+				case 2: l_new_date_note.amount_of_points = atoi((char*)content); break;
+				case 3:
+					for(j=Unit_code_base_region_size;j<256;j++)
+					{
+						if(!unit_str[j]||!strcmp((char*)content, unit_str[j]))
+							break;
+					}
+					if(!unit_str[j])
+					{
+						fprintf(stderr, "Line %ld: Unit(%s) in content of XML node SDAQ_info.CH%d->Unit is unknown!!!\n", xml_line(reader), content, channel);
+						xmlFree(content);
+						return EXIT_FAILURE;
+					}
 					l_new_date_note.cal_unit = j;
-				else
-				{
-					fprintf(stderr, "Unit(%s) in content of XML node SDAQ_info.CH%d->Unit is unknown!!!\n",content,channel);
-					xmlFree(content);
-					return EXIT_FAILURE;
-				}
+					break;
 			}
-			else
+			xmlFree(content);
+		}
+	if(ret < 0)
+		return EXIT_FAILURE;
+	if(found != (1<<amount_of_fields)-1)
+	{
+		for(i=0; i<amount_of_fields; i++)
+			if(!(found & 1<<i))
+				fprintf(stderr, "Line %ld: XML node SDAQ_info.CH%d->%s Not found!!!\n", line, channel, fields[i]);
+		return EXIT_FAILURE;
+	}
+	if(loader->info_line && l_new_date_note.amount_of_points>loader->conf->SDAQ_info.max_cal_point)
+	{
+		fprintf(stderr, "Line %ld: XML node SDAQ_info.CH%d->Used_Points > SDAQs_new_config->SDAQ_info.max_cal_point!!!\n", line, channel);
+		return EXIT_FAILURE;
+	}
+	if(amount_of_points < l_new_date_note.amount_of_points)
+	{
+		fprintf(stderr, "Line %ld: XML node for calibration point %d for channel %d was not found or it's in wrong order!!!\n", line, amount_of_points, channel);
+		return EXIT_FAILURE;
+	}
+	//The points after the Used_Points are not part of the calibration.
+	for(j=l_new_date_note.amount_of_points; j<amount_of_points; j++)
+		cal->point_valid[channel-1][j] = 0;
+	SDAQ_cal_date_set(loader->conf, &l_new_date_note);
+	loader->ch_line[channel-1] = line;
+	return EXIT_SUCCESS;
+}
+
+int populate_Points(xml_SDAQ_loader *loader, unsigned char channel, unsigned char *amount_of_points)
+{
+	static const char *fields[MAX_DATA_ON_POINT] = {"Measure", "Reference", "Offset", "Gain", "C2", "C3"};//Index is type-meas
+	char point_name_buff[16];
+	float point[MAX_DATA_ON_POINT];
+	xmlTextReaderPtr reader = loader->reader;
+	int depth = xmlTextReaderDepth(reader), point_depth, found, ret = 0, k;
+	long line;
+	xmlChar *content;
+
+	if(!xmlTextReaderIsEmptyElement(reader))
+		while((ret = xml_next_child(reader, depth)) > 0)
+		{
+			line = xml_line(reader);
+			sprintf(point_name_buff, "Point_%hhu", *amount_of_points);
+			if(*amount_of_points >= MAX_AMOUNT_OF_POINTS || strcmp((const char *)xmlTextReaderConstName(reader), point_name_buff))
 			{
-				fprintf(stderr, "XML node SDAQ_info.CH%d->XML_CH_Unit does not have content!!!\n", channel);
+				fprintf(stderr, "Line %ld: XML node for calibration point %d for channel %d was not found or it's in wrong order!!!\n", line, *amount_of_points, channel);
 				return EXIT_FAILURE;
 			}
-			xmlFree(content); content = NULL;
-			//Append data to GSList: SDAQs_new_config->Calibration_date_list;
-			if(!(new_date_node = new_SDAQ_date_node()))
-			{
-				fprintf(stderr, "Memory Error!!!\n");
-				exit(EXIT_FAILURE);
-			}
-			memcpy(new_date_node, &l_new_date_note, sizeof(date_list_data_of_node));
-			SDAQs_new_config->Calibration_date_list = (struct GSList *)g_slist_append((GSList *)SDAQs_new_config->Calibration_date_list, new_date_node);
-			//Check if calibration point is set and if yes load them at SDAQs_new_config->Cal_points_data_lists[ch].
-			if(l_new_date_note.amount_of_points)
-			{
-				for(j=0, XML_point_data=XML_points_data->children; j<l_new_date_note.amount_of_points; XML_point_data=XML_point_data->next,j++)
+			found = 0;
+			point_depth = xmlTextReaderDepth(reader);
+			if(!xmlTextReaderIsEmptyElement(reader))
+				while((ret = xml_next_child(reader, point_depth)) > 0)
 				{
-					sprintf(point_name_buff, "Point_%hhu",j);
-					if(!XML_point_data || strcmp((char*)(XML_point_data->name), point_name_buff))
-					{
-						fprintf(stderr, "XML node for calibration point %d for channel %d was not found or it's in wrong order!!!\n", j, channel);
-						return EXIT_FAILURE;
-					}
-					XML_Meas = get_XML_node_by_name(XML_point_data, "Measure");
-					XML_Ref = get_XML_node_by_name(XML_point_data, "Reference");
-					XML_Offset = get_XML_node_by_name(XML_point_data, "Offset");
-					XML_Gain = get_XML_node_by_name(XML_point_data, "Gain");
-					XML_C2 = get_XML_node_by_name(XML_point_data, "C2");
-					XML_C3 = get_XML_node_by_name(XML_point_data, "C3");
-					if(XML_Meas && XML_Ref && XML_Offset && XML_Gain && XML_C2 && XML_C3)
-					{
-						if((content = _xmlNodeGetContent(content, XML_Meas)))
-							SDAQs_new_config->Cal_points_data_lists[channel-1] = (struct GSList *)Cal_points_data_list_conv_and_append((GSList *)SDAQs_new_config->Cal_points_data_lists[channel-1], atof((char*)content), meas, j);
-						else
-						{
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->Measure does not have content!!!\n", channel, j);
-							return EXIT_FAILURE;
-						}
-						if((content = _xmlNodeGetContent(content, XML_Ref)))
-							SDAQs_new_config->Cal_points_data_lists[channel-1] = (struct GSList *)Cal_points_data_list_conv_and_append((GSList *)SDAQs_new_config->Cal_points_data_lists[channel-1], atof((char*)content), ref, j);
-						else
-						{
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->Reference does not have content!!!\n", channel, j);
-							return EXIT_FAILURE;
-						}
-						if((content = _xmlNodeGetContent(content, XML_Offset)))
-							SDAQs_new_config->Cal_points_data_lists[channel-1] = (struct GSList *)Cal_points_data_list_conv_and_append((GSList *)SDAQs_new_config->Cal_points_data_lists[channel-1], atof((char*)content), offset, j);
-						else
-						{
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->Offset does not have content!!!\n", channel, j);
-							return EXIT_FAILURE;
-						}
-						if((content = _xmlNodeGetContent(content, XML_Gain)))
-							SDAQs_new_config->Cal_points_data_lists[channel-1] = (struct GSList *)Cal_points_data_list_conv_and_append((GSList *)SDAQs_new_config->Cal_points_data_lists[channel-1], atof((char*)content), gain, j);
-						else
-						{
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->Gain does not have content!!!\n", channel, j);
-							return EXIT_FAILURE;
-						}
-						if((content = _xmlNodeGetContent(content, XML_C2)))
-							SDAQs_new_config->Cal_points_data_lists[channel-1] = (struct GSList *)Cal_points_data_list_conv_and_append((GSList *)SDAQs_new_config->Cal_points_data_lists[channel-1], atof((char*)content), C2, j);
-						else
-						{
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->C2 does not have content!!!\n", channel, j);
-							return EXIT_FAILURE;
-						}
-						if((content = _xmlNodeGetContent(content, XML_C3)))
-							SDAQs_new_config->Cal_points_data_lists[channel-1] = (struct GSList *)Cal_points_data_list_conv_and_append((GSList *)SDAQs_new_config->Cal_points_data_lists[channel-1], atof((char*)content), C3, j);
-						else
-						{
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->C3 does not have content!!!\n", channel, j);
-							return EXIT_FAILURE;
-						}
-						xmlFree(content); content = NULL;
-					}
-					else
+					for(k=0; k<MAX_DATA_ON_POINT && strcmp((const char *)xmlTextReaderConstName(reader), fields[k]); k++);
+					if(k==MAX_DATA_ON_POINT || found & 1<<k)//Only the first node of each data is used.
+						continue;
+					found |= 1<<k;
+					if(!(content = xml_content(reader)))
 					{
-						if(!XML_Meas)
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->Measure Not found!!!\n", channel, j);
-						if(!XML_Ref)
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->Reference Not found!!!\n", channel, j);
-						if(!XML_Offset)
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->Offset Not found!!!\n", channel, j);
-						if(!XML_Gain)
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->Gain Not found!!!\n", channel, j);
-						if(!XML_C2)
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->C2 Not found!!!\n", channel, j);
-						if(!XML_C3)
-							fprintf(stderr, "XML node Calibration_Data->CH%d->Points->Point_%d->C3 Not found!!!\n", channel, j);
+						if(!xml_parse_error(reader))
+							fprintf(stderr, "Line %ld: XML node Calibration_Data->CH%d->Points->Point_%d->%s does not have content!!!\n", xml_line(reader), channel, *amount_of_points, fields[k]);
 						return EXIT_FAILURE;
 					}
+					point[k] = atof((char*)content);
+					xmlFree(content);
 				}
+			if(ret < 0)
+				return EXIT_FAILURE;
+			if(found != CAL_POINT_COMPLETE)
+			{
+				for(k=0; k<MAX_DATA_ON_POINT; k++)
+					if(!(found & 1<<k))
+						fprintf(stderr, "Line %ld: XML node Calibration_Data->CH%d->Points->Point_%d->%s Not found!!!\n", line, channel, *amount_of_points, fields[k]);
+				return EXIT_FAILURE;
 			}
-			else
-				SDAQs_new_config->Cal_points_data_lists[channel-1] = NULL;
+			for(k=0; k<MAX_DATA_ON_POINT; k++)
+				SDAQ_cal_point_set(loader->conf, channel, *amount_of_points, k+meas, point[k]);
+			(*amount_of_points)++;
 		}
-		else
-		{
-			if(!XML_cal_date)
-				fprintf(stderr, "XML node SDAQ_info.CH%d->Calibration_date Not found!!!\n", channel);
-			if(!XML_period)
-				fprintf(stderr, "XML node SDAQ_info.CH%d->Calibration_Period Not found!!!\n", channel);
-			if(!XML_used_Points)
-				fprintf(stderr, "XML node SDAQ_info.CH%d->Used_Points Not found!!!\n", channel);
-			if(!XML_CH_Unit)
-				fprintf(stderr, "XML node SDAQ_info.CH%d->Unit Not found!!!\n", channel);
-			if(!XML_points_data)
-				fprintf(stderr, "XML node SDAQ_info.CH%d->Points Not found!!!\n", channel);
-			return EXIT_FAILURE;
-		}
-	}
-	return EXIT_SUCCESS;
+	return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
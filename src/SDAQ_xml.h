@@ -17,7 +17,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 /* SDAQ_xml function declaration*/
 /*Function used in getinfo.c: convert the arg (aka SDAQ_info_cal_data*) to xml.
-  if file_path is valid save, otherwise it's print it to stdout*/
+  if file_path is valid save, otherwise it's print it to stdout. Return: 0 at success and 1 on failure.*/
 int XML_info_file_write(char *file_path, void *arg, unsigned char format_flag);
 
 /*
@@ -25,3 +25,25 @@ int XML_info_file_write(char *file_path, void *arg, unsigned char format_flag);
  * Return: 0 at success and 1 on failure.
  */
 int XML_info_file_read_and_validate(char *file_path, void *new_conf);
+
+/*
+ * Function used in setinfo.c: read a manifest of SDAQs, a fleet document like the one of XML_fleet_*(), from file_path
+ * (or from STDIN if file_path is "-"). Each node SDAQ is converted to a SDAQ_info_cal_data, nodes with attribute Error are skipped.
+ * Return: The amount of SDAQs at the array *new_confs (aka SDAQ_info_cal_data*, freed by the caller with g_free), or -1 on failure.
+ */
+int XML_fleet_file_read(char *file_path, void **new_confs);
+
+/*
+ * Streaming writer of a fleet document, used in getinfo.c for all the SDAQs of a CAN-IF.
+ * The document has a root node SDAQ_fleet, with a node SDAQ for each SDAQ, written as soon as it's added.
+ */
+typedef struct XML_fleet_writer XML_fleet_writer;
+//Function that start a fleet document at file_path, or at stdout if file_path is "-". Return: The writer, or NULL on failure.
+XML_fleet_writer *XML_fleet_open(const char *file_path, const char *CANif_name, unsigned char format_flag);
+/*
+ * Function that write the node of the SDAQ at address, with the elapsed time (msec) of its retrieval.
+ * arg (aka SDAQ_info_cal_data*) is written on success. On failure error is not NULL, and only the serial_number of arg is written.
+ */
+void XML_fleet_add(XML_fleet_writer *writer, unsigned char address, void *arg, const char *error, double elapsed);
+//Function that end the fleet document and free the writer. Return: 0 at success and 1 on failure.
+int XML_fleet_close(XML_fleet_writer *writer);
@@ -14,44 +14,90 @@ GNU General Public License for more details.
 You should have received a copy of the GNU General Public License
 along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
-#define RETRY_CNT_INIT 10 //Amount of retries for failed Calibration Point Data
-
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <math.h>
-
-#include <sys/time.h>
-#include <signal.h>
+#include <time.h>
 
 #include <linux/can.h>
 #include <linux/can/raw.h>
 
 #include "info.h"//including -> "SDAQ_drv.h", "Modes.h"
 #include "SDAQ_xml.h"
+#include "SDAQ_registry.h"
+
+struct fleet_context;
+//State of an SDAQ, at getinfo of all the SDAQs.
+typedef struct fleet_device{
+	struct fleet_context *ctx;
+	unsigned char address;
+	SDAQ_info_cal_data str;
+	info_reply info_state;
+	cal_data_reply cal_state;
+	SDAQ_trans info_trans;
+	SDAQ_trans cal_trans;
+	unsigned int cal_CHs;//Bitmap of the channels with calibration data not requested yet
+	unsigned long long start;//Start of the retrieval, msec on CLOCK_MONOTONIC
+	const char *error;
+}fleet_dev;
+
+//Context of getinfo of all the SDAQs.
+typedef struct fleet_context{
+	SDAQ_trans_engine eng;
+	SDAQ_registry reg;
+	XML_fleet_writer *xml;
+	opt_flags *usr_flag;
+	fleet_dev *devs;
+	unsigned int amount, next, active, failed;
+}fleet_ctx;
 
-//message reception flags union. Contains a struct with the flags and the amount of available channel,
-union RX_info_calibration_date_flags_short{
-	struct{
-		unsigned char amount_of_waiting_channel;
-		unsigned id_status_msg_flag : 1;
-		unsigned info_msg_flag : 1;
-	}__attribute__((packed, aligned(1))) as_flags;
-	unsigned short as_bytes;
-};
+//Local functions
+void cal_date_dec(SDAQ_info_cal_data *str, unsigned char channel, const sdaq_calibration_date *date_dec);//Store a received Calibration_Date
+int getinfo_all(int socket_num, opt_flags *usr_flag);//getinfo for all the SDAQs of the bus
+void fleet_dev_start(fleet_ctx *ctx);//Start the retrieval of the next SDAQ
+void fleet_dev_finish(fleet_dev *dev, const char *error);//Report the SDAQ, and start the next
+void fleet_info_done(SDAQ_trans *trans, enum SDAQ_trans_result result);//SDAQ_trans_done_fn of the info transaction
+int fleet_cal_data_next(fleet_dev *dev);//Request the calibration data of the next channel. Return: 0 on request, or 1 when there is none.
+void fleet_cal_data_done(SDAQ_trans *trans, enum SDAQ_trans_result result);//SDAQ_trans_done_fn of the calibration data transactions
 
-//Global Variables
-volatile unsigned char TMR_exp=1;
+static inline unsigned long long mono_time_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000ULL + now.tv_nsec/1000000;
+}
 
 	/*------ Implementation of functions------*/
 int getinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 {
 	//Local variables, SDAQ information and calibration date and data.
 	SDAQ_info_cal_data str={0};
+	SDAQ_registry reg={0};
+	SDAQ_reg_entry *entry;
 	int retval;
 
-	if(!(retval = get_SDAQ_info_and_calibration_data(socket_num, dev_addr, usr_flag->timeout, &str)))
+	if(dev_addr == Broadcast)
+		return getinfo_all(socket_num, usr_flag);
+	if(!usr_flag->no_registry)
+		SDAQ_registry_open(&reg, usr_flag->CANif_name);
+	if(!(retval = get_SDAQ_info(socket_num, dev_addr, usr_flag->timeout, &str)))
+	{
+		//Points re-fetched only if the SDAQ's info, status or calibration dates differ from its registry entry.
+		entry = SDAQ_registry_get(&reg, str.SDAQ_info.serial_number);
+		if(SDAQ_registry_match(entry, &str))
+		{
+			SDAQ_registry_load_points(entry, &str);
+			SDAQ_registry_seen(&reg, str.SDAQ_info.serial_number, dev_addr, str.SDAQ_info.dev_type);
+		}
+		else if(!(retval = get_SDAQ_calibration_data(socket_num, dev_addr, usr_flag->timeout, &str, 0)))
+			SDAQ_registry_store(&reg, dev_addr, &str);
+	}
+	SDAQ_registry_save(&reg);
+	SDAQ_registry_close(&reg);
+	if(!retval)
 	{
 		if(!usr_flag->silent)
 		{
@@ -65,16 +111,10 @@ int getinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 									 	str.SDAQ_info.hw_rev,
 									 	str.SDAQ_info.firm_rev,
 									 	str.SDAQ_info.serial_number,
-									 	str.SDAQ_info.dev_type,
+									 	str.SDAQ_info.dev_type ? str.SDAQ_info.dev_type : "Unknown",
 										str.SDAQ_info.num_of_ch,
 									 	str.SDAQ_info.sample_rate);
-			if(g_slist_find_custom((GSList *)(str.Calibration_date_list), NULL, SDAQ_date_node_with_nonzero_amount_of_points_find))
-			{
-				printf("\n\t----- Expiration Date & Point's Data -----\n");
-				g_slist_foreach((GSList *)(str.Calibration_date_list),printf_SDAQ_Date_with_points_node,str.Cal_points_data_lists);
-			}
-			else
-				printf("\tAll channels have 0 amount of points\n");
+			printf_SDAQ_cal_model(&str);
 			if(usr_flag->info_file)
 				XML_info_file_write(usr_flag->info_file, &str, usr_flag->formatted_output);
 			printf("\nPrint completed\n");
@@ -82,388 +122,476 @@ int getinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 		else
 			XML_info_file_write("-", &str, usr_flag->formatted_output);
 	}
-	//free the list and the arrays
-	g_slist_free_full((GSList *)(str.Calibration_date_list), free_SDAQ_Date_node);
-	str.Calibration_date_list=NULL;
-	if(str.Cal_points_data_lists)
+	free_SDAQ_info_cal_data(&str);
+	return retval;
+}
+
+int getinfo_all(int socket_num, opt_flags *usr_flag)
+{
+	fleet_ctx ctx = {.usr_flag = usr_flag};
+	unsigned int serial_number[FLEET_ADDRS];
+	unsigned long long addrs, conflicts;
+	unsigned int amount_of_conflicts = 0;
+	int retval = EXIT_SUCCESS;
+
+	if(!usr_flag->silent)
+		printf("Scan the CANbus (up to %d sec) ...\n", usr_flag->timeout);
+	addrs = Discover_scan(socket_num, serial_number, &conflicts, usr_flag);
+	if(!addrs && !conflicts)
+	{
+		printf("No device found\n");
+		return EXIT_FAILURE;
+	}
+	//Fleet document at stdout on silent, otherwise at the info file if any.
+	if((usr_flag->silent || usr_flag->info_file) &&
+	   !(ctx.xml = XML_fleet_open(usr_flag->silent ? "-" : usr_flag->info_file, usr_flag->CANif_name, usr_flag->formatted_output)))
+		return EXIT_FAILURE;
+	if(SDAQ_trans_engine_init(&ctx.eng, socket_num))
 	{
-		for(int i=0; i<str.SDAQ_info.num_of_ch; i++)
+		perror("Transaction engine");
+		if(ctx.xml)
+			XML_fleet_close(ctx.xml);
+		return EXIT_FAILURE;
+	}
+	if(!usr_flag->no_registry)
+		SDAQ_registry_open(&ctx.reg, usr_flag->CANif_name);
+	//SDAQs with conflicting address can't be queried, they reported as failed.
+	for(unsigned int addr=0; addr<FLEET_ADDRS; addr++)
+		if(conflicts & 1ULL<<addr && addr != Parking_address)
 		{
-			g_slist_free_full((GSList *)(str.Cal_points_data_lists[i]), free_SDAQ_Date_node);
-			str.Cal_points_data_lists[i]=NULL;
+			if(ctx.xml)
+				XML_fleet_add(ctx.xml, addr, NULL, "Address conflict", 0);
+			if(!usr_flag->silent)
+				printf("Address %2u: Address conflict\n", addr);
+			amount_of_conflicts++;
 		}
-		free(str.Cal_points_data_lists);
+	ctx.devs = g_new0(fleet_dev, __builtin_popcountll(addrs));
+	for(; addrs; addrs &= addrs - 1)
+	{
+		ctx.devs[ctx.amount].ctx = &ctx;
+		ctx.devs[ctx.amount].address = __builtin_ctzll(addrs);
+		ctx.devs[ctx.amount++].str.SDAQ_info.serial_number = serial_number[__builtin_ctzll(addrs)];
 	}
-	return retval;
+	if(!usr_flag->silent)
+		printf("Get info of %u SDAQs, up to %d at once\n", ctx.amount, FLEET_MAX_ACTIVE);
+	//The retrievals are pipelined. Each completed SDAQ starts the next, up to FLEET_MAX_ACTIVE at once.
+	while(ctx.next < ctx.amount && ctx.active < FLEET_MAX_ACTIVE)
+		fleet_dev_start(&ctx);
+	if(SDAQ_trans_wait(&ctx.eng))
+	{
+		perror("Reception");
+		retval = EXIT_FAILURE;
+	}
+	SDAQ_trans_engine_close(&ctx.eng);
+	SDAQ_registry_save(&ctx.reg);
+	SDAQ_registry_close(&ctx.reg);
+	if(ctx.xml && XML_fleet_close(ctx.xml))
+		retval = EXIT_FAILURE;
+	if(!usr_flag->silent)
+		printf("Completed: %u SDAQs, %u failed\n", ctx.amount + amount_of_conflicts, ctx.failed + amount_of_conflicts);
+	g_free(ctx.devs);
+	return ctx.failed || amount_of_conflicts ? EXIT_FAILURE : retval;
 }
 
-void info_timer_handler (int signum)
+void fleet_dev_start(fleet_ctx *ctx)
 {
-	TMR_exp = 0;
-	return;
+	fleet_dev *dev;
+
+	while(ctx->next < ctx->amount)
+	{
+		dev = &(ctx->devs[ctx->next++]);
+		ctx->active++;
+		dev->start = mono_time_ms();
+		dev->info_state = (info_reply){.str = &dev->str, .owner = dev};
+		dev->info_trans = (SDAQ_trans){.dev_addr = dev->address,
+									   .reply_set = SDAQ_REPLY(Device_status)|SDAQ_REPLY(Device_info)|SDAQ_REPLY(Calibration_Date),
+									   .timeout = ctx->usr_flag->timeout*1000,
+									   .request = SDAQ_trans_req_info,
+									   .on_reply = info_reply_dec,
+									   .on_done = fleet_info_done,
+									   .arg = &dev->info_state};
+		if(!SDAQ_trans_submit(&ctx->eng, &dev->info_trans))
+			return;
+		fleet_dev_finish(dev, "Request failed");//Start the next, if any.
+		return;
+	}
+}
+
+void fleet_info_done(SDAQ_trans *trans, enum SDAQ_trans_result result)
+{
+	fleet_dev *dev = ((info_reply *)trans->arg)->owner;
+	fleet_ctx *ctx = dev->ctx;
+	SDAQ_reg_entry *entry;
+
+	if(result != SDAQ_trans_done)
+	{
+		fleet_dev_finish(dev, !dev->info_state.status_rx && !dev->info_state.info_rx ? "No device found" : "Reception Failed");
+		return;
+	}
+	//Points re-fetched only if the SDAQ's info, status or calibration dates differ from its registry entry.
+	entry = SDAQ_registry_get(&ctx->reg, dev->str.SDAQ_info.serial_number);
+	if(SDAQ_registry_match(entry, &dev->str))
+	{
+		SDAQ_registry_load_points(entry, &dev->str);
+		SDAQ_registry_seen(&ctx->reg, dev->str.SDAQ_info.serial_number, dev->address, dev->str.SDAQ_info.dev_type);
+		fleet_dev_finish(dev, NULL);
+		return;
+	}
+	dev->cal_CHs = (1U<<(dev->str.SDAQ_info.num_of_ch < SDAQ_MAX_AMOUNT_OF_CHANNELS ?
+						 dev->str.SDAQ_info.num_of_ch : SDAQ_MAX_AMOUNT_OF_CHANNELS))-1;
+	if(fleet_cal_data_next(dev))
+		fleet_dev_finish(dev, dev->error);
+}
+
+int fleet_cal_data_next(fleet_dev *dev)
+{
+	int i;
+
+	//One channel of an SDAQ is queried at a time, the SDAQs of the fleet are queried concurrently.
+	while(dev->cal_CHs && !dev->error)
+	{
+		i = __builtin_ctz(dev->cal_CHs);
+		dev->cal_CHs &= dev->cal_CHs - 1;
+		dev->cal_state = (cal_data_reply){.str = &dev->str, .owner = dev, .ch_index = i};
+		dev->cal_trans = (SDAQ_trans){.dev_addr = dev->address,
+									  .channel = i+1,
+									  .reply_set = SDAQ_REPLY(Calibration_Point_Data)|SDAQ_REPLY(Calibration_Date),
+									  .timeout = CAL_DATA_CH_TIMEOUT,
+									  .retries = RETRY_CNT_INIT,
+									  .request = SDAQ_trans_req_cal_data,
+									  .on_reply = cal_data_reply_dec,
+									  .on_done = fleet_cal_data_done,
+									  .arg = &dev->cal_state};
+		if(!SDAQ_trans_submit(&dev->ctx->eng, &dev->cal_trans))
+			return 0;
+		dev->error = "Request failed";
+	}
+	return 1;
+}
+
+void fleet_cal_data_done(SDAQ_trans *trans, enum SDAQ_trans_result result)
+{
+	fleet_dev *dev = ((cal_data_reply *)trans->arg)->owner;
+
+	if(result != SDAQ_trans_done)
+		dev->error = "Calibration data incomplete";
+	if(!fleet_cal_data_next(dev))
+		return;
+	if(!dev->error)
+		SDAQ_registry_store(&dev->ctx->reg, dev->address, &dev->str);
+	fleet_dev_finish(dev, dev->error);
+}
+
+void fleet_dev_finish(fleet_dev *dev, const char *error)
+{
+	fleet_ctx *ctx = dev->ctx;
+	double elapsed = mono_time_ms() - dev->start;
+
+	if(ctx->xml)
+		XML_fleet_add(ctx->xml, dev->address, &dev->str, error, elapsed);
+	if(!ctx->usr_flag->silent)
+	{
+		if(error)
+			printf("Address %2u: S/N %10u, %s after %.0f msec\n", dev->address, dev->str.SDAQ_info.serial_number, error, elapsed);
+		else
+			printf("Address %2u: S/N %10u, %-10s %2u channels, %.0f msec\n", dev->address, dev->str.SDAQ_info.serial_number,
+				   dev->str.SDAQ_info.dev_type ? dev->str.SDAQ_info.dev_type : "Unknown", dev->str.SDAQ_info.num_of_ch, elapsed);
+	}
+	if(error)
+		ctx->failed++;
+	free_SDAQ_info_cal_data(&dev->str);
+	ctx->active--;
+	fleet_dev_start(ctx);
 }
 
 int get_SDAQ_info_and_calibration_data(int socket_num, unsigned char dev_addr, unsigned int scanning_time, SDAQ_info_cal_data *str)
 {
 	int ret_val;
 	if(!(ret_val = get_SDAQ_info(socket_num, dev_addr, scanning_time, str)))
-		ret_val = get_SDAQ_calibration_data(socket_num, dev_addr, scanning_time, str, NULL);
+		ret_val = get_SDAQ_calibration_data(socket_num, dev_addr, scanning_time, str, 0);
 	return ret_val;
 }
 
 int get_SDAQ_info(int socket_num, unsigned char dev_addr, unsigned int scanning_time, SDAQ_info_cal_data *str)
 {
-	//Union with flags and a counter with the amount of channels. Each flag zero on reception. amount_of_waiting_channel decreases in reception.
-	union RX_info_calibration_date_flags_short rfb = {.as_flags.id_status_msg_flag=1, .as_flags.info_msg_flag=1};
-	//CAN Socket and SDAQ related variables
-	struct can_frame frame_rx;
-	unsigned char Channel;
-	int RX_bytes;
-	GSList *list_node;
-	sdaq_can_id *id_dec = (sdaq_can_id *)&(frame_rx.can_id);
-	sdaq_status *status_dec = (sdaq_status *)frame_rx.data;
-	sdaq_info   *info_dec   = (sdaq_info *)frame_rx.data;
-	sdaq_calibration_date *date_dec = (sdaq_calibration_date *)frame_rx.data;
-	date_list_data_of_node *new_date_node; //date_list_data_of_node work pointer;
-	//Timers related Variables
-	struct itimerval timer;//Scan Timeout
-
-	//initialize timer expired time
-	TMR_exp = 1;
-	memset (&timer, 0, sizeof(timer));
-	timer.it_value.tv_sec = scanning_time;
-	timer.it_value.tv_usec = 0;
-	setitimer (ITIMER_REAL, &timer, NULL);
-
-	//link signal SIGALRM to timer's handler
-	signal(SIGALRM, info_timer_handler);
-
-	//Request SDAQ's info. Wait to received Status/SN, Dev_Info, and calibration date for each channel
-	QueryDeviceInfo(socket_num, dev_addr);
-	while(TMR_exp && rfb.as_bytes)
+	info_reply state = {.str = str};
+	SDAQ_trans_engine eng;
+	//Request SDAQ's info. Reply set: Status/SN, Dev_Info, and calibration date for each channel
+	SDAQ_trans trans = {.dev_addr = dev_addr,
+						.reply_set = SDAQ_REPLY(Device_status)|SDAQ_REPLY(Device_info)|SDAQ_REPLY(Calibration_Date),
+						.timeout = scanning_time*1000,
+						.request = SDAQ_trans_req_info,
+						.on_reply = info_reply_dec,
+						.arg = &state};
+
+	if(SDAQ_trans_engine_init(&eng, socket_num))
 	{
-		RX_bytes=read(socket_num, &frame_rx, sizeof(frame_rx));
-		if(RX_bytes==sizeof(frame_rx))
-		{
-			if(id_dec->device_addr==dev_addr)
-			{
-				switch(id_dec->payload_type)
-				{
-					case Device_status:
-						if(rfb.as_flags.id_status_msg_flag)
-						{
-							str->SDAQ_info.serial_number = status_dec->dev_sn;
-							str->SDAQ_info.dev_type = dev_type_str[status_dec->dev_type];
-							rfb.as_flags.id_status_msg_flag = 0;
-						}
-						break;
-					case Device_info:
-						if(rfb.as_flags.info_msg_flag)
-						{
-							str->SDAQ_info.num_of_ch = info_dec->num_of_ch;
-							str->SDAQ_info.sample_rate = info_dec->sample_rate;
-							str->SDAQ_info.hw_rev = info_dec->hw_rev;
-							str->SDAQ_info.firm_rev = info_dec->firm_rev;
-							str->SDAQ_info.max_cal_point = info_dec->max_cal_point;
-							rfb.as_flags.info_msg_flag = 0;
-							rfb.as_flags.amount_of_waiting_channel = info_dec->num_of_ch;
-						}
-						break;
-					case Calibration_Date:
-						if(rfb.as_flags.amount_of_waiting_channel)
-						{
-							Channel = id_dec->channel_num;
-							if(!(list_node = g_slist_find_custom((GSList *)(str->Calibration_date_list), &Channel, SDAQ_date_node_with_channel_b_find)))
-								new_date_node = new_SDAQ_date_node();
-							else
-								new_date_node = (date_list_data_of_node *)list_node->data;
-							//Load data from decoded "frame_rx" buffer to node
-							new_date_node->ch_num = Channel;
-							new_date_node->year = date_dec->year;
-							new_date_node->month = date_dec->month;
-							new_date_node->day = date_dec->day;
-							new_date_node->period = date_dec->period;
-							new_date_node->amount_of_points = date_dec->amount_of_points;
-							new_date_node->cal_unit = date_dec->cal_units;
-							if(!list_node)
-								str->Calibration_date_list = (struct GSList *)g_slist_append((GSList *)str->Calibration_date_list, new_date_node);
-							rfb.as_flags.amount_of_waiting_channel--;
-						}
-						break;
-				}
-			}
-		}
-		else
-		{
-			printf("No device found\n");
-			return EXIT_FAILURE;
-		}
+		perror("Transaction engine");
+		return EXIT_FAILURE;
 	}
-	if(rfb.as_bytes)
+	if(SDAQ_trans_submit(&eng, &trans) || SDAQ_trans_wait(&eng))
 	{
-		printf("Reception Failed\n");
+		SDAQ_trans_engine_close(&eng);
+		printf("No device found\n");
 		return EXIT_FAILURE;
 	}
-	if(!str->Cal_points_data_lists)
+	SDAQ_trans_engine_close(&eng);
+	if(trans.result != SDAQ_trans_done)
 	{
-		str->Cal_points_data_lists = calloc(str->SDAQ_info.num_of_ch, sizeof(struct GSList *));
-		if(!str->Cal_points_data_lists)
-		{
-			fprintf(stderr,"Memory Error\n");
-			exit(EXIT_FAILURE);
-		}
+		printf(!state.status_rx && !state.info_rx ? "No device found\n" : "Reception Failed\n");
+		return EXIT_FAILURE;
 	}
-	return TMR_exp ? EXIT_SUCCESS : EXIT_FAILURE;
+	SDAQ_cal_model_get(str);//SDAQ without channels has no dates.
+	return EXIT_SUCCESS;
 }
 
-int get_SDAQ_calibration_data(int socket_num, unsigned char dev_addr, unsigned int scanning_time, SDAQ_info_cal_data *str, void **CH_Req)
+int info_reply_dec(SDAQ_trans *trans, const struct can_frame *frame)
 {
-	//CAN Socket and SDAQ related variables
-	struct can_frame frame_rx;
-	int RX_bytes, retry_cnt = RETRY_CNT_INIT;
-	GSList *list_node;
-	sdaq_can_id *id_dec = (sdaq_can_id *)&(frame_rx.can_id);
-	sdaq_calibration_date *date_dec = (sdaq_calibration_date *)frame_rx.data;
-	date_list_data_of_node *new_date_node; //date_list_data_of_node work pointer;
-	sdaq_calibration_points_data *point_node; //sdaq_calibration_points_data work pointer;
-	//Timers related Variables
-	struct itimerval timer;//Scan Timeout
-
-	if(str->SDAQ_info.num_of_ch<=0)
-		return EXIT_FAILURE;
+	info_reply *state = (info_reply *)trans->arg;
+	SDAQ_info_cal_data *str = state->str;
+	const sdaq_can_id *id_dec;
+	const sdaq_status *status_dec;
+	const sdaq_info *info_dec;
+	const sdaq_calibration_date *date_dec;
 
-	if(!str->Cal_points_data_lists)
+	if(!frame)//Retry, the reply set is received again.
 	{
-		str->Cal_points_data_lists = calloc(str->SDAQ_info.num_of_ch, sizeof(struct GSList *));
-		if(!str->Cal_points_data_lists)
-		{
-			fprintf(stderr,"Memory Error\n");
-			exit(EXIT_FAILURE);
-		}
+		state->status_rx = 0;
+		state->info_rx = 0;
+		state->waiting_dates = 0;
+		return 0;
 	}
-
-	//Request SDAQ's info. Wait to received Calibration data points. Recall for each channel
-	for(int i=0,cnt; i<str->SDAQ_info.num_of_ch; i++)
+	id_dec = (const sdaq_can_id *)&(frame->can_id);
+	status_dec = (const sdaq_status *)frame->data;
+	info_dec = (const sdaq_info *)frame->data;
+	date_dec = (const sdaq_calibration_date *)frame->data;
+	switch(id_dec->payload_type)
 	{
-		TMR_exp = 1;
-		if(CH_Req)
-		{
-			list_node = ((GSList **)CH_Req)[i];
-			if(!list_node)
-				continue;
-		}
-		//initialize timer expired time to 250 msec
-		memset (&timer, 0, sizeof(timer));
-		timer.it_value.tv_sec = 0;
-		timer.it_value.tv_usec = 250000;
-		setitimer (ITIMER_REAL, &timer, NULL);
-		cnt=0;
-		QueryCalibrationData(socket_num, dev_addr, i+1);
-		while(TMR_exp && cnt < str->SDAQ_info.max_cal_point*6+1)//6 is the amount of data in a point (meas, ref, offset, gain, C2, C3) + 1 for the extra Calibration_Date message
-		{
-			RX_bytes=read(socket_num, &frame_rx, sizeof(frame_rx));
-			if(RX_bytes==sizeof(frame_rx))
+		case Device_status:
+			if(!state->status_rx)
 			{
-				if(id_dec->device_addr == dev_addr)
-				{
-					switch(id_dec->payload_type)
-					{
-						case Calibration_Point_Data:
-							//Check if Point is already in the Cal_points_data_lists[i].
-							if(!(list_node = g_slist_find_custom((GSList *)(str->Cal_points_data_lists[i]), frame_rx.data, SDAQ_point_node_with_type_and_num_find)))
-								point_node = new_SDAQ_cal_point_node();
-							else
-								point_node = (sdaq_calibration_points_data *)list_node->data;
-							memcpy(point_node, frame_rx.data, sizeof(sdaq_calibration_points_data));
-							if(!list_node)
-								str->Cal_points_data_lists[i] = (struct GSList *)g_slist_append((GSList *)(str->Cal_points_data_lists[i]), point_node);
-							cnt++;
-							break;
-						case Calibration_Date:
-							if((new_date_node = g_slist_nth_data((GSList *)str->Calibration_date_list, i)))
-							{
-								if(new_date_node->ch_num == id_dec->channel_num)
-								{
-									//Check diffs and Reload data from decoded "frame_rx" buffer to node
-									if(new_date_node->amount_of_points != date_dec->amount_of_points)
-										new_date_node->amount_of_points = date_dec->amount_of_points;
-									if(new_date_node->cal_unit != date_dec->cal_units)
-										new_date_node->cal_unit = date_dec->cal_units;
-									if(new_date_node->period != date_dec->period)
-										new_date_node->period = date_dec->period;
-									if(new_date_node->year != date_dec->year || new_date_node->month != date_dec->month || new_date_node->day != date_dec->day)
-									{
-										new_date_node->year = date_dec->year;
-										new_date_node->month = date_dec->month;
-										new_date_node->day = date_dec->day;
-									}
-								}
-								else
-								{
-									printf("Fatal Error@Rx of CalibrationData: Data for CH_%02d received in wrong order!!!\n", i+1);
-									return EXIT_FAILURE;
-								}
-							}
-							else
-							{
-								new_date_node = new_SDAQ_date_node();
-								//Load data from decoded "frame_rx" buffer to node
-								new_date_node->ch_num = id_dec->channel_num;
-								new_date_node->year = date_dec->year;
-								new_date_node->month = date_dec->month;
-								new_date_node->day = date_dec->day;
-								new_date_node->period = date_dec->period;
-								new_date_node->amount_of_points = date_dec->amount_of_points;
-								new_date_node->cal_unit = date_dec->cal_units;
-								str->Calibration_date_list = (struct GSList *)g_slist_append((GSList *)str->Calibration_date_list, new_date_node);
-							}
-							cnt++;
-							break;
-					}
-				}
+				str->SDAQ_info.serial_number = status_dec->dev_sn;
+				str->SDAQ_info.dev_type = status_dec->dev_type < SDAQ_MAX_DEV_NUM ? dev_type_str[status_dec->dev_type] : NULL;
+				str->SDAQ_info.status = status_dec->status;
+				state->status_rx = 1;
 			}
-			else
+			break;
+		case Device_info:
+			if(!state->info_rx)
 			{
-				if(str->Cal_points_data_lists[i])
-				{
-					g_slist_free_full((GSList *)(str->Cal_points_data_lists[i]), free_SDAQ_Date_node);
-					str->Cal_points_data_lists[i] = NULL;
-				}
-				i--;
-				if(!retry_cnt--)
-				{
-					printf("Get of CalibrationData Failed, too many reties (>%d)!!!\n", RETRY_CNT_INIT);
-					return EXIT_FAILURE;
-				}
+				str->SDAQ_info.num_of_ch = info_dec->num_of_ch;
+				str->SDAQ_info.sample_rate = info_dec->sample_rate;
+				str->SDAQ_info.hw_rev = info_dec->hw_rev;
+				str->SDAQ_info.firm_rev = info_dec->firm_rev;
+				str->SDAQ_info.max_cal_point = info_dec->max_cal_point;
+				state->info_rx = 1;
+				state->waiting_dates = info_dec->num_of_ch;
 			}
-		}
+			break;
+		case Calibration_Date:
+			if(state->waiting_dates)
+			{
+				cal_date_dec(str, id_dec->channel_num, date_dec);
+				state->waiting_dates--;
+			}
+			break;
 	}
-	return TMR_exp ? EXIT_SUCCESS : EXIT_FAILURE;
+	return state->status_rx && state->info_rx && !state->waiting_dates;
 }
 
-gint SDAQ_point_node_with_type_and_num_find(gconstpointer a, gconstpointer b)//GFunc function used with g_slist_find_custom.
+int get_SDAQ_calibration_data(int socket_num, unsigned char dev_addr, unsigned int scanning_time, SDAQ_info_cal_data *str, unsigned int CH_Req)
 {
-	const sdaq_calibration_points_data *current_point_node = (sdaq_calibration_points_data* )a,
-									   *wanted_point_num = (sdaq_calibration_points_data* )b;
+	cal_data_reply state;
+	SDAQ_trans trans;
+	SDAQ_trans_engine eng;
+	int retval = EXIT_SUCCESS;
 
-	return current_point_node->type == wanted_point_num->type && current_point_node->points_num == wanted_point_num->points_num ? 0 : 1;
+	if(str->SDAQ_info.num_of_ch<=0 || str->SDAQ_info.num_of_ch>SDAQ_MAX_AMOUNT_OF_CHANNELS)
+		return EXIT_FAILURE;
+	if(!CH_Req)
+		CH_Req = (1U<<str->SDAQ_info.num_of_ch)-1;
+	SDAQ_cal_model_get(str);
+	if(SDAQ_trans_engine_init(&eng, socket_num))
+	{
+		perror("Transaction engine");
+		return EXIT_FAILURE;
+	}
+	//Request the Calibration data of the channels one at a time, each with its own deadline.
+	for(int i=0; i<str->SDAQ_info.num_of_ch && !retval; i++)
+	{
+		if(!(CH_Req & 1U<<i))
+			continue;
+		state = (cal_data_reply){.str = str, .ch_index = i};
+		trans = (SDAQ_trans){.dev_addr = dev_addr,
+							 .channel = i+1,
+							 .reply_set = SDAQ_REPLY(Calibration_Point_Data)|SDAQ_REPLY(Calibration_Date),
+							 .timeout = CAL_DATA_CH_TIMEOUT,
+							 .retries = RETRY_CNT_INIT,
+							 .request = SDAQ_trans_req_cal_data,
+							 .on_reply = cal_data_reply_dec,
+							 .arg = &state};
+		if(SDAQ_trans_submit(&eng, &trans) || SDAQ_trans_wait(&eng))
+			retval = EXIT_FAILURE;
+		else if(trans.result == SDAQ_trans_timeout)
+		{
+			printf("Get of CalibrationData for CH_%02d Failed, too many reties (>%d)!!!\n", i+1, RETRY_CNT_INIT);
+			retval = EXIT_FAILURE;
+		}
+		else if(trans.result != SDAQ_trans_done)
+			retval = EXIT_FAILURE;
+	}
+	SDAQ_trans_engine_close(&eng);
+	return retval;
 }
 
-/*---- Implementation of function for Calibration_date_list ----*/
-// Allocates space for a new SDAQ entrance
-date_list_data_of_node* new_SDAQ_date_node()
+int cal_data_reply_dec(SDAQ_trans *trans, const struct can_frame *frame)
 {
-    date_list_data_of_node *new_date_node_data = g_slice_alloc0(sizeof(date_list_data_of_node));
-    if(!new_date_node_data)
+	cal_data_reply *state = (cal_data_reply *)trans->arg;
+	SDAQ_info_cal_data *str = state->str;
+	const sdaq_can_id *id_dec;
+	const sdaq_calibration_date *date_dec;
+	const sdaq_calibration_points_data *point_dec;
+	unsigned char Channel = state->ch_index+1;
+
+	if(!frame)//Retry, the already received data are kept. The channel is requested again for its missing data.
+		return 0;
+	id_dec = (const sdaq_can_id *)&(frame->can_id);
+	if(id_dec->channel_num != Channel)
+		return 0;
+	switch(id_dec->payload_type)
 	{
-		fprintf(stderr,"Memory Error\n");
-		exit(EXIT_FAILURE);
+		case Calibration_Point_Data:
+			point_dec = (const sdaq_calibration_points_data *)frame->data;
+			if(SDAQ_cal_point_set(str, Channel, point_dec->points_num, point_dec->type, point_dec->data_of_point) < 0)
+				break;
+			if(!(state->point_rx[point_dec->points_num] & 1<<(point_dec->type-1)))
+			{
+				state->point_rx[point_dec->points_num] |= 1<<(point_dec->type-1);
+				state->amount_of_data++;
+			}
+			break;
+		case Calibration_Date:
+			date_dec = (const sdaq_calibration_date *)frame->data;
+			cal_date_dec(str, Channel, date_dec);
+			state->date_rx = 1;
+			break;
 	}
-	return new_date_node_data;
+	//6 is the amount of data in a point (meas, ref, offset, gain, C2, C3), plus the Calibration_Date message
+	return state->date_rx && state->amount_of_data >= str->SDAQ_info.max_cal_point*MAX_DATA_ON_POINT;
 }
-// frees the allocated space for struct SDAQentry and its data
-void free_SDAQ_Date_node(gpointer Date_node)
+
+void cal_date_dec(SDAQ_info_cal_data *str, unsigned char channel, const sdaq_calibration_date *date_dec)
 {
-    if(Date_node)
-	{
-		g_slice_free(date_list_data_of_node, Date_node);
-		Date_node = NULL;
-	}
+	//Load data from decoded "frame" buffer to the date of the channel
+	date_list_data_of_node date = {.ch_num = channel,
+								   .year = date_dec->year,
+								   .month = date_dec->month,
+								   .day = date_dec->day,
+								   .period = date_dec->period,
+								   .amount_of_points = date_dec->amount_of_points,
+								   .cal_unit = date_dec->cal_units};
+
+	SDAQ_cal_date_set(str, &date);
 }
 
-/*---- Declaration of function for Cal_points_data_lists ----*/
-//allocate memory for a new sdaq_calibration_points_data part of Cal_points_data_lists
-sdaq_calibration_points_data* new_SDAQ_cal_point_node()
+/*---- Implementation of functions for the calibration model ----*/
+SDAQ_cal_model* SDAQ_cal_model_get(SDAQ_info_cal_data *conf)
 {
-	sdaq_calibration_points_data *new_point_node_data = (sdaq_calibration_points_data *) g_slice_alloc0(sizeof(sdaq_calibration_points_data));
-    if(!new_point_node_data)
+	if(!conf->cal && !(conf->cal = g_slice_new0(SDAQ_cal_model)))
 	{
 		fprintf(stderr,"Memory Error\n");
 		exit(EXIT_FAILURE);
 	}
-	return new_point_node_data;
+	return conf->cal;
 }
-//used with g_slist_free_full to free the data of node
-void free_SDAQ_cal_point_node(gpointer point_node)
+
+void SDAQ_cal_date_set(SDAQ_info_cal_data *conf, const date_list_data_of_node *date)
 {
-	if(point_node)
-	{
-		g_slice_free(sdaq_calibration_points_data, point_node);
-		point_node = NULL;
-	}
+	SDAQ_cal_model *cal;
+
+	if(!date->ch_num || date->ch_num > SDAQ_MAX_AMOUNT_OF_CHANNELS)
+		return;
+	cal = SDAQ_cal_model_get(conf);
+	cal->date[date->ch_num-1] = *date;
+	cal->date_valid |= 1U<<(date->ch_num-1);
 }
 
-/*
-	Comparing function used in g_slist_find_custom.
-	Find the first node with non zero value on amount_of_points field. Argument b does not used.
-*/
-gint SDAQ_date_node_with_nonzero_amount_of_points_find (gconstpointer a, gconstpointer b)
+int SDAQ_cal_point_set(SDAQ_info_cal_data *conf, unsigned char channel, unsigned char points_num, unsigned char type, float value)
 {
-	return ((date_list_data_of_node *)a)->amount_of_points > 0 ?  0 : 1;
+	SDAQ_cal_model *cal;
+	unsigned char *point_valid;
+
+	if(!channel || channel > SDAQ_MAX_AMOUNT_OF_CHANNELS || points_num >= MAX_AMOUNT_OF_POINTS || type < meas || type > C3)
+		return -1;
+	cal = SDAQ_cal_model_get(conf);
+	cal->point[channel-1][points_num][type-meas] = value;
+	point_valid = &(cal->point_valid[channel-1][points_num]);
+	if(*point_valid & 1<<(type-meas))
+		return 0;
+	*point_valid |= 1<<(type-meas);
+	return 1;
 }
 
-//assist function prints the Data of the points. arg_pass is a pointer to an integer with the amount_of_points that will be print out.
-void printf_SDAQ_cal_point_node(gpointer Point_node, gpointer arg_pass)
+unsigned int SDAQ_cal_chs_with_points(const SDAQ_info_cal_data *conf)
 {
-	unsigned char amount_of_points = *((unsigned char *) arg_pass);
-	sdaq_calibration_points_data *node_dec = (sdaq_calibration_points_data*) Point_node;
-	if(node_dec->points_num<amount_of_points)
-	{
-		switch(node_dec->type)
-		{
-			case meas:
-				printf(" | %2d | %9.3g  | ",node_dec->points_num+1, node_dec->data_of_point);
-				break;
-			case ref:
-				printf(" %9.3g | ",node_dec->data_of_point);
-				break;
-			case offset:
-				printf(" %9.3g | ",node_dec->data_of_point);
-				break;
-			case gain:
-				printf(" %9.3g | ",node_dec->data_of_point);
-				break;
-			case C2:
-				printf(" %9.3g | ",node_dec->data_of_point);
-				break;
-			case C3:
-				printf(" %9.3g |\n",node_dec->data_of_point);
-				if(node_dec->points_num<amount_of_points-1)
-					printf(" |----|------------|------------|------------|------------|------------|------------|\n");
+	unsigned int chs = 0;
+
+	if(!conf->cal)
+		return 0;
+	for(int i=0; i<SDAQ_MAX_AMOUNT_OF_CHANNELS; i++)
+		for(int j=0; j<MAX_AMOUNT_OF_POINTS; j++)
+			if(conf->cal->point_valid[i][j])
+			{
+				chs |= 1U<<i;
 				break;
-			//default :
-		}
-	}
-	return;
+			}
+	return chs;
 }
 
-
-//Called from g_slist_foreach. the pass_arg is the array with with the list of calibration data points
-void printf_SDAQ_Date_with_points_node(gpointer Date_node, gpointer arg_pass)
+void printf_SDAQ_cal_model(const SDAQ_info_cal_data *conf)
 {
-	GSList **point_data_lists = (GSList **) arg_pass;
+	const SDAQ_cal_model *cal = conf->cal;
+	const date_list_data_of_node *date;
+	const float *point;
 	char buff[60];
 	struct tm ptm = {0};
-	date_list_data_of_node *node_dec = Date_node;
+	int i, j, with_points = 0;
 
-	ptm.tm_year = node_dec->year + 100; //100 = 2000-1900
-	ptm.tm_mon = node_dec->month - 1;
-	ptm.tm_mday =  node_dec->day;
-	strftime(buff,sizeof(buff),"%Y/%m/%d",&ptm);
-	if(node_dec->amount_of_points)
+	for(i=0; cal && i<SDAQ_MAX_AMOUNT_OF_CHANNELS; i++)
+		if(cal->date_valid & 1U<<i && cal->date[i].amount_of_points)
+			with_points = 1;
+	if(!with_points)
+	{
+		printf("\tAll channels have 0 amount of points\n");
+		return;
+	}
+	printf("\n\t----- Expiration Date & Point's Data -----\n");
+	for(i=0; i<SDAQ_MAX_AMOUNT_OF_CHANNELS; i++)
 	{
-		printf("   CH%02d: Calibrated @ %s valid for %3d Months, Cal_Points = %2d, Unit = %s%s\n", node_dec->ch_num,
+		date = &(cal->date[i]);
+		if(!(cal->date_valid & 1U<<i) || !date->amount_of_points)
+			continue;
+		ptm.tm_year = date->year + 100; //100 = 2000-1900
+		ptm.tm_mon = date->month - 1;
+		ptm.tm_mday =  date->day;
+		strftime(buff,sizeof(buff),"%Y/%m/%d",&ptm);
+		printf("   CH%02d: Calibrated @ %s valid for %3d Months, Cal_Points = %2d, Unit = %s%s\n", date->ch_num,
 																								   buff,
-																								   node_dec->period,
-																							  	   node_dec->amount_of_points,
-																							  	   unit_str[node_dec->cal_unit],
-																							  	   node_dec->cal_unit<Unit_code_base_region_size?"(Base)":"");
+																								   date->period,
+																							  	   date->amount_of_points,
+																							  	   unit_str[date->cal_unit],
+																							  	   date->cal_unit<Unit_code_base_region_size?"(Base)":"");
 		printf(" /----------------------------------------------------------------------------------\\\n"
 			   " | #  |   Measure  |  Reference |    Offset  |    Gain    |      C2    |      C3    |\n"
 		       " |----|------------|------------|------------|------------|------------|------------|\n");
-		g_slist_foreach((GSList *)(point_data_lists[node_dec->ch_num-1]),printf_SDAQ_cal_point_node,&(node_dec->amount_of_points));
+		for(j=0; j<date->amount_of_points && j<MAX_AMOUNT_OF_POINTS; j++)
+		{
+			point = cal->point[i][j];
+			printf(" | %2d | %9.3g  |  %9.3g |  %9.3g |  %9.3g |  %9.3g |  %9.3g |\n", j+1,
+				   point[meas-meas], point[ref-meas], point[offset-meas], point[gain-meas], point[C2-meas], point[C3-meas]);
+			if(j<date->amount_of_points-1)
+				printf(" |----|------------|------------|------------|------------|------------|------------|\n");
+		}
 		printf(" \\----------------------------------------------------------------------------------/\n");
 	}
-
-	return;
 }
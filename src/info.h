@@ -24,36 +24,64 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #define DATE   (1<<1)
 #define POINTS (1<<2)
 
+#define RETRY_CNT_INIT 10 //Amount of retries for failed Calibration Point Data
+#define CAL_DATA_CH_TIMEOUT 250 //Time in msec for the reception of the Calibration data of a channel
+#define FLEET_MAX_ACTIVE 8 //Max amount of SDAQs with transactions in flight, at getinfo/setinfo of all the SDAQs
+#define FLEET_ADDRS 64 //Size of the address table of getinfo/setinfo of all the SDAQs
+
+//Reply state of the Query_Dev_info transaction of get_SDAQ_info().
+typedef struct info_reply_state{
+	SDAQ_info_cal_data *str;
+	void *owner;//Nullable, used by the completion of the transaction.
+	unsigned status_rx : 1;//Device_status received
+	unsigned info_rx : 1;//Device_info received
+	unsigned char waiting_dates;//Amount of channels without received Calibration_Date
+}info_reply;
+
+//Reply state of the Query_Calibration_Data transaction of a channel, at get_SDAQ_calibration_data().
+typedef struct cal_data_reply_state{
+	SDAQ_info_cal_data *str;
+	void *owner;//Nullable, used by the completion of the transaction.
+	unsigned char ch_index;
+	unsigned date_rx : 1;//Calibration_Date received
+	unsigned char point_rx[MAX_AMOUNT_OF_POINTS];//Bitmap of the received data of each point, bit 0 for type meas.
+	unsigned int amount_of_data;//Amount of distinct received data
+}cal_data_reply;
+
 	/*----- local functions  -----*/
+int info_reply_dec(SDAQ_trans *trans, const struct can_frame *frame);//SDAQ_trans_reply_fn of get_SDAQ_info()
+int cal_data_reply_dec(SDAQ_trans *trans, const struct can_frame *frame);//SDAQ_trans_reply_fn of get_SDAQ_calibration_data()
 //Function that request and receive calibration data (info, dates, points) from SDAQ with address: dev_addr. Return: 0 on success or 1 on failure.
 int get_SDAQ_info_and_calibration_data(int socket_num, unsigned char dev_addr, unsigned int scanning_time, SDAQ_info_cal_data *SDAQ_cal_config);
 //Function that request and receive Device info and calibration dates from a SDAQ with address: dev_addr. Return: 0 on success or 1 on failure.
 int get_SDAQ_info(int socket_num, unsigned char dev_addr, unsigned int scanning_time, SDAQ_info_cal_data *SDAQ_cal_config);
 //Function that request and receive calibration dates and points from a SDAQ with with address: dev_addr. Return: 0 on success or 1 on failure.
 /*
- * CH_Req is a **, structure like SDAQ_info_cal_data.Cal_points_data_lists. Used to determinate which channel's point will requested.
- * If CH_Req == NULL, points from all channels will be request.
+ * CH_Req is a bitmap (bit 0 for CH1) of the channels that their points will requested.
+ * If CH_Req == 0, points from all channels will be request.
  */
-int get_SDAQ_calibration_data(int socket_num, unsigned char dev_addr, unsigned int scanning_time, SDAQ_info_cal_data *SDAQ_cal_config, void **CH_Req);
+int get_SDAQ_calibration_data(int socket_num, unsigned char dev_addr, unsigned int scanning_time, SDAQ_info_cal_data *SDAQ_cal_config, unsigned int CH_Req);
 
 //Function that send the data from SDAQ_info_cal_data *str to SDAQ with address: dev_addr. Return: 0 on success or 1 on failure.
 int set_SDAQ_info_and_calibration_data(int socket_num, unsigned char dev_addr, SDAQ_info_cal_data *SDAQ_cal_config);
 
+/*
+ * Function that fill delta with the calibration dates and the points of new_conf that differ from cur_conf.
+ * The date of a channel with different points is included, to be written after its points.
+ * Return: The amount of frames needed for the upload of delta, zero if cur_conf is up to date.
+ */
+int diff_SDAQ_info_and_calibration_data(SDAQ_info_cal_data *cur_conf, SDAQ_info_cal_data *new_conf, SDAQ_info_cal_data *delta);
+
 //Function that correlate two SDAQ_info_cal_data (new and current config). Return EXIT_SUCCESS, if new related with the old; otherwise EXIT_FAILURE.
 int corr_SDAQ_info_and_calibration_data(SDAQ_info_cal_data *cur_conf, SDAQ_info_cal_data *new_conf, unsigned char options);
 
-//Declaration of function for Calibration_date_list
-date_list_data_of_node* new_SDAQ_date_node();//allocate memory for a new sdaq_calibration_date.
-void free_SDAQ_Date_node(gpointer Date_node);//used with g_slist_free_full to free the data of node.
-gint SDAQ_point_node_with_type_and_num_find(gconstpointer a, gconstpointer b);//GFunc function used with g_slist_find_custom.
-gint SDAQ_date_node_with_nonzero_amount_of_points_find(gconstpointer a, gconstpointer b);//GFunc function used with g_slist_find_custom.
-gint SDAQ_date_node_with_channel_b_find(gconstpointer a, gconstpointer b);//GFunc type function used with g_slist_find_custom.
-
-//Declaration of function for Cal_points_data_lists
-sdaq_calibration_points_data* new_SDAQ_cal_point_node();//allocate memory for a new sdaq_calibration_points_data part of Cal_points_data_lists.
-void free_SDAQ_cal_point_node(gpointer Point_node);//used with g_slist_free_full to free the data of node.
-//Called from g_slist_foreach. the pass_arg is the array with with the list of calibration data points.
-void printf_SDAQ_Date_with_points_node(gpointer Date_node, gpointer pass_arg);
+//Declaration of functions for the calibration model (aka SDAQ_cal_model)
+SDAQ_cal_model* SDAQ_cal_model_get(SDAQ_info_cal_data *conf);//Return the model of conf, allocated on first use.
+void SDAQ_cal_date_set(SDAQ_info_cal_data *conf, const date_list_data_of_node *date);//Store date as the calibration date of date->ch_num.
+//Store a data of point points_num at channel (1 for CH1). Return: 1 if the data is new, 0 if already stored, -1 if it's out of range.
+int SDAQ_cal_point_set(SDAQ_info_cal_data *conf, unsigned char channel, unsigned char points_num, unsigned char type, float value);
+unsigned int SDAQ_cal_chs_with_points(const SDAQ_info_cal_data *conf);//Return the bitmap (bit 0 for CH1) of the channels with points data.
+void printf_SDAQ_cal_model(const SDAQ_info_cal_data *conf);//Print the dates and the points data of the channels with points.
 
 //Function that freeing data of SDAQ_info_cal_data.
 void free_SDAQ_info_cal_data(SDAQ_info_cal_data *conf);
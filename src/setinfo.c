@@ -21,6 +21,7 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 #include <unistd.h>
 #include <math.h>
 
+#include <time.h>
 #include <ncurses.h>
 
 #include <sys/time.h>
@@ -31,14 +32,97 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include "info.h"//including -> "SDAQ_drv.h", "Modes.h"
 #include "SDAQ_xml.h"
+#include "SDAQ_registry.h"
+
+enum cal_upload_phase{
+	cal_upload_unlock,//Calibration date with zero points, it enables the editing of the points.
+	cal_upload_points,
+	cal_upload_date,
+	cal_upload_done//Channel completed
+};
+
+//Cursor of the upload of a calibration model, one step (a calibration date or the data of a point) at a time.
+typedef struct cal_upload_cursor{
+	unsigned char ch;//Index of the channel
+	unsigned char point;//Index of the point, at phase cal_upload_points
+	unsigned char phase;
+	unsigned int CHs_with_points;//Channels that get their points, the others get only their date.
+}cal_upload;
+
+//States of an SDAQ, at setinfo of all the SDAQs.
+enum fleet_set_states{
+	fleet_set_info,
+	fleet_set_cal_data,//Points of the SDAQ, for the delta
+	fleet_set_upload,
+	fleet_set_verify_info,
+	fleet_set_verify_cal_data,
+	fleet_set_done
+};
+
+struct fleet_set_context;
+//State of an SDAQ, at setinfo of all the SDAQs.
+typedef struct fleet_set_device{
+	struct fleet_set_context *ctx;
+	unsigned char address;
+	unsigned char state;
+	SDAQ_info_cal_data *new_conf;//Entry of the manifest
+	SDAQ_info_cal_data cur_conf, delta;
+	SDAQ_info_cal_data *upload;//new_conf, or delta
+	info_reply info_state;
+	cal_data_reply cal_state;
+	SDAQ_trans info_trans;
+	SDAQ_trans cal_trans;
+	unsigned int cal_CHs;//Bitmap of the channels with calibration data not requested yet
+	SDAQ_tx_batch tx;
+	cal_upload cursor;
+	unsigned long long next_burst;//Time of the next burst of the upload, msec on CLOCK_MONOTONIC
+	int amount_of_frames;//Amount of the uploaded frames
+	unsigned long long start;//Start of the setinfo, msec on CLOCK_MONOTONIC
+	const char *error;
+}fleet_set_dev;
+
+//Context of setinfo of all the SDAQs.
+typedef struct fleet_set_context{
+	SDAQ_trans_engine eng;
+	SDAQ_registry reg;
+	opt_flags *usr_flag;
+	fleet_set_dev *devs;
+	unsigned int amount, next, active, failed;
+	unsigned abort : 1;//No more SDAQs are started
+}fleet_set_ctx;
 
 	//--- Local Functions declaration ---//
 //Function for decode external command
 int str_dec(char **arg, char *input_buff, const char *delim);
 //Function for construction of struct tm with calibration date of SDAQ
 int date_to_tm(struct tm *output_date, char *input_buff);
-//Function that return the amount of channels with points
-int cnt_conf_CHs(SDAQ_info_cal_data * conf);
+//Function that invalidate the registry entry of the SDAQ at dev_addr, after a change of its calibration.
+void invalidate_registry_entry(unsigned char dev_addr, opt_flags *usr_flag);
+//Function that upload to the SDAQ at dev_addr only the differences of new_conf from its current calibration (cur_conf).
+int setinfo_delta(int socket_num, unsigned char dev_addr, SDAQ_info_cal_data *cur_conf, SDAQ_info_cal_data *new_conf, opt_flags *usr_flag);
+//Function that initialize cursor for the upload of conf.
+void cal_upload_init(cal_upload *cursor, SDAQ_info_cal_data *conf);
+//Function that queue at tx the next step of the upload of conf to dev_addr. Return: 1 if a step is queued, 0 if the upload is completed, or -1 on failure.
+int cal_upload_next(SDAQ_tx_batch *tx, unsigned char dev_addr, SDAQ_info_cal_data *conf, cal_upload *cursor);
+//setinfo for all the SDAQs of the bus, with the manifest at usr_flag->info_file
+int setinfo_all(int socket_num, opt_flags *usr_flag);
+void fleet_set_start(fleet_set_ctx *ctx);//Start the setinfo of the next SDAQ
+void fleet_set_finish(fleet_set_dev *dev, const char *error);//Report the SDAQ, and start the next
+int fleet_set_cal_data_req(fleet_set_dev *dev, unsigned int CHs);//Request the calibration data of the channels CHs, one at a time. Return: 0 on request, or 1 on failure.
+int fleet_set_cal_data_next(fleet_set_dev *dev);//Request the calibration data of the next channel. Return: 0 on request, or 1 when there is none.
+void fleet_set_info_done(SDAQ_trans *trans, enum SDAQ_trans_result result);//SDAQ_trans_done_fn of the info transactions
+void fleet_set_cal_data_done(SDAQ_trans *trans, enum SDAQ_trans_result result);//SDAQ_trans_done_fn of the calibration data transactions
+void fleet_set_upload_start(fleet_set_dev *dev);//Start the upload of the calibration
+void fleet_set_tx(fleet_set_dev *dev, unsigned long long now, unsigned long long *wake_at);//Send the next burst of the upload, if it's time
+void fleet_set_verify(fleet_set_dev *dev);//Correlate the received calibration with the uploaded one
+
+static inline unsigned long long mono_time_ms(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec*1000ULL + now.tv_nsec/1000000;
+}
 
 int setinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 {
@@ -48,6 +132,15 @@ int setinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 	struct tm date;
 	SDAQ_info_cal_data cur_conf={0}, new_conf={0};
 	int retval;
+	if(dev_addr == Broadcast)
+	{
+		if(!usr_flag->info_file || usr_flag->ext_com)
+		{
+			printf("Mode setinfo for all the SDAQs needs a manifest (-f)\n");
+			return EXIT_FAILURE;
+		}
+		return setinfo_all(socket_num, usr_flag);
+	}
 	if(usr_flag->ext_com)
 	{
 		argc = str_dec(argv, usr_flag->ext_com, " ");
@@ -63,6 +156,7 @@ int setinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 					NumOfPoints = atoi(argv[4]);
 					unit = atoi(argv[5]);
 					WriteCalibrationDate(socket_num, dev_addr, channel_num, &date, period, NumOfPoints, unit);
+					invalidate_registry_entry(dev_addr, usr_flag);
 					return EXIT_SUCCESS;
 				}
 			}
@@ -74,6 +168,7 @@ int setinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 					Point_num = atoi(argv[3]);
 					type = atoi(argv[4]);
 					WriteCalibrationPoint(socket_num, dev_addr, channel_num, point_val, Point_num, type);
+					invalidate_registry_entry(dev_addr, usr_flag);
 					return EXIT_SUCCESS;
 				}
 			}
@@ -101,7 +196,12 @@ int setinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 	}
 	if(!(retval = get_SDAQ_info(socket_num, dev_addr, usr_flag->timeout, &cur_conf)))
 	{
-		if(usr_flag->info_file)
+		if(usr_flag->info_file && usr_flag->delta)
+		{
+			retval = setinfo_delta(socket_num, dev_addr, &cur_conf, &new_conf, usr_flag);
+			free_SDAQ_info_cal_data(&new_conf);
+		}
+		else if(usr_flag->info_file)
 		{
 			if(!usr_flag->silent)
 			{
@@ -115,7 +215,9 @@ int setinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 					printf("Success\nSend new_config to SDAQ: ");
 					fflush(stdout);
 				}
-				if(!(retval = set_SDAQ_info_and_calibration_data(socket_num, dev_addr, &new_conf)))
+				retval = set_SDAQ_info_and_calibration_data(socket_num, dev_addr, &new_conf);
+				invalidate_registry_entry(dev_addr, usr_flag);
+				if(!retval)
 				{
 					if(!usr_flag->silent)
 						printf("Success\n");
@@ -126,11 +228,11 @@ int setinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 							printf("Verification: ");
 							fflush(stdout);
 						}
-						if(!cnt_conf_CHs(&new_conf))
+						if(!SDAQ_cal_chs_with_points(&new_conf))
 							retval = get_SDAQ_info(socket_num, dev_addr, usr_flag->timeout, &cur_conf);
 						else
 						{
-							if(!(retval = get_SDAQ_calibration_data(socket_num, dev_addr, usr_flag->timeout, &cur_conf, (void **)new_conf.Cal_points_data_lists)))
+							if(!(retval = get_SDAQ_calibration_data(socket_num, dev_addr, usr_flag->timeout, &cur_conf, SDAQ_cal_chs_with_points(&new_conf))))
 							{
 								if(!(retval = corr_SDAQ_info_and_calibration_data(&cur_conf, &new_conf, DATE|POINTS)))
 								{
@@ -153,6 +255,79 @@ int setinfo(int socket_num, unsigned char dev_addr, opt_flags *usr_flag)
 	return retval;
 }
 
+int setinfo_delta(int socket_num, unsigned char dev_addr, SDAQ_info_cal_data *cur_conf, SDAQ_info_cal_data *new_conf, opt_flags *usr_flag)
+{
+	SDAQ_info_cal_data delta = {0};
+	unsigned int CHs;
+	int retval, amount_of_frames;
+
+	if(!usr_flag->silent)
+	{
+		printf("Success\nCorrelation SDAQ<>new_config: ");
+		fflush(stdout);
+	}
+	if(corr_SDAQ_info_and_calibration_data(cur_conf, new_conf, INFO))
+		return EXIT_FAILURE;
+	//The points of the SDAQ are needed only for the channels with points at new_conf.
+	if((CHs = SDAQ_cal_chs_with_points(new_conf)))
+	{
+		if(!usr_flag->silent)
+		{
+			printf("Success\nGet Calibration points from SDAQ: ");
+			fflush(stdout);
+		}
+		if(get_SDAQ_calibration_data(socket_num, dev_addr, usr_flag->timeout, cur_conf, CHs))
+			return EXIT_FAILURE;
+	}
+	if(!(amount_of_frames = diff_SDAQ_info_and_calibration_data(cur_conf, new_conf, &delta)))
+	{
+		if(!usr_flag->silent)
+			printf("Success\nSDAQ's calibration is up to date\n");
+		return EXIT_SUCCESS;
+	}
+	if(!usr_flag->silent)
+	{
+		printf("Success\nSend the differences of new_config to SDAQ (%d frames): ", amount_of_frames);
+		fflush(stdout);
+	}
+	retval = set_SDAQ_info_and_calibration_data(socket_num, dev_addr, &delta);
+	invalidate_registry_entry(dev_addr, usr_flag);
+	if(!retval)
+	{
+		if(!usr_flag->silent)
+			printf("Success\n");
+		if(usr_flag->verify)
+		{
+			if(!usr_flag->silent)
+			{
+				printf("Verification: ");
+				fflush(stdout);
+			}
+			//Only the dates and the channels with points at delta are received again and checked.
+			if(!(retval = get_SDAQ_info(socket_num, dev_addr, usr_flag->timeout, cur_conf)) && (CHs = SDAQ_cal_chs_with_points(&delta)))
+				retval = get_SDAQ_calibration_data(socket_num, dev_addr, usr_flag->timeout, cur_conf, CHs);
+			if(!retval && !(retval = corr_SDAQ_info_and_calibration_data(cur_conf, &delta, CHs ? DATE|POINTS : DATE)))
+			{
+				if(!usr_flag->silent)
+					printf("\tSuccess\n");
+			}
+		}
+	}
+	free_SDAQ_info_cal_data(&delta);
+	return retval;
+}
+
+void invalidate_registry_entry(unsigned char dev_addr, opt_flags *usr_flag)
+{
+	SDAQ_registry reg;
+
+	if(usr_flag->no_registry || SDAQ_registry_open(&reg, usr_flag->CANif_name))
+		return;
+	SDAQ_registry_invalidate(&reg, dev_addr);
+	SDAQ_registry_save(&reg);
+	SDAQ_registry_close(&reg);
+}
+
 int str_dec(char **arg, char *input_buff, const char *delim)
 {
 	unsigned char i=0;
@@ -180,25 +355,13 @@ int date_to_tm(struct tm *output_date, char *input_buff)
 	return -1;
 }
 
-int cnt_conf_CHs(SDAQ_info_cal_data *conf)
-{
-	int i,cnt;
-	if(!conf->Cal_points_data_lists)
-		return 0;
-	for(i=0, cnt=0; i<conf->SDAQ_info.num_of_ch; i++)
-		if(conf->Cal_points_data_lists[i])
-			cnt++;
-	return cnt;
-}
-
 int corr_SDAQ_info_and_calibration_data(SDAQ_info_cal_data *cur_conf, SDAQ_info_cal_data *new_conf, unsigned char options)
 {
 	int retval = EXIT_FAILURE;
 	char new_unit_str[10],cur_unit_str[10];
-	GSList *cur_date_list_data_of_nodes, *new_date_list_data_of_nodes, *cur_date_list_data_node;
 	date_list_data_of_node *cur_date_data, *new_date_data;
-	GSList *cur_cal_point_list, *new_cal_point_list;
-	sdaq_calibration_points_data *cur_point_data, *new_point_data;
+	unsigned char cur_point_valid, new_point_valid;
+	float cur_point_data, new_point_data;
 
 	if(!cur_conf || !new_conf)
 		return EXIT_FAILURE;
@@ -242,174 +405,526 @@ int corr_SDAQ_info_and_calibration_data(SDAQ_info_cal_data *cur_conf, SDAQ_info_
 	}
 	if(options & DATE)
 	{
-		if(!(new_date_list_data_of_nodes = (GSList *)new_conf->Calibration_date_list)||!(cur_date_list_data_of_nodes = (GSList *)cur_conf->Calibration_date_list))
+		if(!new_conf->cal || !new_conf->cal->date_valid || !cur_conf->cal)
 		{
-			if(!new_date_list_data_of_nodes)
-				fprintf(stderr, "new_conf->Calibration_date_list is undefined !!!\n");
-			if(!cur_date_list_data_of_nodes)
-				fprintf(stderr, "cur_conf->Calibration_date_list is undefined !!!\n");
+			if(!new_conf->cal || !new_conf->cal->date_valid)
+				fprintf(stderr, "new_conf calibration dates are undefined !!!\n");
+			if(!cur_conf->cal)
+				fprintf(stderr, "cur_conf calibration dates are undefined !!!\n");
 			return EXIT_FAILURE;
 		}
-		while(new_date_list_data_of_nodes)
+		for(int ch=0; ch<SDAQ_MAX_AMOUNT_OF_CHANNELS; ch++)
 		{
-			new_date_data = (date_list_data_of_node *)new_date_list_data_of_nodes->data;
-			if((cur_date_list_data_node = g_slist_find_custom(cur_date_list_data_of_nodes, &(new_date_data->ch_num), SDAQ_date_node_with_channel_b_find)))
+			if(!(new_conf->cal->date_valid & 1U<<ch))
+				continue;
+			new_date_data = &(new_conf->cal->date[ch]);
+			if(!(cur_conf->cal->date_valid & 1U<<ch))
 			{
-				cur_date_data = (date_list_data_of_node *)cur_date_list_data_node->data;
-				if(cur_date_data->year != new_date_data->year || cur_date_data->month != new_date_data->month || cur_date_data->day != new_date_data->day)
-				{
-					fprintf(stderr, "Calibration Date of CH%d(%d/%d/%d) is different from the configuration (%d/%d/%d)!!!\n", new_date_data->ch_num,
-																															  cur_date_data->year+2000,cur_date_data->month,cur_date_data->day,
-																															  new_date_data->year+2000,new_date_data->month,new_date_data->day);
-					return EXIT_FAILURE;
-				}
-				if(cur_date_data->period != new_date_data->period)
-				{
-					fprintf(stderr, "Calibration period of CH%d(%d) is different from the configuration (%d)!!!\n", new_date_data->ch_num, cur_date_data->period, new_date_data->period);
-					return EXIT_FAILURE;
-				}
-				if(cur_date_data->amount_of_points != new_date_data->amount_of_points)
-				{
-					fprintf(stderr, "Amount of points for CH%d(%d) is different from the configuration (%d)!!!\n", new_date_data->ch_num, cur_date_data->period, new_date_data->period);
-					return EXIT_FAILURE;
-				}
-				if(cur_date_data->cal_unit != new_date_data->cal_unit)
-				{
-					sprintf(cur_unit_str, "%s%s", unit_str[cur_date_data->cal_unit], cur_date_data->cal_unit<Unit_code_base_region_size?"(Base)":"");
-					sprintf(new_unit_str, "%s%s", unit_str[new_date_data->cal_unit], new_date_data->cal_unit<Unit_code_base_region_size?"(Base)":"");
-					fprintf(stderr, "Calibration Unit of CH%d(%s) is different from the configuration (%s)!!!\n", new_date_data->ch_num, cur_unit_str, new_unit_str);
-					return EXIT_FAILURE;
-				}
+				fprintf(stderr, "date node for CH%d was not found at configurations of the SDAQ!!!\n", new_date_data->ch_num);
+				return EXIT_FAILURE;
 			}
-			else
+			cur_date_data = &(cur_conf->cal->date[ch]);
+			if(cur_date_data->year != new_date_data->year || cur_date_data->month != new_date_data->month || cur_date_data->day != new_date_data->day)
 			{
-				fprintf(stderr, "date node for CH%d was not found at configurations of the SDAQ!!!\n", new_date_data->ch_num);
+				fprintf(stderr, "Calibration Date of CH%d(%d/%d/%d) is different from the configuration (%d/%d/%d)!!!\n", new_date_data->ch_num,
+																														  cur_date_data->year+2000,cur_date_data->month,cur_date_data->day,
+																														  new_date_data->year+2000,new_date_data->month,new_date_data->day);
+				return EXIT_FAILURE;
+			}
+			if(cur_date_data->period != new_date_data->period)
+			{
+				fprintf(stderr, "Calibration period of CH%d(%d) is different from the configuration (%d)!!!\n", new_date_data->ch_num, cur_date_data->period, new_date_data->period);
+				return EXIT_FAILURE;
+			}
+			if(cur_date_data->amount_of_points != new_date_data->amount_of_points)
+			{
+				fprintf(stderr, "Amount of points for CH%d(%d) is different from the configuration (%d)!!!\n", new_date_data->ch_num, cur_date_data->period, new_date_data->period);
+				return EXIT_FAILURE;
+			}
+			if(cur_date_data->cal_unit != new_date_data->cal_unit)
+			{
+				sprintf(cur_unit_str, "%s%s", unit_str[cur_date_data->cal_unit], cur_date_data->cal_unit<Unit_code_base_region_size?"(Base)":"");
+				sprintf(new_unit_str, "%s%s", unit_str[new_date_data->cal_unit], new_date_data->cal_unit<Unit_code_base_region_size?"(Base)":"");
+				fprintf(stderr, "Calibration Unit of CH%d(%s) is different from the configuration (%s)!!!\n", new_date_data->ch_num, cur_unit_str, new_unit_str);
 				return EXIT_FAILURE;
 			}
-			new_date_list_data_of_nodes = new_date_list_data_of_nodes->next;
 		}
 		retval = EXIT_SUCCESS;
 	}
 	if(options & POINTS)
 	{
-		if(!new_conf->Cal_points_data_lists || !cur_conf->Cal_points_data_lists)
+		if(!new_conf->cal || !cur_conf->cal)
 		{
-			if(!new_conf->Cal_points_data_lists)
-				fprintf(stderr, "new_conf->Cal_points_data_lists is undefined !!!\n");
-			if(!cur_conf->Cal_points_data_lists)
-				fprintf(stderr, "cur_conf->Cal_points_data_lists is undefined !!!\n");
+			if(!new_conf->cal)
+				fprintf(stderr, "new_conf calibration points are undefined !!!\n");
+			if(!cur_conf->cal)
+				fprintf(stderr, "cur_conf calibration points are undefined !!!\n");
 			return EXIT_FAILURE;
 		}
-		for(int ch=0; ch<new_conf->SDAQ_info.num_of_ch; ch++)
+		for(int ch=0; ch<new_conf->SDAQ_info.num_of_ch && ch<SDAQ_MAX_AMOUNT_OF_CHANNELS; ch++)
 		{
-			if(!(new_cal_point_list = (GSList *)new_conf->Cal_points_data_lists[ch]))
-				continue;
-			if(!(cur_cal_point_list = (GSList *)cur_conf->Cal_points_data_lists[ch]))
+			for(int j=0; j<MAX_AMOUNT_OF_POINTS; j++)
 			{
-				fprintf(stderr, "cur_conf->Cal_points_data_lists[%d] is undefined !!!\n",ch+1);
-				return EXIT_FAILURE;
-			}
-			while(new_cal_point_list && cur_cal_point_list)
-			{
-
-				cur_point_data = (sdaq_calibration_points_data *)(cur_cal_point_list->data);
-				new_point_data = (sdaq_calibration_points_data *)(new_cal_point_list->data);
-				if(cur_point_data->data_of_point != new_point_data->data_of_point ||
-				   cur_point_data->type != new_point_data->type ||
-				   cur_point_data->points_num != new_point_data->points_num)
+				if(!(new_point_valid = new_conf->cal->point_valid[ch][j]))
+					continue;
+				cur_point_valid = cur_conf->cal->point_valid[ch][j];
+				for(int k=0; k<MAX_DATA_ON_POINT; k++)
 				{
-					fprintf(stderr, "Error @ CH%d Point_%d: ",ch+1, new_point_data->points_num);
-					if(cur_point_data->data_of_point != new_point_data->data_of_point)
-						fprintf(stderr, "cur_point_Val=%f != new_point_val= %f", cur_point_data->data_of_point, new_point_data->data_of_point);
-					if(cur_point_data->type != new_point_data->type)
-						fprintf(stderr, "cur_point_type=%s != new_point_type= %s", type_of_point_str[cur_point_data->type], type_of_point_str[new_point_data->type]);
-					fprintf(stderr, "\n");
-					return EXIT_FAILURE;
+					if(!(new_point_valid & 1<<k))
+						continue;
+					if(!(cur_point_valid & 1<<k))
+					{
+						fprintf(stderr, "Error @ CH%d Point_%d: cur_point_type=%s is undefined !!!\n",ch+1, j, type_of_point_str[k+meas]);
+						return EXIT_FAILURE;
+					}
+					cur_point_data = cur_conf->cal->point[ch][j][k];
+					new_point_data = new_conf->cal->point[ch][j][k];
+					if(cur_point_data != new_point_data)
+					{
+						fprintf(stderr, "Error @ CH%d Point_%d: cur_point_Val=%f != new_point_val= %f (%s)\n",ch+1, j, cur_point_data, new_point_data, type_of_point_str[k+meas]);
+						return EXIT_FAILURE;
+					}
 				}
-				new_cal_point_list = new_cal_point_list->next;
-				cur_cal_point_list = cur_cal_point_list->next;
-			}
-			if(new_cal_point_list && !cur_cal_point_list)
-			{
-				fprintf(stderr, "sizeof(cur_conf->Cal_points_data_lists[%d]) < sizeof(new_conf->Cal_points_data_lists[%d])!!!\n",ch+1, ch+1);
-				return EXIT_FAILURE;
 			}
 		}
-
 		retval = EXIT_SUCCESS;
 	}
 	return retval;
 }
 
+int diff_SDAQ_info_and_calibration_data(SDAQ_info_cal_data *cur_conf, SDAQ_info_cal_data *new_conf, SDAQ_info_cal_data *delta)
+{
+	SDAQ_cal_model *cur, *new, *diff;
+	date_list_data_of_node *cur_date, *new_date;
+	int amount_of_frames = 0, amount_of_points;
+
+	if(!cur_conf || !new_conf || !delta || !(new = new_conf->cal))
+		return 0;
+	cur = SDAQ_cal_model_get(cur_conf);
+	delta->SDAQ_info = new_conf->SDAQ_info;
+	diff = SDAQ_cal_model_get(delta);
+	for(int ch=0; ch<SDAQ_MAX_AMOUNT_OF_CHANNELS; ch++)
+	{
+		if(!(new->date_valid & 1U<<ch))
+			continue;
+		amount_of_points = 0;
+		for(int j=0; j<MAX_AMOUNT_OF_POINTS; j++)
+			for(int k=0; k<MAX_DATA_ON_POINT; k++)
+			{
+				if(!(new->point_valid[ch][j] & 1<<k))
+					continue;
+				if(cur->point_valid[ch][j] & 1<<k && cur->point[ch][j][k] == new->point[ch][j][k])
+					continue;
+				diff->point[ch][j][k] = new->point[ch][j][k];
+				diff->point_valid[ch][j] |= 1<<k;
+				amount_of_points++;
+			}
+		cur_date = &(cur->date[ch]);
+		new_date = &(new->date[ch]);
+		//A channel with new points is written with a date of zero points before them, and with its date after them.
+		if(amount_of_points)
+			amount_of_frames += amount_of_points + 2;
+		else if(!(cur->date_valid & 1U<<ch) ||
+				cur_date->year != new_date->year || cur_date->month != new_date->month || cur_date->day != new_date->day ||
+				cur_date->period != new_date->period || cur_date->amount_of_points != new_date->amount_of_points ||
+				cur_date->cal_unit != new_date->cal_unit)
+			amount_of_frames++;
+		else
+			continue;
+		SDAQ_cal_date_set(delta, new_date);
+	}
+	return amount_of_frames;
+}
+
 //Function that send the data from SDAQ_info_cal_data to SDAQ with address: dev_addr. Return: 0 on success or 1 on failure
 int set_SDAQ_info_and_calibration_data(int socket_num, unsigned char dev_addr, SDAQ_info_cal_data *new_SDAQ_cal_config)
 {
-	GSList *new_date_node, *new_cal_data_nodes;
+	SDAQ_tx_batch tx;
+	cal_upload cursor;
+	int ret;
+
+	if(!new_SDAQ_cal_config || !new_SDAQ_cal_config->cal || !new_SDAQ_cal_config->cal->date_valid)
+		return EXIT_FAILURE;
+	//Calibration data sent frame by frame, with gap after each for SDAQ to store it.
+	SDAQ_tx_init(&tx, socket_num, SDAQ_CAL_TX_BURST, SDAQ_CAL_TX_GAP);
+	cal_upload_init(&cursor, new_SDAQ_cal_config);
+	while((ret = cal_upload_next(&tx, dev_addr, new_SDAQ_cal_config, &cursor)) > 0)
+		if(SDAQ_tx_flush(&tx))
+		{
+			ret = -1;
+			break;
+		}
+	if(ret < 0)
+	{
+		fprintf(stderr, "Failure at WriteCalibration%s() for CH%d\n", cursor.phase == cal_upload_points ? "Point" : "Date", cursor.ch+1);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+void cal_upload_init(cal_upload *cursor, SDAQ_info_cal_data *conf)
+{
+	*cursor = (cal_upload){.phase = cal_upload_unlock};
+	//Points are written only at the channels that have them, a channel without points gets only its date.
+	cursor->CHs_with_points = SDAQ_cal_chs_with_points(conf);
+}
+
+int cal_upload_next(SDAQ_tx_batch *tx, unsigned char dev_addr, SDAQ_info_cal_data *conf, cal_upload *cursor)
+{
+	SDAQ_cal_model *cal = conf->cal;
 	date_list_data_of_node *date_node_data;
-	sdaq_calibration_points_data *cal_point_node_data;
 	struct tm date={0};
+	int ch;
 
-	if(!new_SDAQ_cal_config || !new_SDAQ_cal_config->Calibration_date_list)
-		return EXIT_FAILURE;
-	for(new_date_node = (GSList *)new_SDAQ_cal_config->Calibration_date_list; new_date_node; new_date_node=new_date_node->next)
+	if(!cal)
+		return 0;
+	for(; (ch = cursor->ch) < SDAQ_MAX_AMOUNT_OF_CHANNELS; cursor->ch++, cursor->point = 0, cursor->phase = cal_upload_unlock)
 	{
-		date_node_data = (date_list_data_of_node *)(new_date_node->data);
+		if(!(cal->date_valid & 1U<<ch) || cursor->phase == cal_upload_done)
+			continue;
+		date_node_data = &(cal->date[ch]);
 		//Load calibration date to struct tm date
 		date.tm_year = 100 + date_node_data->year;
 		date.tm_mon = date_node_data->month - 1;
 		date.tm_mday = date_node_data->day;
-		if(date_node_data->amount_of_points)
+		if(cursor->phase == cal_upload_unlock)
 		{
-			//Write CalibrationDate data with 0 amount_of_points to enable SDAQ calibration editing.
-			if(WriteCalibrationDate(socket_num, dev_addr, date_node_data->ch_num, &date, date_node_data->period, 0, date_node_data->cal_unit))
+			cursor->phase = cal_upload_points;
+			if(cursor->CHs_with_points & 1U<<ch)
 			{
-				fprintf(stderr, "Failure at WriteCalibrationDate() for CH%d\n",date_node_data->ch_num);
-				return EXIT_FAILURE;
+				//Write CalibrationDate data with 0 amount_of_points to enable SDAQ calibration editing.
+				if(SDAQ_tx_WriteCalibrationDate(tx, dev_addr, date_node_data->ch_num, &date, date_node_data->period, 0, date_node_data->cal_unit))
+					return -1;
+				return 1;
 			}
-			new_cal_data_nodes = (GSList *)new_SDAQ_cal_config->Cal_points_data_lists[date_node_data->ch_num-1];
-			while(new_cal_data_nodes)
+		}
+		if(cursor->phase == cal_upload_points)
+		{
+			while(cursor->point < MAX_AMOUNT_OF_POINTS && !cal->point_valid[ch][cursor->point])
+				cursor->point++;
+			if(cursor->point < MAX_AMOUNT_OF_POINTS)
 			{
-				cal_point_node_data = (sdaq_calibration_points_data *)(new_cal_data_nodes->data);
-				if(WriteCalibrationPoint(socket_num, dev_addr, date_node_data->ch_num, cal_point_node_data->data_of_point, cal_point_node_data->points_num, cal_point_node_data->type))
-				{
-					fprintf(stderr, "Failure at WriteCalibrationPoint() for CH%d at point %d\n",date_node_data->ch_num, cal_point_node_data->points_num);
-					return EXIT_FAILURE;
-				}
-				new_cal_data_nodes = new_cal_data_nodes->next;
+				for(int k=0; k<MAX_DATA_ON_POINT; k++)
+					if(cal->point_valid[ch][cursor->point] & 1<<k &&
+					   SDAQ_tx_WriteCalibrationPoint(tx, dev_addr, date_node_data->ch_num, cal->point[ch][cursor->point][k], cursor->point, k+meas))
+						return -1;
+				cursor->point++;
+				return 1;
 			}
+			cursor->phase = cal_upload_date;
 		}
 		//Write CalibrationDate data to SDAQ
-		if(WriteCalibrationDate(socket_num, dev_addr, date_node_data->ch_num, &date, date_node_data->period, date_node_data->amount_of_points, date_node_data->cal_unit))
+		if(SDAQ_tx_WriteCalibrationDate(tx, dev_addr, date_node_data->ch_num, &date, date_node_data->period, date_node_data->amount_of_points, date_node_data->cal_unit))
+			return -1;
+		cursor->phase = cal_upload_done;
+		return 1;
+	}
+	return 0;
+}
+
+int setinfo_all(int socket_num, opt_flags *usr_flag)
+{
+	fleet_set_ctx ctx = {.usr_flag = usr_flag};
+	SDAQ_info_cal_data *manifest;
+	GHashTable *by_sn;
+	unsigned int serial_number[FLEET_ADDRS];
+	unsigned long long addrs, conflicts, wake_at;
+	unsigned int amount_of_missing = 0, addr;
+	int amount_of_confs, retval = EXIT_SUCCESS;
+
+	if(!usr_flag->silent)
+	{
+		printf("Manifest read and validation: ");
+		fflush(stdout);
+	}
+	if((amount_of_confs = XML_fleet_file_read(usr_flag->info_file, (void **)&manifest)) < 0)
+		return EXIT_FAILURE;
+	if(!usr_flag->silent)
+		printf("Success, %d SDAQs\nScan the CANbus (up to %d sec) ...\n", amount_of_confs, usr_flag->timeout);
+	addrs = Discover_scan(socket_num, serial_number, &conflicts, usr_flag);
+	//Manifest's entries by serial number, removed when found on the bus.
+	by_sn = g_hash_table_new(g_direct_hash, g_direct_equal);
+	for(int i=0; i<amount_of_confs; i++)
+		g_hash_table_insert(by_sn, GUINT_TO_POINTER(manifest[i].SDAQ_info.serial_number), &manifest[i]);
+	ctx.devs = g_new0(fleet_set_dev, __builtin_popcountll(addrs));
+	for(; addrs; addrs &= addrs - 1)
+	{
+		addr = __builtin_ctzll(addrs);
+		if(!(ctx.devs[ctx.amount].new_conf = g_hash_table_lookup(by_sn, GUINT_TO_POINTER(serial_number[addr]))))
 		{
-			fprintf(stderr, "Failure at WriteCalibrationDate() for CH%d\n",date_node_data->ch_num);
-			return EXIT_FAILURE;
+			if(!usr_flag->silent)
+				printf("Address %2u: S/N %10u, Not in the manifest\n", addr, serial_number[addr]);
+			continue;
 		}
+		g_hash_table_remove(by_sn, GUINT_TO_POINTER(serial_number[addr]));
+		ctx.devs[ctx.amount].ctx = &ctx;
+		ctx.devs[ctx.amount++].address = addr;
 	}
-	return EXIT_SUCCESS;
+	//SDAQs with conflicting address can't be accessed, their manifest's entries are reported as missing.
+	amount_of_missing = g_hash_table_size(by_sn);
+	for(int i=0; i<amount_of_confs; i++)
+		if(g_hash_table_contains(by_sn, GUINT_TO_POINTER(manifest[i].SDAQ_info.serial_number)))
+			printf("S/N %10u: Not found on the bus%s\n", manifest[i].SDAQ_info.serial_number, conflicts ? " (or with conflicting address)" : "");
+	g_hash_table_destroy(by_sn);
+	if(SDAQ_trans_engine_init(&ctx.eng, socket_num))
+	{
+		perror("Transaction engine");
+		ctx.abort = 1;
+		retval = EXIT_FAILURE;
+	}
+	else
+	{
+		if(!usr_flag->no_registry)
+			SDAQ_registry_open(&ctx.reg, usr_flag->CANif_name);
+		if(!usr_flag->silent)
+			printf("Set info of %u SDAQs, up to %d at once\n", ctx.amount, FLEET_MAX_ACTIVE);
+		//The SDAQs are pipelined. Each completed SDAQ starts the next, up to FLEET_MAX_ACTIVE at once.
+		while(ctx.next < ctx.amount && ctx.active < FLEET_MAX_ACTIVE)
+			fleet_set_start(&ctx);
+		while(ctx.active)
+		{
+			//Bursts of the uploads, between the frames of the transactions.
+			wake_at = 0;
+			for(unsigned int i=0; i<ctx.next; i++)
+				if(ctx.devs[i].state == fleet_set_upload)
+					fleet_set_tx(&ctx.devs[i], mono_time_ms(), &wake_at);
+			if(SDAQ_trans_step_until(&ctx.eng, wake_at) < 0)
+			{
+				perror("Reception");
+				ctx.abort = 1;
+				retval = EXIT_FAILURE;
+				break;
+			}
+		}
+		SDAQ_trans_engine_close(&ctx.eng);
+		//SDAQs interrupted at their upload.
+		for(unsigned int i=0; i<ctx.next; i++)
+			if(ctx.devs[i].state == fleet_set_upload)
+				fleet_set_finish(&ctx.devs[i], "Upload interrupted");
+		SDAQ_registry_save(&ctx.reg);
+		SDAQ_registry_close(&ctx.reg);
+	}
+	if(!usr_flag->silent)
+		printf("Completed: %u SDAQs, %u failed, %u not found\n", ctx.amount, ctx.failed + ctx.amount - ctx.next, amount_of_missing);
+	for(int i=0; i<amount_of_confs; i++)
+		free_SDAQ_info_cal_data(&manifest[i]);
+	g_free(manifest);
+	g_free(ctx.devs);
+	return ctx.failed || ctx.next < ctx.amount || amount_of_missing ? EXIT_FAILURE : retval;
 }
 
-/*
-	Comparing function used in g_slist_find_custom.
-	Compare ch_num from date_list_data_of_node a with ch_num from b. Return 0 if are the same, 1 otherwise.
-*/
-gint SDAQ_date_node_with_channel_b_find (gconstpointer a, gconstpointer b)
+void fleet_set_start(fleet_set_ctx *ctx)
 {
-	const unsigned char current_ch_num = ((date_list_data_of_node*)a)->ch_num,
-						wanted_ch_num = ((date_list_data_of_node*)b)->ch_num;
+	fleet_set_dev *dev;
 
-	return wanted_ch_num == current_ch_num ? 0 : 1;
+	if(ctx->abort || ctx->next >= ctx->amount)
+		return;
+	dev = &(ctx->devs[ctx->next++]);
+	ctx->active++;
+	dev->start = mono_time_ms();
+	dev->state = fleet_set_info;
+	dev->info_state = (info_reply){.str = &dev->cur_conf, .owner = dev};
+	dev->info_trans = (SDAQ_trans){.dev_addr = dev->address,
+								   .reply_set = SDAQ_REPLY(Device_status)|SDAQ_REPLY(Device_info)|SDAQ_REPLY(Calibration_Date),
+								   .timeout = ctx->usr_flag->timeout*1000,
+								   .request = SDAQ_trans_req_info,
+								   .on_reply = info_reply_dec,
+								   .on_done = fleet_set_info_done,
+								   .arg = &dev->info_state};
+	if(SDAQ_trans_submit(&ctx->eng, &dev->info_trans))
+		fleet_set_finish(dev, "Request failed");//Start the next, if any.
 }
 
-void free_SDAQ_info_cal_data(SDAQ_info_cal_data *conf)
+int fleet_set_cal_data_req(fleet_set_dev *dev, unsigned int CHs)
+{
+	dev->cal_CHs = CHs & ((1U<<dev->cur_conf.SDAQ_info.num_of_ch)-1);
+	return fleet_set_cal_data_next(dev);
+}
+
+int fleet_set_cal_data_next(fleet_set_dev *dev)
 {
-	//Free the list and the arrays of the conf
-	g_slist_free_full((GSList *)(conf->Calibration_date_list), free_SDAQ_Date_node);
-	conf->Calibration_date_list = NULL;
-	for(int i=0; i<conf->SDAQ_info.num_of_ch; i++)
+	int i;
+
+	//One channel of an SDAQ is queried at a time, the SDAQs of the fleet are queried concurrently.
+	while(dev->cal_CHs && !dev->error)
 	{
-		g_slist_free_full((GSList *)(conf->Cal_points_data_lists[i]), free_SDAQ_Date_node);
-		conf->Cal_points_data_lists[i] = NULL;
+		i = __builtin_ctz(dev->cal_CHs);
+		dev->cal_CHs &= dev->cal_CHs - 1;
+		dev->cal_state = (cal_data_reply){.str = &dev->cur_conf, .owner = dev, .ch_index = i};
+		dev->cal_trans = (SDAQ_trans){.dev_addr = dev->address,
+									  .channel = i+1,
+									  .reply_set = SDAQ_REPLY(Calibration_Point_Data)|SDAQ_REPLY(Calibration_Date),
+									  .timeout = CAL_DATA_CH_TIMEOUT,
+									  .retries = RETRY_CNT_INIT,
+									  .request = SDAQ_trans_req_cal_data,
+									  .on_reply = cal_data_reply_dec,
+									  .on_done = fleet_set_cal_data_done,
+									  .arg = &dev->cal_state};
+		if(!SDAQ_trans_submit(&dev->ctx->eng, &dev->cal_trans))
+			return 0;
+		dev->error = "Request failed";
 	}
-	free(conf->Cal_points_data_lists);
-	conf->Cal_points_data_lists=NULL;
+	return 1;
+}
+
+void fleet_set_info_done(SDAQ_trans *trans, enum SDAQ_trans_result result)
+{
+	fleet_set_dev *dev = ((info_reply *)trans->arg)->owner;
+	unsigned int CHs;
+
+	if(result != SDAQ_trans_done)
+	{
+		fleet_set_finish(dev, !dev->info_state.status_rx && !dev->info_state.info_rx ? "No device found" : "Reception Failed");
+		return;
+	}
+	if(dev->state == fleet_set_verify_info)
+	{
+		//Only the channels with uploaded points are received again.
+		dev->state = fleet_set_verify_cal_data;
+		if(!(CHs = SDAQ_cal_chs_with_points(dev->upload)))
+			fleet_set_verify(dev);
+		else if(fleet_set_cal_data_req(dev, CHs))
+			fleet_set_finish(dev, dev->error);
+		return;
+	}
+	if(corr_SDAQ_info_and_calibration_data(&dev->cur_conf, dev->new_conf, INFO))
+	{
+		fleet_set_finish(dev, "Info differs from the manifest");
+		return;
+	}
+	//The points of the SDAQ are needed only for the delta, at the channels with points at the manifest.
+	dev->state = fleet_set_cal_data;
+	if(!dev->ctx->usr_flag->delta || !(CHs = SDAQ_cal_chs_with_points(dev->new_conf)))
+		fleet_set_upload_start(dev);
+	else if(fleet_set_cal_data_req(dev, CHs))
+		fleet_set_finish(dev, dev->error);
+}
+
+void fleet_set_cal_data_done(SDAQ_trans *trans, enum SDAQ_trans_result result)
+{
+	fleet_set_dev *dev = ((cal_data_reply *)trans->arg)->owner;
+
+	if(result != SDAQ_trans_done)
+		dev->error = "Calibration data incomplete";
+	if(!fleet_set_cal_data_next(dev))
+		return;
+	if(dev->error)
+		fleet_set_finish(dev, dev->error);
+	else if(dev->state == fleet_set_cal_data)
+		fleet_set_upload_start(dev);
+	else
+		fleet_set_verify(dev);
+}
+
+void fleet_set_upload_start(fleet_set_dev *dev)
+{
+	fleet_set_ctx *ctx = dev->ctx;
+
+	if(ctx->usr_flag->delta)
+	{
+		if(!diff_SDAQ_info_and_calibration_data(&dev->cur_conf, dev->new_conf, &dev->delta))
+		{
+			fleet_set_finish(dev, NULL);
+			return;
+		}
+		dev->upload = &dev->delta;
+	}
+	else
+		dev->upload = dev->new_conf;
+	if(!dev->upload->cal || !dev->upload->cal->date_valid)
+	{
+		fleet_set_finish(dev, "Manifest without calibration dates");
+		return;
+	}
+	//Each SDAQ has its own bursts, interleaved with the others' at the socket.
+	dev->state = fleet_set_upload;
+	dev->amount_of_frames = 0;
+	SDAQ_tx_init(&dev->tx, ctx->eng.socket_fd, SDAQ_CAL_TX_BURST, SDAQ_CAL_TX_GAP);
+	cal_upload_init(&dev->cursor, dev->upload);
+	dev->next_burst = mono_time_ms();
+	SDAQ_registry_invalidate(&ctx->reg, dev->address);
+}
+
+void fleet_set_tx(fleet_set_dev *dev, unsigned long long now, unsigned long long *wake_at)
+{
+	int ret;
+
+	if(now < dev->next_burst)
+	{
+		if(!*wake_at || dev->next_burst < *wake_at)
+			*wake_at = dev->next_burst;
+		return;
+	}
+	//The frames of the queued step are sent first, one per burst.
+	if(!SDAQ_tx_pending(&dev->tx))
+	{
+		if((ret = cal_upload_next(&dev->tx, dev->address, dev->upload, &dev->cursor)) < 0)
+		{
+			fleet_set_finish(dev, "Upload failed");
+			return;
+		}
+		if(!ret)
+		{
+			//The gap after the last burst is passed. The SDAQ has stored the calibration.
+			if(dev->ctx->usr_flag->verify)
+			{
+				dev->state = fleet_set_verify_info;
+				dev->info_state = (info_reply){.str = &dev->cur_conf, .owner = dev};
+				if(SDAQ_trans_submit(&dev->ctx->eng, &dev->info_trans))
+					fleet_set_finish(dev, "Request failed");
+			}
+			else
+				fleet_set_finish(dev, NULL);
+			return;
+		}
+		dev->amount_of_frames += SDAQ_tx_pending(&dev->tx);
+	}
+	if((ret = SDAQ_tx_send_burst(&dev->tx)) < 0)
+	{
+		fleet_set_finish(dev, "Upload failed");
+		return;
+	}
+	//Back off if the CAN-IF's TX queue is full, otherwise give the SDAQ the gap to store the frame.
+	dev->next_burst = now + (dev->tx.retries ? SDAQ_TX_BACKOFF : SDAQ_CAL_TX_GAP/1000);
+	if(!*wake_at || dev->next_burst < *wake_at)
+		*wake_at = dev->next_burst;
+}
+
+void fleet_set_verify(fleet_set_dev *dev)
+{
+	unsigned char options = SDAQ_cal_chs_with_points(dev->upload) ? DATE|POINTS : DATE;
+
+	fleet_set_finish(dev, corr_SDAQ_info_and_calibration_data(&dev->cur_conf, dev->upload, options) ? "Verification failed" : NULL);
+}
+
+void fleet_set_finish(fleet_set_dev *dev, const char *error)
+{
+	fleet_set_ctx *ctx = dev->ctx;
+	double elapsed = mono_time_ms() - dev->start;
+
+	if(!ctx->usr_flag->silent)
+	{
+		if(error)
+			printf("Address %2u: S/N %10u, %s after %.0f msec\n", dev->address, dev->new_conf->SDAQ_info.serial_number, error, elapsed);
+		else if(!dev->upload)
+			printf("Address %2u: S/N %10u, Up to date, %.0f msec\n", dev->address, dev->new_conf->SDAQ_info.serial_number, elapsed);
+		else
+			printf("Address %2u: S/N %10u, %s %d frames, %.0f msec\n", dev->address, dev->new_conf->SDAQ_info.serial_number,
+				   ctx->usr_flag->verify ? "Verified," : "Uploaded", dev->amount_of_frames, elapsed);
+	}
+	if(error)
+		ctx->failed++;
+	dev->state = fleet_set_done;
+	free_SDAQ_info_cal_data(&dev->cur_conf);
+	free_SDAQ_info_cal_data(&dev->delta);
+	ctx->active--;
+	fleet_set_start(ctx);
+}
+
+void free_SDAQ_info_cal_data(SDAQ_info_cal_data *conf)
+{
+	//Free the calibration model of the conf
+	if(conf->cal)
+		g_slice_free(SDAQ_cal_model, conf->cal);
+	conf->cal = NULL;
 }